@@ -46,14 +46,22 @@ static double mygettime(void) {
 
 #define PARSE_TIME_SECS 3
 
+/* with reuse, a single handle is reset with yajl_reset() after each
+ * document rather than a new one allocated for it */
 static int
-run(int validate_utf8)
+run(int validate_utf8, int reuse)
 {
     long long times = 0; 
     double starttime;
+    yajl_handle hand = NULL;
 
     starttime = mygettime();
 
+    if (reuse) {
+        hand = yajl_alloc(NULL, NULL, NULL);
+        yajl_config(hand, yajl_dont_validate_strings, validate_utf8 ? 0 : 1);
+    }
+
     /* allocate a parser */
     for (;;) {
 		int i;
@@ -63,11 +71,14 @@ run(int validate_utf8)
         }
 
         for (i = 0; i < 100; i++) {
-            yajl_handle hand = yajl_alloc(NULL, NULL, NULL);
             yajl_status stat;        
             const char ** d;
 
-            yajl_config(hand, yajl_dont_validate_strings, validate_utf8 ? 0 : 1);
+            if (!reuse) {
+                hand = yajl_alloc(NULL, NULL, NULL);
+                yajl_config(hand, yajl_dont_validate_strings,
+                            validate_utf8 ? 0 : 1);
+            }
 
             for (d = get_doc(times % num_docs()); *d; d++) {
                 stat = yajl_parse(hand, (unsigned char *) *d, strlen(*d));
@@ -83,13 +94,17 @@ run(int validate_utf8)
                                    (*d ? strlen(*d) : 0));
                 fprintf(stderr, "%s", (const char *) str);
                 yajl_free_error(hand, str);
+                yajl_free(hand);
                 return 1;
             }
-            yajl_free(hand);
+            if (reuse) yajl_reset(hand);
+            else yajl_free(hand);
             times++;
         }
     }
 
+    if (reuse) yajl_free(hand);
+
     /* parsed doc 'times' times */
     {
         double throughput;
@@ -125,10 +140,20 @@ main(void)
            num_docs());
 
     printf("With UTF8 validation:\n");
-    rv = run(1);
+    rv = run(1, 0);
     if (rv != 0) return rv;
     printf("Without UTF8 validation:\n");
-    rv = run(0);
+    rv = run(0, 0);
+    if (rv != 0) return rv;
+
+    /* not comparable with the figures above, which include allocating
+     * and freeing a handle per document */
+    printf("-- one handle reused with yajl_reset() for every document --\n");
+    printf("With UTF8 validation, handle reused:\n");
+    rv = run(1, 1);
+    if (rv != 0) return rv;
+    printf("Without UTF8 validation, handle reused:\n");
+    rv = run(0, 1);
     return rv;
 }
 
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2007-2014, Lloyd Hilaiel <me@lloyd.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * \file yajl_arena.h
+ * Arena and pool allocators which can be plugged into parser handles,
+ * generators and trees as yajl_alloc_funcs.
+ */
+
+#ifndef __YAJL_ARENA_H__
+#define __YAJL_ARENA_H__
+
+#include <yajl/yajl_common.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /** An arena allocator.  Memory is handed out from large chunks by
+     *  bumping a pointer and is released all at once by yajl_arena_reset()
+     *  or yajl_arena_free().  Freeing or reallocating the most recent
+     *  allocation works in place, other frees are no-ops, so an arena
+     *  suits a handle or tree that is dropped as a whole. */
+    typedef struct yajl_arena_t * yajl_arena;
+
+    /** allocate an arena
+     *  \param allocFuncs routines used to obtain the chunks, may be NULL
+     *                    in which case malloc/free/realloc will be used.
+     *  \param chunkSize  size of each chunk in bytes, or 0 for a default.
+     *                    Larger allocations get a chunk of their own.
+     *  \returns an arena, or NULL on failure
+     */
+    YAJL_API yajl_arena yajl_arena_alloc(const yajl_alloc_funcs * allocFuncs,
+                                         size_t chunkSize);
+
+    /** get allocation routines which allocate from the arena.  The result
+     *  stays valid until the arena is freed and may be passed to
+     *  yajl_alloc(), yajl_gen_alloc() or yajl_tree_parse_alloc() */
+    YAJL_API const yajl_alloc_funcs * yajl_arena_funcs(yajl_arena arena);
+
+    /** release everything allocated from the arena at once.  One chunk is
+     *  kept for reuse */
+    YAJL_API void yajl_arena_reset(yajl_arena arena);
+
+    /** free an arena and everything allocated from it */
+    YAJL_API void yajl_arena_free(yajl_arena arena);
+
+    /** A pool allocator.  Small allocations are rounded up to a power of
+     *  two size class and freed blocks are kept on a free list per class
+     *  for reuse, larger ones are passed to the underlying routines.
+     *  Blocks may be freed in any order. */
+    typedef struct yajl_pool_t * yajl_pool;
+
+    /** allocate a pool
+     *  \param allocFuncs routines used to obtain memory, may be NULL in
+     *                    which case malloc/free/realloc will be used.
+     *  \returns a pool, or NULL on failure
+     */
+    YAJL_API yajl_pool yajl_pool_alloc(const yajl_alloc_funcs * allocFuncs);
+
+    /** get allocation routines which allocate from the pool, see
+     *  yajl_arena_funcs() */
+    YAJL_API const yajl_alloc_funcs * yajl_pool_funcs(yajl_pool pool);
+
+    /** free a pool and all the small blocks allocated from it.  Large
+     *  blocks must have been freed before */
+    YAJL_API void yajl_pool_free(yajl_pool pool);
+
+    /** get an arena belonging to the calling thread, allocated with the
+     *  default routines and chunk size on first use.  Other threads can't
+     *  see it, so no locking is needed.
+     *  \returns the arena, or NULL if out of memory or if the compiler
+     *           has no thread local storage
+     */
+    YAJL_API yajl_arena yajl_arena_thread(void);
+
+    /** free the calling thread's arena, if any */
+    YAJL_API void yajl_arena_thread_free(void);
+
+    /** get a pool belonging to the calling thread, see
+     *  yajl_arena_thread() */
+    YAJL_API yajl_pool yajl_pool_thread(void);
+
+    /** free the calling thread's pool, if any */
+    YAJL_API void yajl_pool_thread_free(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -23,7 +23,8 @@
 extern "C" {
 #endif
 
-/* note: must match setting in yajl_bytestack.h */
+/* the deepest nesting yajl_gen could produce before its nesting became
+ * unlimited, kept for old code.  see the yajl_gen_max_depth option */
 #define YAJL_MAX_DEPTH 128
 
 /* when defined, the following provides additional callbacks to receive
@@ -84,6 +85,31 @@ typedef struct
     void * ctx;
 } yajl_alloc_funcs;
 
+/** Memory usage statistics of a parser handle or generator, see
+ *  yajl_get_stats() and yajl_gen_get_stats().  The allocation counters
+ *  only count while collection is switched on with the yajl_collect_stats
+ *  or yajl_gen_collect_stats option, the other fields are always kept. */
+typedef struct
+{
+    /** number of calls to the malloc, realloc and free functions */
+    size_t mallocs;
+    size_t reallocs;
+    size_t frees;
+    /** total number of bytes requested by malloc and realloc calls */
+    size_t bytes;
+    /** largest capacity reached by any of the internal buffers */
+    size_t peakBufCapacity;
+    /** number of times any of the internal buffers grew */
+    size_t bufGrows;
+    /** number of times the parser's string decoding buffer grew */
+    size_t decodeBufGrows;
+    /** number of bytes the lexer copied into its token buffer because a
+     *  token spanned chunks */
+    size_t lexBufferedBytes;
+    /** number of times the state stack grew */
+    size_t stackGrows;
+} yajl_stats;
+
 #ifdef __cplusplus
 }
 #endif
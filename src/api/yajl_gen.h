@@ -36,8 +36,8 @@ extern "C" {
         /** at a point where a map key is generated, a function other than
          *  yajl_gen_string was called */
         yajl_gen_keys_must_be_strings,
-        /** YAJL's maximum generation depth was exceeded.  see
-         *  YAJL_MAX_DEPTH */
+        /** the nesting allowed by the yajl_gen_max_depth option was
+         *  exceeded */
         yajl_max_depth_exceeded,
         /** A generator function (yajl_gen_XXX) was called while in an error
          *  state */
@@ -57,6 +57,22 @@ extern "C" {
 #ifdef YAJL_SUPPLEMENTARY
         , yajl_gen_invalid_sup_item
 #endif
+        /** the internal buffer could not grow.  The generator is left in
+         *  an error state until yajl_gen_clear() and yajl_gen_reset() */
+        , yajl_gen_out_of_memory
+        /** something other than yajl_gen_string_append() or
+         *  yajl_gen_string_close() was called while a string was open, or
+         *  one of those was called with no string open */
+        , yajl_gen_string_unbalanced
+        /** yajl_gen_rollback() or yajl_gen_release_savepoint() was passed
+         *  a savepoint which is not held, because it was released, rolled
+         *  back past, or dropped when the output was cleared */
+        , yajl_gen_invalid_savepoint
+        /** yajl_gen_begin_fragment() was called where the parent was not
+         *  between the values or members of a container, or
+         *  yajl_gen_splice() with a fragment begun elsewhere or left part
+         *  way through a value or member */
+        , yajl_gen_fragment_mismatch
     } yajl_gen_status;
 
     /** an opaque handle to a generator */
@@ -67,6 +83,14 @@ extern "C" {
                                  const char * str,
                                  size_t len);
 
+    /** a piece of output collected with the yajl_gen_iovec option.  It is
+     *  laid out like struct iovec on POSIX systems, so an array of them
+     *  can be passed to writev() or sendmsg() */
+    typedef struct {
+        const void * iov_base;
+        size_t iov_len;
+    } yajl_iovec;
+
     /** configuration parameters for the parser, these may be passed to
      *  yajl_gen_config() along with option specific argument(s).  In general,
      *  all configuration parameters default to *off*. */
@@ -106,7 +130,62 @@ extern "C" {
          * suppressing final newline, useful with YAJL_SUPPLEMENTARY if
          * supplementary items are going to be added after the root item
          */
-        yajl_gen_no_final_newline = 0x20
+        yajl_gen_no_final_newline = 0x20,
+        /**
+         * Count the calls made to the allocation routines, and the bytes
+         * requested, from now on.  Switching the option on again resets
+         * the counters.  See yajl_gen_get_stats().
+         */
+        yajl_gen_collect_stats = 0x40,
+        /**
+         * The deepest nesting of maps and arrays allowed, as a size_t
+         * argument.  Opening a container beyond it fails with
+         * yajl_max_depth_exceeded.  0, the default, means no limit
+         * other than memory.
+         */
+        yajl_gen_max_depth = 0x80,
+        /**
+         * Collect the output as a list of pieces for yajl_gen_get_iov()
+         * instead of in one buffer.  The size_t argument is the length
+         * from which parts of strings and raw values are referenced where
+         * the caller passed them rather than copied, values under 16 are
+         * taken as 16.  The caller must then keep them unchanged until
+         * yajl_gen_clear() or yajl_gen_free().  Everything else is packed
+         * into memory of the generator's own.  0 returns to the internal
+         * buffer.
+         *
+         * example:
+         *   yajl_gen_config(g, yajl_gen_iovec, (size_t) 256);
+         */
+        yajl_gen_iovec = 0x100,
+        /**
+         * Give the internal buffer an unsigned char * block of memory and
+         * its size_t capacity, to fill before it has to grow.  The block
+         * must come from the generator's allocation routines, which then
+         * own it and grow it with realloc.  A NULL block has the
+         * generator allocate the capacity itself, in place of the
+         * default of 2048 bytes.  Output not yet taken is dropped.
+         *
+         * example:
+         *   yajl_gen_config(g, yajl_gen_buffer, NULL, (size_t) 65536);
+         */
+        yajl_gen_buffer = 0x200,
+        /**
+         * Output canonical JSON, so that equal content gives the same
+         * bytes, for hashing or deduplication.  yajl_tree_generate() then
+         * sorts the keys of each map by byte order (keeping duplicates in
+         * their order), outputs no whitespace whatever yajl_gen_beautify
+         * says, not even the final newline, and never escapes '/'.
+         * Integers that fit in a long long are output exactly.  Other
+         * numbers are normalized by their value as a double, however they
+         * were written: whole numbers in the range of a long long as
+         * integers (-0 is 0, 1.0 and 1e0 are 1, 1e17 is
+         * 100000000000000000), others in the fewest digits that read back
+         * as the same double, laid out as ECMAScript does (1.5e-7,
+         * 1e+21).  The other routines output what they are given in the
+         * order given, yajl_gen_double() with numbers in the same form.
+         */
+        yajl_gen_canonical = 0x400
     } yajl_gen_option;
 
     /** allow the modification of generator options subsequent to handle
@@ -128,6 +207,11 @@ extern "C" {
     /** free a generator handle */
     YAJL_API void yajl_gen_free(yajl_gen handle);
 
+    /** get memory usage statistics for a generator.  The allocation
+     *  counters are zero unless the yajl_gen_collect_stats option is on,
+     *  the buffer figures are only kept when no print callback is set. */
+    YAJL_API void yajl_gen_get_stats(yajl_gen handle, yajl_stats * stats);
+
     YAJL_API yajl_gen_status yajl_gen_integer(yajl_gen hand, long long int number);
     /** generate a floating point number.  number may not be infinity or
      *  NaN, as these have no representation in JSON.  In these cases the
@@ -141,6 +225,48 @@ extern "C" {
                                              size_t len);
     YAJL_API yajl_gen_status yajl_gen_null(yajl_gen hand);
     YAJL_API yajl_gen_status yajl_gen_bool(yajl_gen hand, int boolean);
+    /** generate a value given as JSON text, for instance one captured
+     *  with yajl_capture_raw_value().  It is output as it is, with the
+     *  separators needed before it, and is not checked, so it must be a
+     *  single valid value */
+    YAJL_API yajl_gen_status yajl_gen_raw_value(yajl_gen hand,
+                                                const char * json,
+                                                size_t len);
+
+    /** begin a string value or map key whose content is passed in pieces
+     *  to yajl_gen_string_append(), for content too large to hold in
+     *  memory at once.  Each piece is escaped and output as it arrives.
+     *  No other value may be generated until yajl_gen_string_close() */
+    YAJL_API yajl_gen_status yajl_gen_string_open(yajl_gen hand);
+    /** add to the open string.  A piece may end part way through a UTF-8
+     *  character, with yajl_gen_validate_utf8 the rest of it is then
+     *  checked along with the next piece */
+    YAJL_API yajl_gen_status yajl_gen_string_append(yajl_gen hand,
+                                                    const unsigned char * str,
+                                                    size_t len);
+    /** finish the open string */
+    YAJL_API yajl_gen_status yajl_gen_string_close(yajl_gen hand);
+
+    /** a string encoded once by yajl_gen_prepare_string() for output any
+     *  number of times */
+    typedef struct yajl_gen_prepared_t * yajl_gen_prepared;
+
+    /** encode a string which is output often, such as a map key, so that
+     *  yajl_gen_prepared_string() has only to copy it.  It is escaped and
+     *  validated according to the options of the generator at this point,
+     *  and may be used with any generator having the same options.
+     *  \returns the prepared string, or NULL if out of memory or if
+     *           yajl_gen_validate_utf8 is on and str is not valid UTF-8
+     */
+    YAJL_API yajl_gen_prepared yajl_gen_prepare_string(yajl_gen hand,
+                                                       const unsigned char * str,
+                                                       size_t len);
+    /** generate a prepared string, as a value or as a map key */
+    YAJL_API yajl_gen_status yajl_gen_prepared_string(yajl_gen hand,
+                                                      yajl_gen_prepared str);
+    /** free a prepared string, with the generator it was prepared with */
+    YAJL_API void yajl_gen_prepared_free(yajl_gen hand,
+                                         yajl_gen_prepared str);
 #ifdef YAJL_SUPPLEMENTARY
     YAJL_API yajl_gen_status yajl_gen_sup_integer(yajl_gen hand,
                                                   long long int number);
@@ -169,6 +295,64 @@ extern "C" {
     YAJL_API yajl_gen_status yajl_gen_get_buf(yajl_gen hand,
                                               const unsigned char ** buf,
                                               size_t * len);
+    /** take over the null terminated generator buffer, which the caller
+     *  then frees with the free routine of the allocation routines the
+     *  generator was allocated with.  The generator continues with an
+     *  empty buffer, as after yajl_gen_clear().  This saves copying the
+     *  output out of the buffer.
+     *  \returns yajl_gen_no_buf if there is no internal buffer,
+     *           yajl_gen_out_of_memory if it failed to hold the output */
+    YAJL_API yajl_gen_status yajl_gen_steal_buf(yajl_gen hand,
+                                                unsigned char ** buf,
+                                                size_t * len);
+
+    /** access the output collected with the yajl_gen_iovec option, valid
+     *  until the next generator call.  yajl_gen_clear() empties it as it
+     *  does the buffer.  Returns yajl_gen_no_buf without the option */
+    YAJL_API yajl_gen_status yajl_gen_get_iov(yajl_gen hand,
+                                              const yajl_iovec ** iov,
+                                              size_t * count);
+    /** remember the point generation has reached, so that what is
+     *  generated after it can be discarded with yajl_gen_rollback(), for
+     *  instance a member which fails to serialize half way through.
+     *  Savepoints nest, and are held until rolled back or released.
+     *  yajl_gen_clear() drops them all.
+     *  \param sp receives an identifier for the savepoint
+     *  \returns yajl_gen_no_buf with a print callback, whose output
+     *           can't be taken back, yajl_gen_string_unbalanced while a
+     *           string is open, or yajl_gen_out_of_memory */
+    YAJL_API yajl_gen_status yajl_gen_savepoint(yajl_gen hand, size_t * sp);
+    /** go back to savepoint sp.  The output is truncated to where it was,
+     *  and the nesting and state are restored, also from an error state
+     *  entered since.  sp and the savepoints taken after it are released.
+     *  With yajl_gen_iovec the memory of copied pieces dropped is only
+     *  reused after yajl_gen_clear() */
+    YAJL_API yajl_gen_status yajl_gen_rollback(yajl_gen hand, size_t sp);
+    /** keep what was generated since savepoint sp, releasing sp and the
+     *  savepoints taken after it */
+    YAJL_API yajl_gen_status yajl_gen_release_savepoint(yajl_gen hand,
+                                                        size_t sp);
+
+    /** prepare frag to generate a run of values (or of members, in a map)
+     *  which yajl_gen_splice() can then add to the container parent is
+     *  in.  frag takes the nesting, options and indentation of parent, and
+     *  its output is cleared.  Fragments of a large array or map may so be
+     *  generated on several threads, each with a generator of its own,
+     *  and spliced in order by the thread owning parent.  Beginning a
+     *  fragment only reads parent, but parent must not change meanwhile.
+     *  frag has to use its internal buffer, and stays a fragment until
+     *  yajl_gen_reset() */
+    YAJL_API yajl_gen_status yajl_gen_begin_fragment(yajl_gen frag,
+                                                     yajl_gen parent);
+    /** output what frag generated since it was begun or last spliced, with
+     *  the separator needed before it, as if hand had generated it.  The
+     *  start and end offsets of hand are those of the last value of
+     *  frag.  frag is cleared to generate the next run
+     *  \returns yajl_gen_fragment_mismatch unless hand is where frag was
+     *           begun, or after values added there, and frag is between
+     *           values */
+    YAJL_API yajl_gen_status yajl_gen_splice(yajl_gen hand, yajl_gen frag);
+
     YAJL_API size_t yajl_gen_get_start_offset(yajl_gen hand);
     YAJL_API size_t yajl_gen_get_end_offset(yajl_gen hand);
 
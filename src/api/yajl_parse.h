@@ -37,7 +37,18 @@ extern "C" {
         yajl_status_client_canceled,
         /** An error occured during the parse.  Call yajl_get_error for
          *  more information about the encountered error */
-        yajl_status_error
+        yajl_status_error,
+        /** An allocation routine returned NULL.  The handle can't continue
+         *  with this parse, but may be reset with yajl_reset() */
+        yajl_status_out_of_memory,
+        /** The input nests deeper than the yajl_max_depth option allows */
+        yajl_status_max_depth_exceeded,
+        /** A string, number or other token is longer than the
+         *  yajl_max_token_length option allows */
+        yajl_status_max_token_length_exceeded,
+        /** More input was passed to the handle than the
+         *  yajl_max_total_bytes option allows */
+        yajl_status_max_bytes_exceeded
     } yajl_status;
 
     /** attain a human readable, english, string for an error */
@@ -110,6 +121,52 @@ extern "C" {
 #endif
     } yajl_callbacks;
 
+    /** a piece of a string which lies in one of the chunks passed to
+     *  yajl_parse(), see yajl_chunk_callbacks */
+    typedef struct {
+        const unsigned char * buf;
+        size_t len;
+    } yajl_segment;
+
+    /** callbacks for the yajl_retain_chunks option.  They are passed the
+     *  context pointer given to yajl_alloc() */
+    typedef struct {
+        /** the parser no longer refers to chunk, which was passed to
+         *  yajl_parse(), so the client may reuse or free it.  A chunk
+         *  is released before yajl_parse() returns unless a string or
+         *  number continues into the next chunk, then it is kept until
+         *  that token has been delivered. */
+        void (* release)(void * ctx, const unsigned char * chunk);
+        /** optional.  Passes a string without escapes which spans
+         *  chunks as its pieces in the chunks, in order, without copying
+         *  it.  isKey is non-zero for a map key.  When NULL such strings
+         *  are copied together and passed to yajl_string or
+         *  yajl_map_key. */
+        int (* string_segments)(void * ctx, int isKey,
+                                const yajl_segment * segments,
+                                size_t count);
+    } yajl_chunk_callbacks;
+
+    /** callbacks for the yajl_stream_strings option, which deliver
+     *  strings in pieces as they arrive rather than when complete.  A
+     *  string is begun, passed to segment zero or more times with the
+     *  next part of its decoded content, and ended.  Escape sequences are
+     *  decoded whole, surrogate pairs included, but a segment may end
+     *  part way through a multibyte UTF-8 character.  Each group of three
+     *  is either all set or all NULL, a NULL group leaves those strings
+     *  to the yajl_callbacks */
+    typedef struct {
+        int (* yajl_string_begin)(void * ctx);
+        int (* yajl_string_segment)(void * ctx, const unsigned char * buf,
+                                    size_t len);
+        int (* yajl_string_end)(void * ctx);
+
+        int (* yajl_map_key_begin)(void * ctx);
+        int (* yajl_map_key_segment)(void * ctx, const unsigned char * buf,
+                                     size_t len);
+        int (* yajl_map_key_end)(void * ctx);
+    } yajl_string_callbacks;
+
     /** allocate a parser handle
      *  \param callbacks  a yajl callbacks structure specifying the
      *                    functions to call when different JSON entities
@@ -122,8 +179,45 @@ extern "C" {
     YAJL_API yajl_handle yajl_alloc(const yajl_callbacks * callbacks,
                                     yajl_alloc_funcs * afs,
                                     void * ctx);
+    /** reset a parser handle so it can parse a new document.  The
+     *  callbacks, context and options are kept, and so is all memory the
+     *  handle has allocated (the lexer and its token buffer, the string
+     *  decoding buffer and the state stack) so that parsing many small
+     *  documents with one handle doesn't allocate after the first. */
     YAJL_API void yajl_reset(yajl_handle hand);
 
+    /** a pool of idle parser handles, see yajl_handle_pool_alloc() */
+    typedef struct yajl_handle_pool_t * yajl_handle_pool;
+
+    /** allocate a pool of parser handles which share a callbacks
+     *  structure.  Handles taken from the pool with yajl_handle_pool_get()
+     *  and returned with yajl_handle_pool_put() are reset and reused
+     *  rather than freed.  A pool does no locking; a multithreaded server
+     *  should have one pool per thread (or guard calls with its own lock).
+     *  \param callbacks  callbacks for all handles, see yajl_alloc()
+     *  \param afs        memory allocation functions, may be NULL
+     *  \param maxIdle    the most idle handles kept by the pool, more are
+     *                    freed when they are returned
+     */
+    YAJL_API yajl_handle_pool yajl_handle_pool_alloc(
+        const yajl_callbacks * callbacks, yajl_alloc_funcs * afs,
+        size_t maxIdle);
+
+    /** get a parser handle from the pool, allocating one if no idle handle
+     *  is left.  The handle has no options set, like one from yajl_alloc().
+     *  \param ctx  a context pointer that will be passed to callbacks.
+     */
+    YAJL_API yajl_handle yajl_handle_pool_get(yajl_handle_pool pool,
+                                              void * ctx);
+
+    /** return a handle obtained from yajl_handle_pool_get() to the pool */
+    YAJL_API void yajl_handle_pool_put(yajl_handle_pool pool,
+                                       yajl_handle hand);
+
+    /** free a pool and its idle handles.  Handles that are still in use
+     *  must be freed with yajl_free() */
+    YAJL_API void yajl_handle_pool_free(yajl_handle_pool pool);
+
 
     /** configuration parameters for the parser, these may be passed to
      *  yajl_config() along with option specific argument(s).  In general,
@@ -179,7 +273,88 @@ extern "C" {
          * state with an error state, with this flag it will leave the
          * parsing state alone so that another call will resume parsing.
          */
-        yajl_resume_after_cancel = 0x20
+        yajl_resume_after_cancel = 0x20,
+        /**
+         * Count the calls made to the allocation routines, and the bytes
+         * requested, from now on.  Switching the option on again resets
+         * the counters.  See yajl_get_stats().
+         */
+        yajl_collect_stats = 0x40,
+        /**
+         * The deepest nesting of arrays and maps accepted, as a size_t
+         * argument, 0 for no limit (the default).  Opening a container
+         * beyond it fails with yajl_status_max_depth_exceeded.  The
+         * argument must be passed as a size_t, a plain int is read wrong.
+         *
+         * example:
+         *   yajl_config(h, yajl_max_depth, (size_t) 64);
+         */
+        yajl_max_depth = 0x80,
+        /**
+         * The longest string, number or other token accepted in bytes of
+         * input, as a size_t argument, 0 for no limit (the default).  A
+         * longer token fails with yajl_status_max_token_length_exceeded
+         * before it is buffered in full.
+         *
+         * example:
+         *   yajl_config(h, yajl_max_token_length, (size_t) 65536);
+         */
+        yajl_max_token_length = 0x100,
+        /**
+         * The most input accepted by the handle over all calls to
+         * yajl_parse() or yajl_rev_parse() since it was allocated or
+         * reset, as a size_t argument, 0 for no limit (the default).
+         * Passing more fails with yajl_status_max_bytes_exceeded.
+         *
+         * example:
+         *   yajl_config(h, yajl_max_total_bytes, (size_t) 1 << 20);
+         */
+        yajl_max_total_bytes = 0x200,
+        /**
+         * The client promises to keep each chunk passed to yajl_parse()
+         * unchanged until the release callback of the const
+         * yajl_chunk_callbacks * argument is called for it.  A token
+         * spanning chunks is then copied together once when complete,
+         * or not at all for strings given to string_segments, rather
+         * than piece by piece as it arrives.  Pass NULL to switch the
+         * option off.  It applies to yajl_parse() only,
+         * yajl_rev_parse() buffers as usual.
+         */
+        yajl_retain_chunks = 0x400,
+        /**
+         * Pass string values and map keys to the callbacks of the const
+         * yajl_string_callbacks * argument, in pieces as they arrive.  The
+         * parser then buffers no more of a string than one chunk holds,
+         * however long it is.  Pass NULL to switch the option off.  It
+         * applies to yajl_parse() only.
+         */
+        yajl_stream_strings = 0x800,
+        /**
+         * The text passed to yajl_parse() is writable and may be
+         * modified.  A string with escapes that lies within one chunk is
+         * then decoded over itself, rather than copied out to be
+         * decoded, and the pointer passed to the string or map key
+         * callback stays valid for as long as the chunk does.  Strings
+         * without escapes always point into the chunk.  A string
+         * spanning chunks is still decoded into a buffer which is only
+         * valid during the callback.
+         */
+        yajl_allow_in_place_decode = 0x1000,
+        /**
+         * Work out a 64-bit hash of the content of each map and array as
+         * it is parsed, for yajl_get_container_hash() to return in the
+         * yajl_end_map and yajl_end_array callbacks.  The hash is of the
+         * content rather than the text, so whitespace, escapes and the
+         * order of map members make no difference.  Integers that fit in
+         * a long long hash by their exact value, other numbers by their
+         * value as a double, so 1, 1.0 and 1e0 hash alike, as do 1e17 and
+         * 100000000000000000, and so do numbers written apart that round
+         * to the same double.  It is not a cryptographic hash, content
+         * that differs otherwise hashes the same only by rare chance.  It
+         * applies to yajl_parse() only, and can't be switched inside a
+         * map or array.
+         */
+        yajl_hash_containers = 0x2000
     } yajl_option;
 
     /** allow the modification of parser options subsequent to handle
@@ -191,6 +366,15 @@ extern "C" {
     /** free a parser handle */
     YAJL_API void yajl_free(yajl_handle handle);
 
+    /** get memory usage statistics for a parser handle.  The allocation
+     *  counters are zero unless the yajl_collect_stats option is on, the
+     *  buffer and stack figures are kept for the life of the handle and
+     *  are not cleared by yajl_reset().
+     *  \param handle - a handle to the json parser allocated with yajl_alloc
+     *  \param stats - filled in with the current figures
+     */
+    YAJL_API void yajl_get_stats(yajl_handle handle, yajl_stats * stats);
+
     /** Parse some json!
      *  \param hand - a handle to the json parser allocated with yajl_alloc
      *  \param jsonText - a pointer to the UTF8 json text to be parsed
@@ -245,6 +429,30 @@ extern "C" {
     YAJL_API size_t yajl_get_start_offset(yajl_handle hand);
     YAJL_API size_t yajl_get_end_offset(yajl_handle hand);
 
+    /** receives a value captured by yajl_capture_raw_value().  start and
+     *  end are the offsets of its first byte and of the byte after its
+     *  last, counted over all input passed to the handle since it was
+     *  allocated or reset.  text points to the value if it lies within
+     *  the chunk being parsed, and is NULL if it began in an earlier one.
+     *  Returning zero cancels the parse, as for the yajl_callbacks */
+    typedef int (* yajl_raw_value_callback)(void * ctx,
+                                            const unsigned char * text,
+                                            size_t start, size_t end);
+
+    /** pass the next value to cb as its text, rather than as events.
+     *  Call this from a callback, for instance from yajl_map_key to
+     *  capture the value of that key.  The value is still checked, but
+     *  none of the callbacks are called for it.  Applies to yajl_parse()
+     *  only.
+     *  \returns zero if a value is already being captured
+     */
+    YAJL_API int yajl_capture_raw_value(yajl_handle hand,
+                                        yajl_raw_value_callback cb);
+
+    /** get the hash of the map or array just ended, from the yajl_end_map
+     *  or yajl_end_array callback, with the yajl_hash_containers option */
+    YAJL_API unsigned long long yajl_get_container_hash(yajl_handle hand);
+
     /** free an error returned from yajl_get_error */
     YAJL_API void yajl_free_error(yajl_handle hand, unsigned char * str);
 
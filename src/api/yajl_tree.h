@@ -32,6 +32,8 @@
 #define YAJL_TREE_H 1
 
 #include <yajl/yajl_common.h>
+#include <yajl/yajl_parse.h>
+#include <yajl/yajl_gen.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -121,6 +123,76 @@ struct yajl_val_s
 YAJL_API yajl_val yajl_tree_parse (const char *input,
                                    char *error_buffer, size_t error_buffer_size);
 
+/** flags which may be combined (bitwise or) and passed to
+ *  yajl_tree_parse_options() */
+typedef enum {
+    /** allow javascript style comments, see yajl_allow_comments.
+     *  yajl_tree_parse() always sets this flag */
+    yajl_tree_option_allow_comments = 0x01,
+    /** don't verify that strings are valid UTF8, see
+     *  yajl_dont_validate_strings */
+    yajl_tree_option_dont_validate_strings = 0x02,
+    /** allow garbage after the (last) top level value, see
+     *  yajl_allow_trailing_garbage */
+    yajl_tree_option_allow_trailing_garbage = 0x04,
+    /** accept a stream of whitespace separated top level values.  The
+     *  returned tree is then an array (yajl_t_array) holding each of the
+     *  top level values in input order, the array is empty if the input
+     *  contains no value */
+    yajl_tree_option_allow_multiple_values = 0x08,
+    /** accept input that ends inside a value.  Containers that are still
+     *  open when the input ends are closed and returned as far as they
+     *  were built, a key that has not yet received its value is dropped */
+    yajl_tree_option_allow_partial_values = 0x10
+} yajl_tree_option;
+
+/**
+ * Parse a string with options.
+ *
+ * Like yajl_tree_parse(), but the input need not be null-terminated and the
+ * parse is controlled by \em options and two limits.
+ *
+ * \param input              Pointer to utf8 JSON data.
+ * \param input_length       Number of bytes at \em input.
+ * \param options            Bitwise or of \c yajl_tree_option flags.
+ * \param max_depth          Maximum nesting depth of arrays and objects, or
+ *                           0 for no limit.  A top level array has depth 1.
+ * \param max_size           Maximum size of the input in bytes, or 0 for no
+ *                           limit.  Larger input is rejected before parsing.
+ * \param error_buffer       See yajl_tree_parse().
+ * \param error_buffer_size  See yajl_tree_parse().
+ *
+ * \returns Pointer to the top-level value or \c NULL on error, see
+ * yajl_tree_parse().  With \c yajl_tree_option_allow_multiple_values the
+ * top-level value is an array of the values read.
+ */
+YAJL_API yajl_val yajl_tree_parse_options (const char *input,
+                                           size_t input_length,
+                                           unsigned int options,
+                                           size_t max_depth,
+                                           size_t max_size,
+                                           char *error_buffer,
+                                           size_t error_buffer_size);
+
+/**
+ * Parse a string like yajl_tree_parse_options(), allocating the tree and
+ * the parser with the given routines, for instance those of a yajl_arena.
+ *
+ * \param afs  Allocation routines, or \c NULL for malloc, realloc and free.
+ *
+ * \returns Pointer to the top-level value or \c NULL on error.  Free it with
+ * yajl_tree_free_alloc() and the same routines, or with yajl_tree_free() if
+ * \em afs was \c NULL.  A tree allocated from an arena may instead be
+ * dropped with the arena.
+ */
+YAJL_API yajl_val yajl_tree_parse_alloc (const char *input,
+                                         size_t input_length,
+                                         unsigned int options,
+                                         size_t max_depth,
+                                         size_t max_size,
+                                         const yajl_alloc_funcs *afs,
+                                         char *error_buffer,
+                                         size_t error_buffer_size);
 
 /**
  * Free a parse tree returned by "yajl_tree_parse".
@@ -130,6 +202,14 @@ YAJL_API yajl_val yajl_tree_parse (const char *input,
  */
 YAJL_API void yajl_tree_free (yajl_val v);
 
+/**
+ * Free a parse tree returned by yajl_tree_parse_alloc().
+ *
+ * \param v    The tree, or \c NULL.
+ * \param afs  The allocation routines the tree was built with.
+ */
+YAJL_API void yajl_tree_free_alloc (yajl_val v, const yajl_alloc_funcs *afs);
+
 /**
  * Access a nested value inside a tree.
  *
@@ -146,6 +226,129 @@ YAJL_API void yajl_tree_free (yajl_val v);
  */
 YAJL_API yajl_val yajl_tree_get(yajl_val parent, const char ** path, yajl_type type);
 
+/**
+ * Generate a tree.
+ *
+ * Outputs \em v and everything below it as one value, from the nodes
+ * directly rather than through a call per value.  Numbers are output from
+ * their text in \c u.number.r when there is one, so they come out as they
+ * were parsed.  A \c NULL node is output as null.  With a print callback
+ * the output is passed to it in batches.
+ *
+ * \param g  The generator, which must be where a value may go.
+ * \param v  The tree, from a parse or built by the caller.
+ *
+ * \returns \c yajl_gen_status_ok, or a status like the generator routines
+ * give for a single value: \c yajl_gen_invalid_string,
+ * \c yajl_gen_invalid_number or \c yajl_max_depth_exceeded.  The output
+ * then ends part way through the value and the generator is left in an
+ * error state, a savepoint (see yajl_gen_savepoint()) taken before undoes
+ * both.
+ */
+YAJL_API yajl_gen_status yajl_tree_generate(yajl_gen g, yajl_val v);
+
+/**
+ * Parse the last elements of a document.
+ *
+ * Reads \em input from its end using yajl_rev_parse() and builds only the
+ * last \em count elements of a top level array, or with
+ * \c yajl_tree_option_allow_multiple_values the last \em count values of a
+ * stream of values (e.g. NDJSON).  Parsing stops as soon as they are read,
+ * so the part of the input before them is not looked at.
+ *
+ * \param input              Pointer to utf8 JSON data.
+ * \param input_length       Number of bytes at \em input.
+ * \param count              Maximum number of elements to return.
+ * \param options            Bitwise or of \c yajl_tree_option flags.
+ * \param error_buffer       See yajl_tree_parse().
+ * \param error_buffer_size  See yajl_tree_parse().
+ *
+ * \returns an array (yajl_t_array) of at most \em count elements in input
+ * order, so the last element of the input is last, or \c NULL on error.
+ * Free it with yajl_tree_free().
+ */
+YAJL_API yajl_val yajl_tree_parse_last (const char *input,
+                                        size_t input_length,
+                                        size_t count,
+                                        unsigned int options,
+                                        char *error_buffer,
+                                        size_t error_buffer_size);
+
+/** A streaming tree builder, see yajl_tree_stream_alloc() */
+typedef struct yajl_tree_stream_s * yajl_tree_stream;
+
+/** Called by a streaming tree builder for each completed element.
+ *
+ * \param ctx      The context pointer passed to yajl_tree_stream_alloc().
+ * \param key      The object key of the element, or \c NULL if the
+ *                 element is not a member of an object.
+ * \param element  The element.  It is freed when the callback returns.
+ *
+ * \returns zero to cancel the parse, see yajl_status_client_canceled.
+ */
+typedef int (*yajl_tree_element_func)(void *ctx, const char *key,
+                                      yajl_val element);
+
+/**
+ * Allocate a streaming tree builder.
+ *
+ * The builder is fed JSON text in chunks like yajl_parse().  Every value
+ * found at nesting level \em depth is built as a tree, passed to
+ * \em callback and freed, so memory stays bounded by the size of the
+ * largest element.  Containers above that level are not built.  Level 0 are
+ * the top level values (use \c yajl_tree_option_allow_multiple_values for a
+ * stream of them), level 1 the members of a top level array or object, and
+ * so on.
+ *
+ * \param depth     Nesting level of the elements to yield.
+ * \param path      If not \c NULL, a null terminated array of object keys
+ *                  restricting the values yielded: the n-th key must match
+ *                  the key of the enclosing value at level n.  E.g.
+ *                  { "records", NULL } with depth 2 yields the elements of
+ *                  /records only, with depth 1 it yields /records itself.
+ *                  Values in arrays never match a key.  The keys must stay
+ *                  valid while the builder is in use.
+ * \param options   Bitwise or of \c yajl_tree_option flags.
+ * \param callback  Called for each element.
+ * \param afs       Memory allocation functions for the builder and the
+ *                  elements it builds, may be \c NULL.
+ * \param ctx       Passed to \em callback.
+ *
+ * \returns a builder or \c NULL on error.  Free it with
+ * yajl_tree_stream_free().
+ */
+YAJL_API yajl_tree_stream yajl_tree_stream_alloc(size_t depth,
+                                                 const char **path,
+                                                 unsigned int options,
+                                                 yajl_tree_element_func callback,
+                                                 const yajl_alloc_funcs *afs,
+                                                 void *ctx);
+
+/** Feed a chunk of JSON text to a streaming tree builder, see
+ *  yajl_parse() */
+YAJL_API yajl_status yajl_tree_stream_parse(yajl_tree_stream s,
+                                            const unsigned char *text,
+                                            size_t len);
+
+/** Signal the end of input, see yajl_complete_parse().  With
+ *  \c yajl_tree_option_allow_partial_values an element that is cut off is
+ *  closed and yielded */
+YAJL_API yajl_status yajl_tree_stream_complete(yajl_tree_stream s);
+
+/** Get an error string describing the state of the builder, see
+ *  yajl_get_error().  Free the result with yajl_tree_stream_free_error() */
+YAJL_API unsigned char * yajl_tree_stream_get_error(yajl_tree_stream s,
+                                                    int verbose,
+                                                    const unsigned char *text,
+                                                    size_t len);
+
+/** Free an error string returned by yajl_tree_stream_get_error() */
+YAJL_API void yajl_tree_stream_free_error(yajl_tree_stream s,
+                                          unsigned char *str);
+
+/** Free a streaming tree builder and any partly built element */
+YAJL_API void yajl_tree_stream_free(yajl_tree_stream s);
+
 /* Various convenience macros to check the type of a `yajl_val` */
 #define YAJL_IS_STRING(v) (((v) != NULL) && ((v)->type == yajl_t_string))
 #define YAJL_IS_NUMBER(v) (((v) != NULL) && ((v)->type == yajl_t_number))
@@ -40,6 +40,18 @@ yajl_status_to_string(yajl_status stat)
         case yajl_status_error:
             statStr = "parse error";
             break;
+        case yajl_status_out_of_memory:
+            statStr = "out of memory";
+            break;
+        case yajl_status_max_depth_exceeded:
+            statStr = "maximum nesting depth exceeded";
+            break;
+        case yajl_status_max_token_length_exceeded:
+            statStr = "maximum token length exceeded";
+            break;
+        case yajl_status_max_bytes_exceeded:
+            statStr = "maximum input size exceeded";
+            break;
     }
     return statStr;
 }
@@ -64,6 +76,7 @@ yajl_alloc(const yajl_callbacks * callbacks,
     }
 
     hand = (yajl_handle) YA_MALLOC(afs, sizeof(struct yajl_handle_t));
+    if (hand == NULL) return NULL;
 
     /* copy in pointers to allocation routines */
     memcpy((void *) &(hand->alloc), (void *) afs, sizeof(yajl_alloc_funcs));
@@ -71,24 +84,122 @@ yajl_alloc(const yajl_callbacks * callbacks,
     hand->callbacks = callbacks;
     hand->ctx = ctx;
     hand->lexer = NULL; 
+    hand->revLexer = 0;
+    hand->parseError = NULL;
     hand->bytesConsumed = 0;
+    hand->startOffset = 0;
+    hand->endOffset = 0;
     hand->decodeBuf = yajl_buf_alloc(&(hand->alloc));
     hand->flags	    = 0;
-    yajl_bs_init(hand->stateStack, &(hand->alloc));
-    yajl_bs_push(hand->stateStack, yajl_state_start);
+    hand->maxDepth = 0;
+    hand->maxTokenLength = 0;
+    hand->maxTotalBytes = 0;
+    hand->totalBytes = 0;
+    hand->limitStatus = yajl_status_ok;
+    hand->chunkCallbacks = NULL;
+    hand->retainedChunks = NULL;
+    hand->stringCallbacks = NULL;
+    hand->streaming = 0;
+    hand->streamPendingLen = 0;
+    hand->chunkBase = 0;
+    hand->rawCallback = NULL;
+    hand->rawCapturing = 0;
+    hand->rawSavedCallbacks = NULL;
+    hand->rawDepth = 0;
+    hand->rawStart = 0;
+    hand->hashFrames = NULL;
+    hand->containerHash = 0;
+    memset((void *) &(hand->countingAlloc), 0, sizeof(yajl_counting_alloc));
+    yajl_bs_init(hand->stateStack, &(hand->alloc), yajl_state_start);
+
+    if (hand->decodeBuf == NULL) {
+        yajl_free(hand);
+        return NULL;
+    }
 
     return hand;
 }
 
+/* tell the client which chunks the parser is done with.  chunk was just
+ * parsed, it is kept along with the ones before while the lexer holds
+ * part of a token in them.  with chunk NULL every chunk is released.
+ * returns 0 if out of memory, everything is released then */
+static int
+yajl_release_chunks(yajl_handle hand, const unsigned char * chunk)
+{
+    const unsigned char ** kept;
+    const unsigned char * first = NULL;
+    size_t n, i = 0;
+
+    if (hand->retainedChunks == NULL) return 1;
+
+    kept = (const unsigned char **) yajl_buf_data(hand->retainedChunks);
+    n = yajl_buf_len(hand->retainedChunks) / sizeof(*kept);
+    if (chunk != NULL && hand->lexer != NULL) {
+        first = yajl_lex_retained_chunk(hand->lexer);
+    }
+
+    while (i < n && kept[i] != first) {
+        hand->chunkCallbacks->release(hand->ctx, kept[i++]);
+    }
+    memmove((void *) kept, (void *) (kept + i), (n - i) * sizeof(*kept));
+    yajl_buf_truncate(hand->retainedChunks, (n - i) * sizeof(*kept));
+
+    if (chunk == NULL) return 1;
+    if (first != NULL) {
+        yajl_buf_append(hand->retainedChunks, &chunk, sizeof(chunk));
+        if (!yajl_buf_err(hand->retainedChunks)) return 1;
+        yajl_release_chunks(hand, NULL);
+        yajl_buf_clear(hand->retainedChunks);
+    }
+    hand->chunkCallbacks->release(hand->ctx, chunk);
+    return first == NULL;
+}
+
 void
 yajl_reset(yajl_handle hand)
 {
+    yajl_release_chunks(hand, NULL);
+
+    /* everything allocated so far is kept for the next parse */
     if (hand->lexer) {
-        yajl_lex_reset(hand->lexer);
+        if (hand->revLexer) yajl_rev_lex_reset(hand->lexer);
+        else yajl_lex_reset(hand->lexer);
     }
+    hand->parseError = NULL;
     hand->bytesConsumed = 0;
-    yajl_bs_init(hand->stateStack, &(hand->alloc));
-    yajl_bs_push(hand->stateStack, yajl_state_start);
+    hand->startOffset = 0;
+    hand->endOffset = 0;
+    hand->totalBytes = 0;
+    hand->streaming = 0;
+    hand->streamPendingLen = 0;
+    hand->chunkBase = 0;
+    yajl_cancel_raw(hand);
+    if (hand->hashFrames != NULL) yajl_buf_clear(hand->hashFrames);
+    yajl_buf_clear(hand->decodeBuf);
+    yajl_bs_clear(hand->stateStack, yajl_state_start);
+}
+
+/* pass the lexer related flags on to an existing lexer */
+static void
+yajl_config_lexer(yajl_handle h)
+{
+    if (h->lexer == NULL) return;
+
+    if (h->revLexer) {
+        yajl_rev_lex_config(h->lexer,
+                            h->flags & yajl_allow_comments,
+                            !(h->flags & yajl_dont_validate_strings));
+        yajl_rev_lex_set_max_token_length(h->lexer, h->maxTokenLength);
+    } else {
+        yajl_lex_config(h->lexer,
+                        h->flags & yajl_allow_comments,
+                        !(h->flags & yajl_dont_validate_strings));
+        yajl_lex_set_max_token_length(h->lexer, h->maxTokenLength);
+        yajl_lex_retain_chunks(h->lexer, h->chunkCallbacks != NULL,
+                               h->chunkCallbacks != NULL &&
+                               h->chunkCallbacks->string_segments != NULL);
+    }
 }
 
 int
@@ -105,6 +216,92 @@ yajl_config(yajl_handle h, yajl_option opt, ...)
         case yajl_allow_multiple_values:
         case yajl_allow_partial_values:
         case yajl_resume_after_cancel:
+        case yajl_allow_in_place_decode:
+            if (va_arg(ap, int)) h->flags |= opt;
+            else h->flags &= ~opt;
+            yajl_config_lexer(h);
+            break;
+        case yajl_collect_stats:
+            if (va_arg(ap, int)) {
+                h->flags |= opt;
+                yajl_counting_alloc_install(&(h->countingAlloc), &(h->alloc));
+            } else {
+                h->flags &= ~opt;
+                yajl_counting_alloc_remove(&(h->countingAlloc), &(h->alloc));
+            }
+            break;
+        case yajl_max_depth:
+            h->maxDepth = va_arg(ap, size_t);
+            break;
+        case yajl_max_token_length:
+            h->maxTokenLength = va_arg(ap, size_t);
+            yajl_config_lexer(h);
+            break;
+        case yajl_max_total_bytes:
+            h->maxTotalBytes = va_arg(ap, size_t);
+            break;
+        case yajl_retain_chunks: {
+            const yajl_chunk_callbacks * cbs =
+                va_arg(ap, const yajl_chunk_callbacks *);
+            if (cbs != NULL && cbs->release == NULL) {
+                rv = 0;
+                break;
+            }
+            if (cbs != NULL && h->retainedChunks == NULL) {
+                h->retainedChunks = yajl_buf_alloc(&(h->alloc));
+                if (h->retainedChunks == NULL) {
+                    rv = 0;
+                    break;
+                }
+            }
+            /* a token being lexed is held one way or the other */
+            if (h->lexer != NULL && !h->revLexer &&
+                yajl_lex_in_token(h->lexer))
+            {
+                rv = 0;
+                break;
+            }
+            h->chunkCallbacks = cbs;
+            yajl_config_lexer(h);
+            break;
+        }
+        case yajl_stream_strings: {
+            const yajl_string_callbacks * cbs =
+                va_arg(ap, const yajl_string_callbacks *);
+            if (cbs != NULL &&
+                (!(cbs->yajl_string_begin == NULL) !=
+                 !(cbs->yajl_string_segment == NULL) ||
+                 !(cbs->yajl_string_begin == NULL) !=
+                 !(cbs->yajl_string_end == NULL) ||
+                 !(cbs->yajl_map_key_begin == NULL) !=
+                 !(cbs->yajl_map_key_segment == NULL) ||
+                 !(cbs->yajl_map_key_begin == NULL) !=
+                 !(cbs->yajl_map_key_end == NULL)))
+            {
+                rv = 0;
+                break;
+            }
+            /* not while a string is being streamed */
+            if (h->streaming) {
+                rv = 0;
+                break;
+            }
+            h->stringCallbacks = cbs;
+            break;
+        }
+        case yajl_hash_containers:
+            /* the hashes follow the nesting from the top */
+            if (yajl_bs_depth(h->stateStack) != 0) {
+                rv = 0;
+                break;
+            }
+            if (h->hashFrames == NULL) {
+                h->hashFrames = yajl_buf_alloc(&(h->alloc));
+                if (h->hashFrames == NULL) {
+                    rv = 0;
+                    break;
+                }
+            }
             if (va_arg(ap, int)) h->flags |= opt;
             else h->flags &= ~opt;
             break;
@@ -116,32 +313,210 @@ yajl_config(yajl_handle h, yajl_option opt, ...)
     return rv;
 }
 
+static void
+yajl_free_lexer(yajl_handle handle)
+{
+    if (handle->lexer) {
+        if (handle->revLexer) yajl_rev_lex_free(handle->lexer);
+        else yajl_lex_free(handle->lexer);
+        handle->lexer = NULL;
+    }
+}
+
 void
 yajl_free(yajl_handle handle)
 {
+    yajl_release_chunks(handle, NULL);
+    yajl_buf_free(handle->retainedChunks);
+    yajl_buf_free(handle->hashFrames);
     yajl_bs_free(handle->stateStack);
     yajl_buf_free(handle->decodeBuf);
-    if (handle->lexer) {
-        yajl_lex_free(handle->lexer);
-        handle->lexer = NULL;
-    }
+    yajl_free_lexer(handle);
     YA_FREE(&(handle->alloc), handle);
 }
 
+void
+yajl_get_stats(yajl_handle hand, yajl_stats * stats)
+{
+    size_t capacity;
+
+    if (hand->flags & yajl_collect_stats) {
+        *stats = hand->countingAlloc.stats;
+    } else {
+        memset((void *) stats, 0, sizeof(yajl_stats));
+    }
+
+    capacity = yajl_buf_peak_capacity(hand->decodeBuf);
+    if (capacity > stats->peakBufCapacity) stats->peakBufCapacity = capacity;
+    stats->decodeBufGrows = yajl_buf_grows(hand->decodeBuf);
+    stats->bufGrows += stats->decodeBufGrows;
+    stats->stackGrows = hand->stateStack.grows;
+
+    if (hand->lexer) {
+        if (hand->revLexer) yajl_rev_lex_get_stats(hand->lexer, stats);
+        else yajl_lex_get_stats(hand->lexer, stats);
+    }
+}
+
+struct yajl_handle_pool_t {
+    const yajl_callbacks * callbacks;
+    yajl_alloc_funcs alloc;
+    /* idle handles */
+    yajl_handle * handles;
+    size_t used;
+    size_t size;
+};
+
+yajl_handle_pool
+yajl_handle_pool_alloc(const yajl_callbacks * callbacks,
+                       yajl_alloc_funcs * afs, size_t maxIdle)
+{
+    yajl_handle_pool pool;
+    yajl_alloc_funcs afsBuffer;
+
+    if (afs != NULL) {
+        if (afs->malloc == NULL || afs->realloc == NULL || afs->free == NULL)
+        {
+            return NULL;
+        }
+    } else {
+        yajl_set_default_alloc_funcs(&afsBuffer);
+        afs = &afsBuffer;
+    }
+
+    pool = (yajl_handle_pool) YA_MALLOC(afs, sizeof(struct yajl_handle_pool_t));
+    if (pool == NULL) return NULL;
+
+    pool->callbacks = callbacks;
+    pool->alloc = *afs;
+    pool->used = 0;
+    pool->size = maxIdle;
+    pool->handles = NULL;
+    if (maxIdle > 0) {
+        pool->handles = (yajl_handle *) YA_MALLOC(afs, maxIdle * sizeof(yajl_handle));
+        if (pool->handles == NULL) {
+            YA_FREE(afs, pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+yajl_handle
+yajl_handle_pool_get(yajl_handle_pool pool, void * ctx)
+{
+    yajl_handle hand;
+
+    if (pool->used == 0) {
+        return yajl_alloc(pool->callbacks, &(pool->alloc), ctx);
+    }
+
+    hand = pool->handles[--(pool->used)];
+    hand->ctx = ctx;
+    yajl_config(hand, yajl_collect_stats, 0);
+    hand->flags = 0;
+    hand->maxDepth = 0;
+    hand->maxTokenLength = 0;
+    hand->maxTotalBytes = 0;
+    hand->chunkCallbacks = NULL;
+    hand->stringCallbacks = NULL;
+    yajl_config_lexer(hand);
+
+    return hand;
+}
+
+void
+yajl_handle_pool_put(yajl_handle_pool pool, yajl_handle hand)
+{
+    if (hand == NULL) return;
+
+    if (pool->used == pool->size) {
+        yajl_free(hand);
+        return;
+    }
+
+    yajl_reset(hand);
+    pool->handles[(pool->used)++] = hand;
+}
+
+void
+yajl_handle_pool_free(yajl_handle_pool pool)
+{
+    if (pool == NULL) return;
+
+    while (pool->used > 0) {
+        yajl_free(pool->handles[--(pool->used)]);
+    }
+    if (pool->handles) YA_FREE(&(pool->alloc), pool->handles);
+    YA_FREE(&(pool->alloc), pool);
+}
+
+/* The lexer is lazy allocated in the first call to parse, and kept across
+ * yajl_reset().  A handle that switches between forward and reverse parsing
+ * needs the other kind of lexer. */
+static int
+yajl_ensure_lexer(yajl_handle hand, unsigned int reverse)
+{
+    if (hand->lexer != NULL && hand->revLexer != reverse) {
+        yajl_free_lexer(hand);
+    }
+    if (hand->lexer == NULL) {
+        if (reverse) {
+            hand->lexer = yajl_rev_lex_alloc(&(hand->alloc),
+                                             hand->flags & yajl_allow_comments,
+                                             !(hand->flags & yajl_dont_validate_strings));
+        } else {
+            hand->lexer = yajl_lex_alloc(&(hand->alloc),
+                                         hand->flags & yajl_allow_comments,
+                                         !(hand->flags & yajl_dont_validate_strings));
+        }
+        hand->revLexer = reverse;
+        if (hand->lexer == NULL) {
+            yajl_bs_set(hand->stateStack, yajl_state_memory_error);
+            return 0;
+        }
+        yajl_config_lexer(hand);
+    }
+    return 1;
+}
+
+yajl_status
+yajl_parse_prepare(yajl_handle hand, size_t jsonTextLen,
+                   unsigned int reverse)
+{
+    if (!yajl_ensure_lexer(hand, reverse)) return yajl_status_out_of_memory;
+
+    /* count the input against the yajl_max_total_bytes option */
+    hand->chunkBase = hand->totalBytes;
+    hand->totalBytes += jsonTextLen;
+    if (hand->maxTotalBytes != 0 && hand->totalBytes > hand->maxTotalBytes) {
+        hand->bytesConsumed = 0;
+        yajl_set_limit_error(hand, yajl_status_max_bytes_exceeded);
+        return yajl_status_max_bytes_exceeded;
+    }
+    return yajl_status_ok;
+}
+
 yajl_status
 yajl_parse(yajl_handle hand, const unsigned char * jsonText,
            size_t jsonTextLen)
 {
     yajl_status status;
 
-    /* lazy allocation of the lexer */
-    if (hand->lexer == NULL) {
-        hand->lexer = yajl_lex_alloc(&(hand->alloc),
-                                     hand->flags & yajl_allow_comments,
-                                     !(hand->flags & yajl_dont_validate_strings));
+    status = yajl_parse_prepare(hand, jsonTextLen, 0);
+    if (status != yajl_status_ok) {
+        if (hand->chunkCallbacks) {
+            hand->chunkCallbacks->release(hand->ctx, jsonText);
+        }
+        return status;
     }
 
     status = yajl_do_parse(hand, jsonText, jsonTextLen);
+    if (hand->chunkCallbacks && !yajl_release_chunks(hand, jsonText)) {
+        yajl_bs_set(hand->stateStack, yajl_state_memory_error);
+        return yajl_status_out_of_memory;
+    }
     return status;
 }
 
@@ -151,12 +526,8 @@ yajl_rev_parse(yajl_handle hand, const unsigned char * jsonText,
 {
     yajl_status status;
 
-    /* lazy allocation of the lexer */
-    if (hand->lexer == NULL) {
-        hand->lexer = yajl_rev_lex_alloc(&(hand->alloc),
-                                         hand->flags & yajl_allow_comments,
-                                         !(hand->flags & yajl_dont_validate_strings));
-    }
+    status = yajl_parse_prepare(hand, jsonTextLen, 1);
+    if (status != yajl_status_ok) return status;
 
     status = yajl_rev_do_parse(hand, jsonText + jsonTextLen, -jsonTextLen);
     return status;
@@ -165,19 +536,19 @@ yajl_rev_parse(yajl_handle hand, const unsigned char * jsonText,
 yajl_status
 yajl_complete_parse(yajl_handle hand)
 {
+    yajl_status status;
+
     /* The lexer is lazy allocated in the first call to parse.  if parse is
      * never called, then no data was provided to parse at all.  This is a
      * "premature EOF" error unless yajl_allow_partial_values is specified.
      * allocating the lexer now is the simplest possible way to handle this
      * case while preserving all the other semantics of the parser
      * (multiple values, partial values, etc). */
-    if (hand->lexer == NULL) {
-        hand->lexer = yajl_lex_alloc(&(hand->alloc),
-                                     hand->flags & yajl_allow_comments,
-                                     !(hand->flags & yajl_dont_validate_strings));
-    }
+    if (!yajl_ensure_lexer(hand, 0)) return yajl_status_out_of_memory;
 
-    return yajl_do_finish(hand);
+    status = yajl_do_finish(hand);
+    yajl_release_chunks(hand, NULL);
+    return status;
 }
 
 yajl_status
@@ -189,11 +560,7 @@ yajl_rev_complete_parse(yajl_handle hand)
      * allocating the lexer now is the simplest possible way to handle this
      * case while preserving all the other semantics of the parser
      * (multiple values, partial values, etc). */
-    if (hand->lexer == NULL) {
-        hand->lexer = yajl_rev_lex_alloc(&(hand->alloc),
-                                         hand->flags & yajl_allow_comments,
-                                         !(hand->flags & yajl_dont_validate_strings));
-    }
+    if (!yajl_ensure_lexer(hand, 1)) return yajl_status_out_of_memory;
 
     return yajl_rev_do_finish(hand);
 }
@@ -224,6 +591,20 @@ yajl_get_end_offset(yajl_handle hand)
     return hand->endOffset;
 }
 
+int
+yajl_capture_raw_value(yajl_handle hand, yajl_raw_value_callback cb)
+{
+    if (hand->rawCallback != NULL) return 0;
+    hand->rawCallback = cb;
+    return 1;
+}
+
+unsigned long long
+yajl_get_container_hash(yajl_handle hand)
+{
+    return hand->containerHash;
+}
+
 
 void
 yajl_free_error(yajl_handle hand, unsigned char * str)
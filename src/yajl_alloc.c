@@ -22,6 +22,7 @@
 
 #include "yajl_alloc.h"
 #include <stdlib.h>
+#include <string.h>
 
 static void * yajl_internal_malloc(void *ctx, size_t sz)
 {
@@ -50,3 +51,50 @@ void yajl_set_default_alloc_funcs(yajl_alloc_funcs * yaf)
     yaf->ctx = NULL;
 }
 
+static void * yajl_counting_malloc(void *ctx, size_t sz)
+{
+    yajl_counting_alloc * ca = (yajl_counting_alloc *) ctx;
+    ca->stats.mallocs++;
+    ca->stats.bytes += sz;
+    return YA_MALLOC(&(ca->funcs), sz);
+}
+
+static void * yajl_counting_realloc(void *ctx, void * previous,
+                                    size_t sz)
+{
+    yajl_counting_alloc * ca = (yajl_counting_alloc *) ctx;
+    ca->stats.reallocs++;
+    ca->stats.bytes += sz;
+    return YA_REALLOC(&(ca->funcs), previous, sz);
+}
+
+static void yajl_counting_free(void *ctx, void * ptr)
+{
+    yajl_counting_alloc * ca = (yajl_counting_alloc *) ctx;
+    ca->stats.frees++;
+    /* note: ptr may be the memory holding ca */
+    ca->funcs.free(ca->funcs.ctx, ptr);
+}
+
+void yajl_counting_alloc_install(yajl_counting_alloc * ca,
+                                 yajl_alloc_funcs * yaf)
+{
+    /* installed already: only start the counters afresh */
+    memset((void *) &(ca->stats), 0, sizeof(ca->stats));
+    if (yaf->malloc == yajl_counting_malloc) return;
+
+    ca->funcs = *yaf;
+    yaf->malloc = yajl_counting_malloc;
+    yaf->realloc = yajl_counting_realloc;
+    yaf->free = yajl_counting_free;
+    yaf->ctx = ca;
+}
+
+void yajl_counting_alloc_remove(yajl_counting_alloc * ca,
+                                yajl_alloc_funcs * yaf)
+{
+    if (yaf->malloc != yajl_counting_malloc) return;
+
+    *yaf = ca->funcs;
+}
+
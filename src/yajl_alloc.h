@@ -31,4 +31,20 @@
 
 void yajl_set_default_alloc_funcs(yajl_alloc_funcs * yaf);
 
+/* allocation routines which count calls and bytes in stats before passing
+ * them on to funcs */
+typedef struct {
+    yajl_alloc_funcs funcs;
+    yajl_stats stats;
+} yajl_counting_alloc;
+
+/* replace *yaf with routines counting into ca, which is initialized with
+ * the routines replaced and zeroed counters */
+void yajl_counting_alloc_install(yajl_counting_alloc * ca,
+                                 yajl_alloc_funcs * yaf);
+
+/* put the routines replaced by yajl_counting_alloc_install back */
+void yajl_counting_alloc_remove(yajl_counting_alloc * ca,
+                                yajl_alloc_funcs * yaf);
+
 #endif
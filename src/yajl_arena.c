@@ -0,0 +1,447 @@
+/*
+ * Copyright (c) 2007-2014, Lloyd Hilaiel <me@lloyd.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "api/yajl_arena.h"
+#include "yajl_alloc.h"
+
+#include <string.h>
+
+#define YAJL_ARENA_CHUNK_SIZE 32768
+#define YAJL_POOL_SLAB_SIZE 65536
+#define YAJL_POOL_MIN_CLASS 16
+#define YAJL_POOL_CLASSES 9 /* 16 .. 4096 bytes */
+
+#if defined(_MSC_VER)
+#  define YAJL_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+#  define YAJL_THREAD_LOCAL __thread
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L \
+    && !defined(__STDC_NO_THREADS__)
+#  define YAJL_THREAD_LOCAL _Thread_local
+#endif
+
+/* every block starts on a multiple of the strictest alignment, and is
+ * preceded by a header holding its capacity so that realloc knows how
+ * much to copy */
+typedef union {
+    long long l;
+    long double d;
+    void * p;
+} yajl_align_t;
+
+#define ALIGN_UP(n) \
+    (((n) + sizeof(yajl_align_t) - 1) / sizeof(yajl_align_t) \
+     * sizeof(yajl_align_t))
+#define HDR_SIZE ALIGN_UP(sizeof(size_t))
+#define BLOCK_CAP(ptr) (*(size_t *) ((char *) (ptr) - HDR_SIZE))
+
+/* no allocation to roll back or extend in a chunk */
+#define NO_LAST ((size_t) -1)
+
+typedef struct yajl_arena_chunk_t {
+    struct yajl_arena_chunk_t * next;
+    size_t size;
+    size_t used;
+    /* offset of the most recent allocation */
+    size_t last;
+} yajl_arena_chunk;
+
+#define CHUNK_DATA(c) ((char *) (c) + ALIGN_UP(sizeof(yajl_arena_chunk)))
+
+struct yajl_arena_t {
+    /* routines the chunks come from */
+    yajl_alloc_funcs alloc;
+    /* routines handed out, with ctx pointing back here */
+    yajl_alloc_funcs funcs;
+    /* the chunk allocated from, followed by full and oversized ones */
+    yajl_arena_chunk * chunks;
+    size_t chunkSize;
+};
+
+static yajl_arena_chunk *
+yajl_arena_new_chunk(yajl_arena a, size_t size)
+{
+    yajl_arena_chunk * c = (yajl_arena_chunk *)
+        YA_MALLOC(&(a->alloc), ALIGN_UP(sizeof(yajl_arena_chunk)) + size);
+    if (c == NULL) return NULL;
+
+    c->size = size;
+    c->used = 0;
+    c->last = NO_LAST;
+    return c;
+}
+
+static int
+yajl_arena_is_last(yajl_arena_chunk * c, void * ptr)
+{
+    return c != NULL && c->last != NO_LAST
+        && (char *) ptr == CHUNK_DATA(c) + c->last + HDR_SIZE;
+}
+
+static void *
+yajl_arena_malloc(void * ctx, size_t sz)
+{
+    yajl_arena a = (yajl_arena) ctx;
+    yajl_arena_chunk * c = a->chunks;
+    size_t need = HDR_SIZE + ALIGN_UP(sz);
+    char * p;
+
+    if (c == NULL || c->size - c->used < need) {
+        if (need > a->chunkSize) {
+            /* oversized: a chunk of its own, kept behind the current one
+             * so the space left there is not lost */
+            c = yajl_arena_new_chunk(a, need);
+            if (c == NULL) return NULL;
+            if (a->chunks != NULL) {
+                c->next = a->chunks->next;
+                a->chunks->next = c;
+            } else {
+                c->next = NULL;
+                a->chunks = c;
+            }
+        } else {
+            c = yajl_arena_new_chunk(a, a->chunkSize);
+            if (c == NULL) return NULL;
+            c->next = a->chunks;
+            a->chunks = c;
+        }
+    }
+
+    p = CHUNK_DATA(c) + c->used;
+    *(size_t *) p = need - HDR_SIZE;
+    c->last = c->used;
+    c->used += need;
+
+    return p + HDR_SIZE;
+}
+
+static void
+yajl_arena_free_block(void * ctx, void * ptr)
+{
+    yajl_arena a = (yajl_arena) ctx;
+
+    /* only the most recent allocation can be given back */
+    if (ptr != NULL && yajl_arena_is_last(a->chunks, ptr)) {
+        a->chunks->used = a->chunks->last;
+        a->chunks->last = NO_LAST;
+    }
+}
+
+static void *
+yajl_arena_realloc(void * ctx, void * ptr, size_t sz)
+{
+    yajl_arena a = (yajl_arena) ctx;
+    yajl_arena_chunk * c = a->chunks;
+    size_t cap;
+    void * n;
+
+    if (ptr == NULL) return yajl_arena_malloc(ctx, sz);
+
+    cap = BLOCK_CAP(ptr);
+
+    /* the most recent allocation grows or shrinks in place */
+    if (yajl_arena_is_last(c, ptr)
+        && c->size - c->last >= HDR_SIZE + ALIGN_UP(sz))
+    {
+        BLOCK_CAP(ptr) = ALIGN_UP(sz);
+        c->used = c->last + HDR_SIZE + ALIGN_UP(sz);
+        return ptr;
+    }
+
+    if (sz <= cap) return ptr;
+
+    n = yajl_arena_malloc(ctx, sz);
+    if (n == NULL) return NULL;
+    memcpy(n, ptr, cap);
+    return n;
+}
+
+yajl_arena
+yajl_arena_alloc(const yajl_alloc_funcs * afs, size_t chunkSize)
+{
+    yajl_alloc_funcs afsBuffer;
+    yajl_arena a;
+
+    if (afs != NULL) {
+        if (afs->malloc == NULL || afs->realloc == NULL || afs->free == NULL)
+        {
+            return NULL;
+        }
+    } else {
+        yajl_set_default_alloc_funcs(&afsBuffer);
+        afs = &afsBuffer;
+    }
+
+    a = (yajl_arena) YA_MALLOC(afs, sizeof(struct yajl_arena_t));
+    if (a == NULL) return NULL;
+
+    a->alloc = *afs;
+    a->funcs.malloc = yajl_arena_malloc;
+    a->funcs.realloc = yajl_arena_realloc;
+    a->funcs.free = yajl_arena_free_block;
+    a->funcs.ctx = a;
+    a->chunks = NULL;
+    a->chunkSize = chunkSize ? ALIGN_UP(chunkSize) : YAJL_ARENA_CHUNK_SIZE;
+
+    return a;
+}
+
+const yajl_alloc_funcs *
+yajl_arena_funcs(yajl_arena a)
+{
+    return &(a->funcs);
+}
+
+void
+yajl_arena_reset(yajl_arena a)
+{
+    yajl_arena_chunk * c = a->chunks;
+    yajl_arena_chunk * keep = NULL;
+
+    while (c != NULL) {
+        yajl_arena_chunk * next = c->next;
+        if (keep == NULL && c->size == a->chunkSize) {
+            keep = c;
+        } else {
+            YA_FREE(&(a->alloc), c);
+        }
+        c = next;
+    }
+
+    if (keep != NULL) {
+        keep->next = NULL;
+        keep->used = 0;
+        keep->last = NO_LAST;
+    }
+    a->chunks = keep;
+}
+
+void
+yajl_arena_free(yajl_arena a)
+{
+    if (a == NULL) return;
+
+    yajl_arena_reset(a);
+    if (a->chunks != NULL) YA_FREE(&(a->alloc), a->chunks);
+    YA_FREE(&(a->alloc), a);
+}
+
+/* the pool carves small blocks from slabs, a block on a free list holds
+ * the link to the next one */
+typedef struct yajl_pool_slab_t {
+    struct yajl_pool_slab_t * next;
+} yajl_pool_slab;
+
+#define SLAB_DATA(s) ((char *) (s) + ALIGN_UP(sizeof(yajl_pool_slab)))
+#define CLASS_SIZE(i) ((size_t) YAJL_POOL_MIN_CLASS << (i))
+#define MAX_CLASS_SIZE CLASS_SIZE(YAJL_POOL_CLASSES - 1)
+
+struct yajl_pool_t {
+    yajl_alloc_funcs alloc;
+    yajl_alloc_funcs funcs;
+    void * freeLists[YAJL_POOL_CLASSES];
+    yajl_pool_slab * slabs;
+    /* unused space at the end of the newest slab */
+    char * cur;
+    size_t left;
+};
+
+static unsigned int
+yajl_pool_class(size_t sz)
+{
+    unsigned int i = 0;
+    while (CLASS_SIZE(i) < sz) i++;
+    return i;
+}
+
+static void *
+yajl_pool_malloc(void * ctx, size_t sz)
+{
+    yajl_pool p = (yajl_pool) ctx;
+    unsigned int i;
+    size_t need;
+    char * b;
+
+    if (sz > MAX_CLASS_SIZE) {
+        b = (char *) YA_MALLOC(&(p->alloc), HDR_SIZE + sz);
+        if (b == NULL) return NULL;
+        *(size_t *) b = sz;
+        return b + HDR_SIZE;
+    }
+
+    i = yajl_pool_class(sz);
+    if (p->freeLists[i] != NULL) {
+        b = (char *) p->freeLists[i];
+        p->freeLists[i] = *(void **) b;
+        return b;
+    }
+
+    need = HDR_SIZE + CLASS_SIZE(i);
+    if (p->left < need) {
+        yajl_pool_slab * s = (yajl_pool_slab *)
+            YA_MALLOC(&(p->alloc),
+                      ALIGN_UP(sizeof(yajl_pool_slab)) + YAJL_POOL_SLAB_SIZE);
+        if (s == NULL) return NULL;
+        s->next = p->slabs;
+        p->slabs = s;
+        p->cur = SLAB_DATA(s);
+        p->left = YAJL_POOL_SLAB_SIZE;
+    }
+
+    b = p->cur;
+    *(size_t *) b = CLASS_SIZE(i);
+    p->cur += need;
+    p->left -= need;
+
+    return b + HDR_SIZE;
+}
+
+static void
+yajl_pool_free_block(void * ctx, void * ptr)
+{
+    yajl_pool p = (yajl_pool) ctx;
+    size_t cap;
+    unsigned int i;
+
+    if (ptr == NULL) return;
+
+    cap = BLOCK_CAP(ptr);
+    if (cap > MAX_CLASS_SIZE) {
+        YA_FREE(&(p->alloc), (char *) ptr - HDR_SIZE);
+        return;
+    }
+
+    i = yajl_pool_class(cap);
+    *(void **) ptr = p->freeLists[i];
+    p->freeLists[i] = ptr;
+}
+
+static void *
+yajl_pool_realloc(void * ctx, void * ptr, size_t sz)
+{
+    yajl_pool p = (yajl_pool) ctx;
+    size_t cap;
+    void * n;
+
+    if (ptr == NULL) return yajl_pool_malloc(ctx, sz);
+
+    cap = BLOCK_CAP(ptr);
+    if (sz <= cap) return ptr;
+
+    if (cap > MAX_CLASS_SIZE) {
+        char * b = (char *) YA_REALLOC(&(p->alloc), (char *) ptr - HDR_SIZE,
+                                       HDR_SIZE + sz);
+        if (b == NULL) return NULL;
+        *(size_t *) b = sz;
+        return b + HDR_SIZE;
+    }
+
+    n = yajl_pool_malloc(ctx, sz);
+    if (n == NULL) return NULL;
+    memcpy(n, ptr, cap);
+    yajl_pool_free_block(ctx, ptr);
+    return n;
+}
+
+yajl_pool
+yajl_pool_alloc(const yajl_alloc_funcs * afs)
+{
+    yajl_alloc_funcs afsBuffer;
+    yajl_pool p;
+
+    if (afs != NULL) {
+        if (afs->malloc == NULL || afs->realloc == NULL || afs->free == NULL)
+        {
+            return NULL;
+        }
+    } else {
+        yajl_set_default_alloc_funcs(&afsBuffer);
+        afs = &afsBuffer;
+    }
+
+    p = (yajl_pool) YA_MALLOC(afs, sizeof(struct yajl_pool_t));
+    if (p == NULL) return NULL;
+    memset((void *) p, 0, sizeof(struct yajl_pool_t));
+
+    p->alloc = *afs;
+    p->funcs.malloc = yajl_pool_malloc;
+    p->funcs.realloc = yajl_pool_realloc;
+    p->funcs.free = yajl_pool_free_block;
+    p->funcs.ctx = p;
+
+    return p;
+}
+
+const yajl_alloc_funcs *
+yajl_pool_funcs(yajl_pool p)
+{
+    return &(p->funcs);
+}
+
+void
+yajl_pool_free(yajl_pool p)
+{
+    if (p == NULL) return;
+
+    while (p->slabs != NULL) {
+        yajl_pool_slab * next = p->slabs->next;
+        YA_FREE(&(p->alloc), p->slabs);
+        p->slabs = next;
+    }
+    YA_FREE(&(p->alloc), p);
+}
+
+#ifdef YAJL_THREAD_LOCAL
+
+static YAJL_THREAD_LOCAL yajl_arena threadArena;
+static YAJL_THREAD_LOCAL yajl_pool threadPool;
+
+yajl_arena
+yajl_arena_thread(void)
+{
+    if (threadArena == NULL) threadArena = yajl_arena_alloc(NULL, 0);
+    return threadArena;
+}
+
+void
+yajl_arena_thread_free(void)
+{
+    yajl_arena_free(threadArena);
+    threadArena = NULL;
+}
+
+yajl_pool
+yajl_pool_thread(void)
+{
+    if (threadPool == NULL) threadPool = yajl_pool_alloc(NULL);
+    return threadPool;
+}
+
+void
+yajl_pool_thread_free(void)
+{
+    yajl_pool_free(threadPool);
+    threadPool = NULL;
+}
+
+#else
+
+yajl_arena yajl_arena_thread(void) { return NULL; }
+void yajl_arena_thread_free(void) { }
+yajl_pool yajl_pool_thread(void) { return NULL; }
+void yajl_pool_thread_free(void) { }
+
+#endif
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2007-2014, Lloyd Hilaiel <me@lloyd.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * A header only implementation of a stack of nesting levels, used in YAJL
+ * to maintain parse and generation state.  Only the innermost level has a
+ * full state, held in a register.  The levels around it keep one bit
+ * saying whether they are a map or an array, since a level is always
+ * advanced past a container before the container is entered, and so the
+ * state it returns to follows from its kind.  The first YAJL_BS_INLINE
+ * levels live in the structure itself, deeper ones in memory allocated as
+ * needed.
+ */
+
+#ifndef __YAJL_BITSTACK_H__
+#define __YAJL_BITSTACK_H__
+
+#include "api/yajl_common.h"
+
+#include <string.h>
+
+/* levels held without allocating, a multiple of 8 */
+#define YAJL_BS_INLINE 128
+/* bytes added to the allocated part when it is full */
+#define YAJL_BS_INC 16
+
+typedef struct yajl_bitstack_t
+{
+    /* state of the innermost level */
+    unsigned char current;
+    /* state of the innermost level while a lookahead state is pushed */
+    unsigned char saved;
+    /* a push failed to allocate memory since the last clear */
+    unsigned char err;
+    /* the number of containers entered, each has a bit, set for maps */
+    size_t depth;
+    unsigned char bits[YAJL_BS_INLINE / 8];
+    /* bits of the levels beyond YAJL_BS_INLINE */
+    unsigned char * heap;
+    size_t heapSize;
+    yajl_alloc_funcs * yaf;
+    /* number of times the stack grew, for statistics */
+    size_t grows;
+} yajl_bitstack;
+
+/* initialize a bitstack, with state as the state of the top level */
+#define yajl_bs_init(obs, _yaf, state) {        \
+        (obs).current = (state);                \
+        (obs).saved = (state);                  \
+        (obs).err = 0;                          \
+        (obs).depth = 0;                        \
+        (obs).heap = NULL;                      \
+        (obs).heapSize = 0;                     \
+        (obs).yaf = (_yaf);                     \
+        (obs).grows = 0;                        \
+    }
+
+/* empty a bitstack, keeping its memory */
+#define yajl_bs_clear(obs, state) {             \
+        (obs).current = (state);                \
+        (obs).err = 0;                          \
+        (obs).depth = 0;                        \
+    }
+
+/* free a bitstack */
+#define yajl_bs_free(obs)                 \
+    if ((obs).heap) (obs).yaf->free((obs).yaf->ctx, (obs).heap);
+
+#define yajl_bs_current(obs) ((obs).current)
+
+#define yajl_bs_set(obs, state) ((obs).current = (unsigned char) (state))
+
+/* the byte holding the bit of container i, counting from 0 outermost */
+#define yajl_bs_byte(obs, i)                                    \
+    ((i) < YAJL_BS_INLINE ? &(obs).bits[(i) >> 3]               \
+                          : &(obs).heap[((i) - YAJL_BS_INLINE) >> 3])
+
+#define yajl_bs_is_map(obs, i) ((*yajl_bs_byte(obs, i) >> ((i) & 7)) & 1)
+
+/* enter a container, whose first state is state.  If the stack can't grow
+ * it is left as it is and yajl_bs_err() becomes true */
+#define yajl_bs_push(obs, state, isMap) {                               \
+    size_t _d = (obs).depth;                                            \
+    if (_d == YAJL_BS_INLINE + ((obs).heapSize << 3)) {                 \
+        unsigned char * _h = (unsigned char *)                          \
+            (obs).yaf->realloc((obs).yaf->ctx, (void *) (obs).heap,     \
+                               (obs).heapSize + YAJL_BS_INC);           \
+        if (_h != NULL) {                                               \
+            (obs).heap = _h;                                            \
+            (obs).heapSize += YAJL_BS_INC;                              \
+            (obs).grows++;                                              \
+        }                                                               \
+    }                                                                   \
+    if (_d == YAJL_BS_INLINE + ((obs).heapSize << 3)) (obs).err = 1;    \
+    else {                                                              \
+        unsigned char * _b = yajl_bs_byte(obs, _d);                     \
+        unsigned char _m = (unsigned char) (1 << (_d & 7));             \
+        if (isMap) *_b |= _m;                                           \
+        else *_b &= (unsigned char) ~_m;                                \
+        (obs).depth = _d + 1;                                           \
+        (obs).current = (unsigned char) (state);                        \
+    }                                                                   \
+}
+
+/* leave a container, the enclosing level gets topState, mapState or
+ * arrayState depending on its kind */
+#define yajl_bs_pop(obs, topState, mapState, arrayState) {              \
+    size_t _d = --((obs).depth);                                        \
+    (obs).current = (unsigned char)                                     \
+        (_d == 0 ? (topState) :                                         \
+         yajl_bs_is_map(obs, _d - 1) ? (mapState) : (arrayState));      \
+}
+
+/* replace the innermost state by state until yajl_bs_pop_lookahead(), so
+ * the level is kept as it was.  Lookahead states don't nest */
+#define yajl_bs_push_lookahead(obs, state) {                            \
+    (obs).saved = (obs).current;                                        \
+    (obs).current = (unsigned char) (state);                            \
+}
+
+#define yajl_bs_pop_lookahead(obs) { (obs).current = (obs).saved; }
+
+#define yajl_bs_err(obs) ((obs).err)
+
+/* the number of containers entered */
+#define yajl_bs_depth(obs) ((obs).depth)
+
+/* the bytes of the heap in use, which together with bits, depth and
+ * current make up everything needed to restore the stack */
+#define yajl_bs_heap_used(obs)                                          \
+    ((obs).depth > YAJL_BS_INLINE ?                                     \
+     ((obs).depth - YAJL_BS_INLINE + 7) >> 3 : 0)
+
+/* make dst hold the levels of src, with state as the innermost state.  If
+ * dst can't grow it is left as it is and yajl_bs_err() becomes true */
+#define yajl_bs_copy(dst, src, state) {                                 \
+    size_t _n = yajl_bs_heap_used(src);                                 \
+    if (_n > (dst).heapSize) {                                          \
+        unsigned char * _h = (unsigned char *)                          \
+            (dst).yaf->realloc((dst).yaf->ctx, (void *) (dst).heap,     \
+                               _n);                                     \
+        if (_h != NULL) {                                               \
+            (dst).heap = _h;                                            \
+            (dst).heapSize = _n;                                        \
+            (dst).grows++;                                              \
+        }                                                               \
+    }                                                                   \
+    if (_n > (dst).heapSize) (dst).err = 1;                             \
+    else {                                                              \
+        memcpy((dst).bits, (src).bits, sizeof((dst).bits));             \
+        if (_n > 0) memcpy((dst).heap, (src).heap, _n);                 \
+        (dst).depth = (src).depth;                                      \
+        (dst).current = (unsigned char) (state);                        \
+    }                                                                   \
+}
+
+#endif
@@ -27,35 +27,55 @@ struct yajl_buf_t {
     size_t used;
     unsigned char * data;
     yajl_alloc_funcs * alloc;
+    /* number of times the buffer grew and the largest len it had, for
+     * statistics */
+    size_t grows;
+    size_t peak;
+    /* an allocation failed since the last clear */
+    int err;
 };
 
 static
-void yajl_buf_ensure_available(yajl_buf buf, size_t want)
+int yajl_buf_ensure_available(yajl_buf buf, size_t want)
 {
     size_t need;
+    unsigned char * data;
     
     assert(buf != NULL);
 
     /* first call */
     if (buf->len == 0) {
+        data = (unsigned char *) YA_MALLOC(buf->alloc, YAJL_BUF_INIT_SIZE);
+        if (data == NULL) return 0;
+        buf->data = data;
         buf->len = YAJL_BUF_INIT_SIZE;
-        buf->data = (unsigned char *) YA_MALLOC(buf->alloc, buf->len);
         buf->data[0] = 0;
+        buf->grows++;
+        if (buf->len > buf->peak) buf->peak = buf->len;
     }
 
     need = buf->len;
 
-    while (want >= (need - buf->used)) need <<= 1;
+    while (want >= (need - buf->used)) {
+        if (need << 1 < need) return 0;
+        need <<= 1;
+    }
 
     if (need != buf->len) {
-        buf->data = (unsigned char *) YA_REALLOC(buf->alloc, buf->data, need);
+        data = (unsigned char *) YA_REALLOC(buf->alloc, buf->data, need);
+        if (data == NULL) return 0;
+        buf->data = data;
         buf->len = need;
+        buf->grows++;
+        if (buf->len > buf->peak) buf->peak = buf->len;
     }
+    return 1;
 }
 
 yajl_buf yajl_buf_alloc(yajl_alloc_funcs * alloc)
 {
     yajl_buf b = YA_MALLOC(alloc, sizeof(struct yajl_buf_t));
+    if (b == NULL) return NULL;
     memset((void *) b, 0, sizeof(struct yajl_buf_t));
     b->alloc = alloc;
     b->data = (unsigned char *) "";
@@ -64,14 +84,18 @@ yajl_buf yajl_buf_alloc(yajl_alloc_funcs * alloc)
 
 void yajl_buf_free(yajl_buf buf)
 {
-    assert(buf != NULL);
+    if (buf == NULL) return;
     if (buf->len) YA_FREE(buf->alloc, buf->data);
     YA_FREE(buf->alloc, buf);
 }
 
 void yajl_buf_append(yajl_buf buf, const void * data, size_t len)
 {
-    yajl_buf_ensure_available(buf, len);
+    if (buf->err) return;
+    if (!yajl_buf_ensure_available(buf, len)) {
+        buf->err = 1;
+        return;
+    }
     if (len > 0) {
         assert(data != NULL);
         memcpy(buf->data + buf->used, data, len);
@@ -83,6 +107,7 @@ void yajl_buf_append(yajl_buf buf, const void * data, size_t len)
 void yajl_buf_clear(yajl_buf buf)
 {
     buf->used = 0;
+    buf->err = 0;
     if (buf->len) buf->data[buf->used] = 0;
 }
 
@@ -96,9 +121,51 @@ size_t yajl_buf_len(yajl_buf buf)
     return buf->used;
 }
 
+int yajl_buf_err(yajl_buf buf)
+{
+    return buf->err;
+}
+
+size_t yajl_buf_peak_capacity(yajl_buf buf)
+{
+    return buf->peak;
+}
+
+size_t yajl_buf_grows(yajl_buf buf)
+{
+    return buf->grows;
+}
+
+unsigned char * yajl_buf_steal(yajl_buf buf, size_t * len)
+{
+    unsigned char * data;
+
+    if (buf->err || !yajl_buf_ensure_available(buf, 0)) return NULL;
+    data = buf->data;
+    *len = buf->used;
+    buf->data = (unsigned char *) "";
+    buf->len = 0;
+    buf->used = 0;
+    return data;
+}
+
+void yajl_buf_adopt(yajl_buf buf, unsigned char * data, size_t cap)
+{
+    assert(cap > 0);
+    if (buf->len) YA_FREE(buf->alloc, buf->data);
+    buf->data = data;
+    buf->len = cap;
+    buf->used = 0;
+    buf->err = 0;
+    buf->data[0] = 0;
+    if (buf->len > buf->peak) buf->peak = buf->len;
+}
+
 void
 yajl_buf_truncate(yajl_buf buf, size_t len)
 {
     assert(len <= buf->used);
     buf->used = len;
+    buf->err = 0;
+    if (buf->len) buf->data[buf->used] = 0;
 }
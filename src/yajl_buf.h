@@ -33,25 +33,47 @@
  */
 typedef struct yajl_buf_t * yajl_buf;
 
-/* allocate a new buffer */
+/* allocate a new buffer, returns NULL if out of memory */
 yajl_buf yajl_buf_alloc(yajl_alloc_funcs * alloc);
 
 /* free the buffer */
 void yajl_buf_free(yajl_buf buf);
 
-/* append a number of bytes to the buffer */
-void yajl_buf_append(yajl_buf buf, const void * data, size_t len);
+/* append a number of bytes to the buffer.  If the buffer can't grow the
+ * bytes are dropped, and so are those of later appends until the buffer
+ * is cleared, see yajl_buf_err() */
+YAJL_API void yajl_buf_append(yajl_buf buf, const void * data, size_t len);
 
-/* empty the buffer */
-void yajl_buf_clear(yajl_buf buf);
+/* empty the buffer, clearing any allocation error */
+YAJL_API void yajl_buf_clear(yajl_buf buf);
 
 /* get a pointer to the beginning of the buffer */
-const unsigned char * yajl_buf_data(yajl_buf buf);
+YAJL_API const unsigned char * yajl_buf_data(yajl_buf buf);
 
 /* get the length of the buffer */
 size_t yajl_buf_len(yajl_buf buf);
 
-/* truncate the buffer */
+/* truncate the buffer.  what was dropped for want of memory came after
+ * len, so an allocation error is cleared */
 void yajl_buf_truncate(yajl_buf buf, size_t len);
 
+/* has an append failed to allocate memory since the last clear? */
+YAJL_API int yajl_buf_err(yajl_buf buf);
+
+/* get the largest number of bytes allocated for the buffer at once.  it
+ * is kept when the data is stolen or replaced */
+size_t yajl_buf_peak_capacity(yajl_buf buf);
+
+/* get the number of times the buffer allocation grew */
+size_t yajl_buf_grows(yajl_buf buf);
+
+/* hand over the allocated data, null padded, and its length in *len.  the
+ * buffer is left empty, to allocate anew.  returns NULL if out of memory
+ * or if an append failed since the last clear */
+unsigned char * yajl_buf_steal(yajl_buf buf, size_t * len);
+
+/* replace the data by cap bytes at data, allocated with the buffer's
+ * allocation routines, which the buffer takes over.  it is left empty */
+void yajl_buf_adopt(yajl_buf buf, unsigned char * data, size_t cap);
+
 #endif
@@ -113,6 +113,61 @@ static void Utf32toUtf8(unsigned int codepoint, char * utf8Buf)
     }
 }
 
+/* decode the escape sequence starting with the backslash at str[*end],
+ * leaving *end on its last byte.  returns the decoded bytes, *outLen of
+ * them, which is never more than the sequence is long */
+static const char * yajl_unescape(const unsigned char * str, size_t * end,
+                                  char * utf8Buf, size_t * outLen)
+{
+    const char * unescaped = "?";
+
+    switch (str[++(*end)]) {
+        case 'r': unescaped = "\r"; break;
+        case 'n': unescaped = "\n"; break;
+        case '\\': unescaped = "\\"; break;
+        case '/': unescaped = "/"; break;
+        case '"': unescaped = "\""; break;
+        case 'f': unescaped = "\f"; break;
+        case 'b': unescaped = "\b"; break;
+        case 't': unescaped = "\t"; break;
+        case 'u': {
+            unsigned int codepoint = 0;
+            hexToDigit(&codepoint, str + ++(*end));
+            *end+=3;
+            /* check if this is a surrogate */
+            if ((codepoint & 0xFC00) == 0xD800) {
+                (*end)++;
+                if (str[*end] == '\\' && str[*end + 1] == 'u') {
+                    unsigned int surrogate = 0;
+                    hexToDigit(&surrogate, str + *end + 2);
+                    codepoint =
+                        (((codepoint & 0x3F) << 10) | 
+                         ((((codepoint >> 6) & 0xF) + 1) << 16) | 
+                         (surrogate & 0x3FF));
+                    *end += 5;
+                } else {
+                    unescaped = "?";
+                    break;
+                }
+            }
+            
+            Utf32toUtf8(codepoint, utf8Buf);
+            unescaped = utf8Buf;
+
+            if (codepoint == 0) {
+                *outLen = 1;
+                return unescaped;
+            }
+
+            break;
+        }
+        default:
+            assert("this should never happen" == NULL);
+    }
+    *outLen = strlen(unescaped);
+    return unescaped;
+}
+
 void yajl_string_decode(yajl_buf buf, const unsigned char * str,
                         size_t len)
 {
@@ -122,53 +177,11 @@ void yajl_string_decode(yajl_buf buf, const unsigned char * str,
     while (end < len) {
         if (str[end] == '\\') {
             char utf8Buf[5];
-            const char * unescaped = "?";
+            size_t n;
+            const char * unescaped;
             yajl_buf_append(buf, str + beg, end - beg);
-            switch (str[++end]) {
-                case 'r': unescaped = "\r"; break;
-                case 'n': unescaped = "\n"; break;
-                case '\\': unescaped = "\\"; break;
-                case '/': unescaped = "/"; break;
-                case '"': unescaped = "\""; break;
-                case 'f': unescaped = "\f"; break;
-                case 'b': unescaped = "\b"; break;
-                case 't': unescaped = "\t"; break;
-                case 'u': {
-                    unsigned int codepoint = 0;
-                    hexToDigit(&codepoint, str + ++end);
-                    end+=3;
-                    /* check if this is a surrogate */
-                    if ((codepoint & 0xFC00) == 0xD800) {
-                        end++;
-                        if (str[end] == '\\' && str[end + 1] == 'u') {
-                            unsigned int surrogate = 0;
-                            hexToDigit(&surrogate, str + end + 2);
-                            codepoint =
-                                (((codepoint & 0x3F) << 10) | 
-                                 ((((codepoint >> 6) & 0xF) + 1) << 16) | 
-                                 (surrogate & 0x3FF));
-                            end += 5;
-                        } else {
-                            unescaped = "?";
-                            break;
-                        }
-                    }
-                    
-                    Utf32toUtf8(codepoint, utf8Buf);
-                    unescaped = utf8Buf;
-
-                    if (codepoint == 0) {
-                        yajl_buf_append(buf, unescaped, 1);
-                        beg = ++end;
-                        continue;
-                    }
-
-                    break;
-                }
-                default:
-                    assert("this should never happen" == NULL);
-            }
-            yajl_buf_append(buf, unescaped, (unsigned int)strlen(unescaped));
+            unescaped = yajl_unescape(str, &end, utf8Buf, &n);
+            yajl_buf_append(buf, unescaped, n);
             beg = ++end;
         } else {
             end++;
@@ -177,6 +190,96 @@ void yajl_string_decode(yajl_buf buf, const unsigned char * str,
     yajl_buf_append(buf, str + beg, end - beg);
 }
 
+size_t yajl_string_decode_in_place(unsigned char * str, size_t len)
+{
+    size_t beg = 0;
+    size_t end = 0;
+    size_t out = 0;
+
+    while (end < len) {
+        if (str[end] == '\\') {
+            char utf8Buf[5];
+            size_t n;
+            const char * unescaped;
+            memmove(str + out, str + beg, end - beg);
+            out += end - beg;
+            unescaped = yajl_unescape(str, &end, utf8Buf, &n);
+            memcpy(str + out, unescaped, n);
+            out += n;
+            beg = ++end;
+        } else {
+            end++;
+        }
+    }
+    memmove(str + out, str + beg, end - beg);
+    return out + end - beg;
+}
+
+/* how much of str yajl_string_decode can take without seeing what follows:
+ * up to the escape sequence, if any, which may continue past the end.  a
+ * high surrogate is decoded together with the escape after it */
+static size_t
+yajl_string_decode_cut(const unsigned char * str, size_t len)
+{
+    size_t pos = 0, step;
+
+    while (pos < len) {
+        if (str[pos] != '\\') {
+            pos++;
+            continue;
+        }
+        if (pos + 2 > len) break;
+        if (str[pos + 1] != 'u') {
+            step = 2;
+        } else {
+            unsigned int codepoint = 0;
+            if (pos + 6 > len) break;
+            hexToDigit(&codepoint, str + pos + 2);
+            if ((codepoint & 0xFC00) != 0xD800) step = 6;
+            else if (pos + 8 > len) break;
+            else if (str[pos + 6] == '\\' && str[pos + 7] == 'u') step = 12;
+            else step = 7;
+        }
+        if (pos + step > len) break;
+        pos += step;
+    }
+    return pos;
+}
+
+void yajl_string_decode_part(yajl_buf buf, unsigned char * pending,
+                             size_t * pendingLen, const unsigned char * str,
+                             size_t len, int last)
+{
+    size_t cut;
+
+    /* finish the escape sequence left over from the previous piece */
+    if (*pendingLen > 0) {
+        unsigned char joined[2 * YAJL_DECODE_PENDING];
+        size_t take = len < YAJL_DECODE_PENDING ? len : YAJL_DECODE_PENDING;
+        size_t joinedLen = *pendingLen + take;
+
+        memcpy(joined, pending, *pendingLen);
+        memcpy(joined + *pendingLen, str, take);
+        cut = (last && take == len) ? joinedLen
+                                    : yajl_string_decode_cut(joined, joinedLen);
+        yajl_string_decode(buf, joined, cut);
+        if (cut < *pendingLen) {
+            /* still unfinished, so the piece was shorter than take */
+            *pendingLen = joinedLen - cut;
+            memmove(pending, joined + cut, *pendingLen);
+            return;
+        }
+        str += cut - *pendingLen;
+        len -= cut - *pendingLen;
+        *pendingLen = 0;
+    }
+
+    cut = last ? len : yajl_string_decode_cut(str, len);
+    yajl_string_decode(buf, str, cut);
+    *pendingLen = len - cut;
+    memcpy(pending, str + cut, *pendingLen);
+}
+
 #define ADV_PTR s++; if (!(len--)) return 0;
 
 int yajl_string_validate_utf8(const unsigned char * s, size_t len)
@@ -218,3 +321,90 @@ int yajl_string_validate_utf8(const unsigned char * s, size_t len)
     
     return 1;
 }
+
+int yajl_number_integer(double d, long long * i)
+{
+    /* -2^63 <= d < 2^63, false for NaN */
+    if (d >= -9223372036854775808.0 && d < 9223372036854775808.0 &&
+        d == (double) (long long) d)
+    {
+        *i = (long long) d;
+        return 1;
+    }
+    return 0;
+}
+
+void yajl_number_canonical(char * buf, double d)
+{
+    char tmp[YAJL_NUMBER_CANONICAL_MAX];
+    char digits[20];
+    const char * s;
+    long long i;
+    int precision, k = 0, n, e;
+
+    if (yajl_number_integer(d, &i)) {
+        sprintf(buf, "%lld", i);
+        return;
+    }
+
+    /* the shortest of 15, 16 or 17 significant digits that reads back as
+     * d.  a number with fewer digits comes out of %.15e padded with zeros,
+     * which are dropped below */
+    for (precision = 15; ; precision++) {
+        sprintf(tmp, "%.*e", precision - 1, d);
+        if (precision == 17 || strtod(tmp, NULL) == d) break;
+    }
+
+    /* take the digits and the exponent from d.ddde+xx, whatever the
+     * decimal point and however many digits the exponent has */
+    s = tmp;
+    if (*s == '-') *buf++ = *s++;
+    for (; *s != 'e' && *s != 'E'; s++) {
+        if (*s >= '0' && *s <= '9') digits[k++] = *s;
+    }
+    e = atoi(s + 1);
+    while (k > 1 && digits[k - 1] == '0') k--;
+
+    /* d is 0.digits times 10 to the n */
+    n = e + 1;
+    if (k <= n && n <= 21) {
+        memcpy(buf, digits, k);
+        memset(buf + k, '0', n - k);
+        buf[n] = 0;
+    } else if (0 < n && n <= 21) {
+        memcpy(buf, digits, n);
+        buf[n] = '.';
+        memcpy(buf + n + 1, digits + n, k - n);
+        buf[k + 1] = 0;
+    } else if (-6 < n && n <= 0) {
+        buf[0] = '0';
+        buf[1] = '.';
+        memset(buf + 2, '0', -n);
+        memcpy(buf + 2 - n, digits, k);
+        buf[2 - n + k] = 0;
+    } else {
+        *buf++ = digits[0];
+        if (k > 1) {
+            *buf++ = '.';
+            memcpy(buf, digits + 1, k - 1);
+            buf += k - 1;
+        }
+        sprintf(buf, "e%c%d", e < 0 ? '-' : '+', e < 0 ? -e : e);
+    }
+}
+
+size_t yajl_string_utf8_incomplete(const unsigned char * s, size_t len)
+{
+    size_t i, need;
+
+    for (i = 1; i <= 3 && i <= len; i++) {
+        unsigned char c = s[len - i];
+        if ((c >> 6) == 0x2) continue;
+        if ((c >> 5) == 0x6) need = 2;
+        else if ((c >> 4) == 0x0e) need = 3;
+        else if ((c >> 3) == 0x1e) need = 4;
+        else need = 1;
+        return need > i ? i : 0;
+    }
+    return 0;
+}
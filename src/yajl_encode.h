@@ -29,6 +29,40 @@ void yajl_string_encode(const yajl_print_t printer,
 void yajl_string_decode(yajl_buf buf, const unsigned char * str,
                         size_t length);
 
+/* decode a string over itself, which works since no escape sequence is
+ * shorter than what it decodes to.  returns the decoded length */
+size_t yajl_string_decode_in_place(unsigned char * str, size_t length);
+
+/* room for the longest escape sequence, a surrogate pair */
+#define YAJL_DECODE_PENDING 12
+
+/* decode a string which arrives in pieces, appending to buf what can be
+ * decoded so far.  an escape sequence which may continue in the next piece
+ * is kept in pending, of YAJL_DECODE_PENDING bytes, with *pendingLen
+ * (0 before the first piece).  last is set for the final piece */
+void yajl_string_decode_part(yajl_buf buf, unsigned char * pending,
+                             size_t * pendingLen, const unsigned char * str,
+                             size_t length, int last);
+
 int yajl_string_validate_utf8(const unsigned char * s, size_t len);
 
+/* the number of bytes at the end of s which start a UTF-8 sequence that
+ * is cut short, 0 if the last sequence is complete */
+size_t yajl_string_utf8_incomplete(const unsigned char * s, size_t len);
+
+/* is the double d a whole number in the range of a long long?  if so it
+ * is put in *i.  numbers that are not integers already are normalized by
+ * their value as a double, so that 1.0, 1e0 and the integer 1 are the
+ * same number */
+int yajl_number_integer(double d, long long * i);
+
+/* room for a number from yajl_number_canonical(), with its null */
+#define YAJL_NUMBER_CANONICAL_MAX 32
+
+/* print the finite double d in one form for each value: whole numbers in
+ * the range of a long long as integers, others in the fewest digits that
+ * read back as d, laid out as ECMAScript does (0.001, 1.5e-7, 1e+21)
+ * rather than as the C library's %g does */
+void yajl_number_canonical(char * buf, double d);
+
 #endif
@@ -17,6 +17,9 @@
 #include "api/yajl_gen.h"
 #include "yajl_buf.h"
 #include "yajl_encode.h"
+#include "yajl_bitstack.h"
+#include "api/yajl_arena.h"
+#include "api/yajl_tree.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -40,21 +43,223 @@ typedef enum {
     yajl_gen_error
 } yajl_gen_state;
 
+struct yajl_gen_prepared_t
+{
+    size_t len;
+    /* the encoded string, quotes included */
+    char text[1];
+};
+
+/* the smallest length referenced by the yajl_gen_iovec option, more
+ * than any escape sequence or number printed from a local buffer */
+#define YAJL_IOV_MIN_REF 16
+/* bytes taken from the arena at a time for copied pieces */
+#define YAJL_IOV_BLOCK 1024
+
+/* output collected for yajl_gen_get_iov() */
+typedef struct
+{
+    /* the pieces so far, an array of yajl_iovec */
+    yajl_buf iov;
+    /* the piece being copied into block, not in iov yet */
+    yajl_iovec open;
+    unsigned int isOpen;
+    /* copies are packed into blocks from the arena */
+    yajl_arena arena;
+    char * block;
+    size_t blockUsed;
+    size_t blockSize;
+    /* pieces this long are referenced */
+    size_t refMin;
+    /* memory ran out, output was lost */
+    unsigned int err;
+} yajl_gen_iov_sink;
+
+/* a point yajl_gen_rollback() returns to */
+typedef struct
+{
+    /* length of the buffer, or number of pieces of the iov sink */
+    size_t outLen;
+    /* output was already lost, so it isn't truncated */
+    unsigned int outErr;
+    size_t startOffset;
+    size_t endOffset;
+    /* the state stack, whose heap bytes are kept in savedBits */
+    size_t depth;
+    unsigned char current;
+    unsigned char err;
+    unsigned char bits[YAJL_BS_INLINE / 8];
+    size_t heapOffset;
+    size_t heapLen;
+} yajl_gen_savepoint_rec;
+
 struct yajl_gen_t
 {
     unsigned int flags;
-    unsigned int depth;
+    /* deepest nesting allowed, 0 for no limit */
+    size_t maxDepth;
     const char * indentString;
-    yajl_gen_state state[YAJL_MAX_DEPTH];
+    size_t indentLen;
+    /* a newline and then indentString over and over, so a line break and
+     * the indentation after it are output in one go */
+    char * indentRun;
+    size_t indentRunLen;
+    size_t indentRunCap;
+    /* a stack of states.  access with yajl_bs_XXX routines */
+    yajl_bitstack stateStack;
+    /* the depth and first state of the level a fragment is generated in,
+     * 0 and yajl_gen_start when not a fragment */
+    size_t fragDepth;
+    unsigned char fragState;
     yajl_print_t print;
     void * ctx; /* yajl_buf */
+    /* set by the yajl_gen_iovec option, ctx is then the same */
+    yajl_gen_iov_sink * iov;
     /* memory allocation routines */
     yajl_alloc_funcs alloc;
+    /* counters behind alloc while yajl_gen_collect_stats is on */
+    yajl_counting_alloc countingAlloc;
     /* buffer position of start and end of last thing generated */
     size_t startOffset;
     size_t endOffset;
+    /* between yajl_gen_string_open() and yajl_gen_string_close() */
+    unsigned int inString;
+    /* a UTF-8 character cut short by the last yajl_gen_string_append(),
+     * kept to be validated once complete */
+    unsigned char utf8Pending[4];
+    size_t utf8PendingLen;
+    /* the keys of the maps being output by yajl_tree_generate() with
+     * yajl_gen_canonical, as pointers to sort.  allocated on first use */
+    yajl_buf keyOrder;
+    /* savepoints held, an array of yajl_gen_savepoint_rec, allocated on
+     * first use */
+    yajl_buf savepoints;
+    yajl_buf savedBits;
 };
 
+static void
+yajl_gen_iov_flush(yajl_gen_iov_sink * s)
+{
+    if (s->isOpen) {
+        yajl_buf_append(s->iov, &(s->open), sizeof(yajl_iovec));
+        if (yajl_buf_err(s->iov)) s->err = 1;
+        s->isOpen = 0;
+    }
+}
+
+/* copy a piece into the current block, continuing the open piece */
+static void
+yajl_gen_iov_copy(void * ctx, const char * str, size_t len)
+{
+    yajl_gen_iov_sink * s = (yajl_gen_iov_sink *) ctx;
+
+    while (len > 0) {
+        size_t n;
+
+        if (s->blockUsed == s->blockSize) {
+            const yajl_alloc_funcs * afs = yajl_arena_funcs(s->arena);
+            yajl_gen_iov_flush(s);
+            s->block = (char *) YA_MALLOC(afs, YAJL_IOV_BLOCK);
+            if (s->block == NULL) {
+                s->blockUsed = s->blockSize = 0;
+                s->err = 1;
+                return;
+            }
+            s->blockUsed = 0;
+            s->blockSize = YAJL_IOV_BLOCK;
+        }
+        if (!s->isOpen) {
+            s->open.iov_base = s->block + s->blockUsed;
+            s->open.iov_len = 0;
+            s->isOpen = 1;
+        }
+        n = s->blockSize - s->blockUsed;
+        if (n > len) n = len;
+        memcpy(s->block + s->blockUsed, str, n);
+        s->blockUsed += n;
+        s->open.iov_len += n;
+        str += n;
+        len -= n;
+    }
+}
+
+/* reference a long piece where it is, copy a short one */
+static void
+yajl_gen_iov_ref(void * ctx, const char * str, size_t len)
+{
+    yajl_gen_iov_sink * s = (yajl_gen_iov_sink *) ctx;
+    yajl_iovec v;
+
+    if (len < s->refMin) {
+        yajl_gen_iov_copy(ctx, str, len);
+        return;
+    }
+    yajl_gen_iov_flush(s);
+    v.iov_base = str;
+    v.iov_len = len;
+    yajl_buf_append(s->iov, &v, sizeof(yajl_iovec));
+    if (yajl_buf_err(s->iov)) s->err = 1;
+}
+
+static void
+yajl_gen_iov_clear(yajl_gen_iov_sink * s)
+{
+    yajl_buf_clear(s->iov);
+    yajl_arena_reset(s->arena);
+    s->isOpen = 0;
+    s->block = NULL;
+    s->blockUsed = s->blockSize = 0;
+    s->err = 0;
+}
+
+static void
+yajl_gen_iov_free(yajl_gen g)
+{
+    if (g->iov == NULL) return;
+    yajl_buf_free(g->iov->iov);
+    yajl_arena_free(g->iov->arena);
+    YA_FREE(&(g->alloc), g->iov);
+    g->iov = NULL;
+}
+
+/* switch the output to a new iov sink, 0 if out of memory */
+static int
+yajl_gen_iov_alloc(yajl_gen g, size_t refMin)
+{
+    yajl_gen_iov_sink * s;
+
+    s = (yajl_gen_iov_sink *) YA_MALLOC(&(g->alloc), sizeof(*s));
+    if (s == NULL) return 0;
+    memset((void *) s, 0, sizeof(*s));
+    s->iov = yajl_buf_alloc(&(g->alloc));
+    s->arena = yajl_arena_alloc(&(g->alloc), 0);
+    if (s->iov == NULL || s->arena == NULL) {
+        if (s->iov != NULL) yajl_buf_free(s->iov);
+        if (s->arena != NULL) yajl_arena_free(s->arena);
+        YA_FREE(&(g->alloc), s);
+        return 0;
+    }
+    s->refMin = refMin;
+
+    if (g->print == (yajl_print_t)&yajl_buf_append) yajl_buf_free(g->ctx);
+    g->iov = s;
+    g->print = &yajl_gen_iov_copy;
+    g->ctx = s;
+    return 1;
+}
+
+/* forget the savepoints, when the output they point into goes */
+static void
+yajl_gen_drop_savepoints(yajl_gen g)
+{
+    if (g->savepoints == NULL) return;
+    yajl_buf_clear(g->savepoints);
+    yajl_buf_clear(g->savedBits);
+}
+
+/* the printer for caller data which may be referenced rather than copied */
+#define PRINT_REF (g->iov != NULL ? &yajl_gen_iov_ref : g->print)
+
 int
 yajl_gen_config(yajl_gen g, yajl_gen_option opt, ...)
 {
@@ -67,6 +272,7 @@ yajl_gen_config(yajl_gen g, yajl_gen_option opt, ...)
         case yajl_gen_validate_utf8:
         case yajl_gen_escape_solidus:
         case yajl_gen_no_final_newline:
+        case yajl_gen_canonical:
             if (va_arg(ap, int)) g->flags |= opt;
             else g->flags &= ~opt;
             break;
@@ -85,13 +291,71 @@ yajl_gen_config(yajl_gen g, yajl_gen_option opt, ...)
                     rv = 0;
                 }
             }
+            g->indentLen = g->indentString ? strlen(g->indentString) : 0;
+            g->indentRunLen = 0;
             break;
         }
         case yajl_gen_print_callback:
-            yajl_buf_free(g->ctx);
+            if (g->print == (yajl_print_t)&yajl_buf_append) {
+                yajl_buf_free(g->ctx);
+            }
+            yajl_gen_iov_free(g);
+            yajl_gen_drop_savepoints(g);
             g->print = va_arg(ap, const yajl_print_t);
             g->ctx = va_arg(ap, void *);
             break;
+        case yajl_gen_collect_stats:
+            if (va_arg(ap, int)) {
+                g->flags |= opt;
+                yajl_counting_alloc_install(&(g->countingAlloc), &(g->alloc));
+            } else {
+                g->flags &= ~opt;
+                yajl_counting_alloc_remove(&(g->countingAlloc), &(g->alloc));
+            }
+            break;
+        case yajl_gen_max_depth:
+            g->maxDepth = va_arg(ap, size_t);
+            break;
+        case yajl_gen_iovec: {
+            size_t refMin = va_arg(ap, size_t);
+            if (refMin == 0) {
+                yajl_buf buf;
+                if (g->iov == NULL) break;
+                buf = yajl_buf_alloc(&(g->alloc));
+                if (buf == NULL) {
+                    rv = 0;
+                    break;
+                }
+                yajl_gen_iov_free(g);
+                yajl_gen_drop_savepoints(g);
+                g->print = (yajl_print_t)&yajl_buf_append;
+                g->ctx = buf;
+                break;
+            }
+            if (refMin < YAJL_IOV_MIN_REF) refMin = YAJL_IOV_MIN_REF;
+            if (g->iov != NULL) g->iov->refMin = refMin;
+            else if (!yajl_gen_iov_alloc(g, refMin)) rv = 0;
+            else yajl_gen_drop_savepoints(g);
+            break;
+        }
+        case yajl_gen_buffer: {
+            unsigned char * data = va_arg(ap, unsigned char *);
+            size_t cap = va_arg(ap, size_t);
+            if (g->print != (yajl_print_t)&yajl_buf_append || cap == 0) {
+                rv = 0;
+                break;
+            }
+            if (data == NULL) {
+                data = (unsigned char *) YA_MALLOC(&(g->alloc), cap);
+                if (data == NULL) {
+                    rv = 0;
+                    break;
+                }
+            }
+            yajl_buf_adopt((yajl_buf)g->ctx, data, cap);
+            yajl_gen_drop_savepoints(g);
+            break;
+        }
         default:
             rv = 0;
     }
@@ -129,7 +393,13 @@ yajl_gen_alloc(const yajl_alloc_funcs * afs)
 
     g->print = (yajl_print_t)&yajl_buf_append;
     g->ctx = yajl_buf_alloc(&(g->alloc));
+    if (g->ctx == NULL) {
+        YA_FREE(&(g->alloc), g);
+        return NULL;
+    }
     g->indentString = "    ";
+    g->indentLen = 4;
+    yajl_bs_init(g->stateStack, &(g->alloc), yajl_gen_start);
 
     return g;
 }
@@ -137,8 +407,11 @@ yajl_gen_alloc(const yajl_alloc_funcs * afs)
 void
 yajl_gen_reset(yajl_gen g, const char * sep)
 {
-    g->depth = 0;
-    memset((void *) &(g->state), 0, sizeof(g->state));
+    yajl_bs_clear(g->stateStack, yajl_gen_start);
+    g->fragDepth = 0;
+    g->fragState = yajl_gen_start;
+    g->inString = 0;
+    g->utf8PendingLen = 0;
     if (sep != NULL) g->print(g->ctx, sep, strlen(sep));
 }
 
@@ -146,11 +419,73 @@ void
 yajl_gen_free(yajl_gen g)
 {
     if (g->print == (yajl_print_t)&yajl_buf_append) yajl_buf_free((yajl_buf)g->ctx);
+    yajl_gen_iov_free(g);
+    yajl_buf_free(g->savepoints);
+    yajl_buf_free(g->savedBits);
+    yajl_buf_free(g->keyOrder);
+    yajl_bs_free(g->stateStack);
+    if (g->indentRun != NULL) YA_FREE(&(g->alloc), g->indentRun);
     YA_FREE(&(g->alloc), g);
 }
 
+void
+yajl_gen_get_stats(yajl_gen g, yajl_stats * stats)
+{
+    if (g->flags & yajl_gen_collect_stats) {
+        *stats = g->countingAlloc.stats;
+    } else {
+        memset((void *) stats, 0, sizeof(yajl_stats));
+    }
+
+    if (g->print == (yajl_print_t)&yajl_buf_append) {
+        stats->peakBufCapacity = yajl_buf_peak_capacity((yajl_buf)g->ctx);
+        stats->bufGrows = yajl_buf_grows((yajl_buf)g->ctx);
+    }
+    stats->stackGrows = g->stateStack.grows;
+}
+
+/* start a new line, indented to depth */
+static void
+yajl_gen_newline(yajl_gen g, size_t depth)
+{
+    size_t len = 1 + depth * g->indentLen;
+
+    if (len > g->indentRunLen) {
+        size_t cap = 1 + 2 * depth * g->indentLen;
+        char * run = g->indentRun;
+        size_t i;
+
+        if (cap < 1 + 16 * g->indentLen) cap = 1 + 16 * g->indentLen;
+        if (cap > g->indentRunCap) {
+            run = (char *) YA_REALLOC(&(g->alloc), g->indentRun, cap);
+        }
+        if (run == NULL) {
+            /* output the levels one at a time instead */
+            g->print(g->ctx, "\n", 1);
+            for (i = 0; i < depth; i++) {
+                g->print(g->ctx, g->indentString, g->indentLen);
+            }
+            return;
+        }
+        if (cap > g->indentRunCap) {
+            g->indentRun = run;
+            g->indentRunCap = cap;
+        }
+        run[0] = '\n';
+        for (i = 1; g->indentLen > 0 && i + g->indentLen <= g->indentRunCap;
+             i += g->indentLen)
+        {
+            memcpy(run + i, g->indentString, g->indentLen);
+        }
+        g->indentRunLen = i;
+    }
+    g->print(g->ctx, g->indentRun, len);
+}
+
+/* the separator before a value, with the line break and indentation
+ * before it when beautifying */
 #define INSERT_SEP \
-    switch (g->state[g->depth]) {                                       \
+    switch (yajl_bs_current(g->stateStack)) {                           \
         case yajl_gen_map_key:                                          \
         case yajl_gen_in_array:                                         \
             g->print(g->ctx, ",", 1);                                   \
@@ -158,7 +493,7 @@ yajl_gen_free(yajl_gen g)
         case yajl_gen_map_start:                                        \
         case yajl_gen_array_start:                                      \
             if ((g->flags & yajl_gen_beautify)) {                       \
-                g->print(g->ctx, "\n", 1);                              \
+                yajl_gen_newline(g, yajl_bs_depth(g->stateStack));      \
             }                                                           \
             break;                                                      \
         case yajl_gen_map_val:                                          \
@@ -171,66 +506,78 @@ yajl_gen_free(yajl_gen g)
             break;                                                      \
     }
 
+/* INSERT_SEP has indented the value, except after a map key.  note that
+ * whitespace is suppressed there, see yajl_gen_map_val2 */
 #define INSERT_WHITESPACE \
-    if ((g->flags & yajl_gen_beautify)) {                               \
-        if (g->state[g->depth] != yajl_gen_map_val) {                   \
-            unsigned int _i;                                            \
-            for (_i=0;_i<g->depth;_i++)                                 \
-                g->print(g->ctx,                                        \
-                         g->indentString,                               \
-                         (unsigned int)strlen(g->indentString));        \
-        }                                                               \
-        else {                                                          \
-            g->state[g->depth] = yajl_gen_map_val2;                     \
-        }                                                               \
+    if ((g->flags & yajl_gen_beautify) &&                               \
+        yajl_bs_current(g->stateStack) == yajl_gen_map_val) {           \
+        yajl_bs_set(g->stateStack, yajl_gen_map_val2);                  \
     }
 
 #define ENSURE_NOT_KEY \
-    if (g->state[g->depth] == yajl_gen_map_key ||       \
-        g->state[g->depth] == yajl_gen_map_start)  {    \
-        return yajl_gen_keys_must_be_strings;           \
-    }                                                   \
+    if (yajl_bs_current(g->stateStack) == yajl_gen_map_key ||       \
+        yajl_bs_current(g->stateStack) == yajl_gen_map_start)  {    \
+        return yajl_gen_keys_must_be_strings;                       \
+    }                                                               \
 
 /* check that we're not complete, or in error state.  in a valid state
  * to be generating */
 #define ENSURE_VALID_STATE \
-    if (g->state[g->depth] == yajl_gen_error) {             \
-        return yajl_gen_in_error_state;                     \
-    } else if (g->state[g->depth] == yajl_gen_complete) {   \
-        return yajl_gen_generation_complete;                \
+    if (g->inString) {                                                \
+        return yajl_gen_string_unbalanced;                            \
+    } else if (yajl_bs_current(g->stateStack) == yajl_gen_error) {    \
+        return yajl_gen_in_error_state;                               \
+    } else if (yajl_bs_current(g->stateStack) == yajl_gen_complete) { \
+        return yajl_gen_generation_complete;                          \
     }
 
-#define INCREMENT_DEPTH \
-    if (++(g->depth) >= YAJL_MAX_DEPTH) return yajl_max_depth_exceeded;
+/* enter a container whose first state is state */
+#define PUSH_STATE(state, isMap) \
+    if (g->maxDepth != 0 &&                                         \
+        yajl_bs_depth(g->stateStack) >= g->maxDepth) {              \
+        return yajl_max_depth_exceeded;                             \
+    }                                                               \
+    yajl_bs_push(g->stateStack, state, isMap);                      \
+    if (yajl_bs_err(g->stateStack)) {                               \
+        yajl_bs_set(g->stateStack, yajl_gen_error);                 \
+        return yajl_gen_out_of_memory;                              \
+    }
 
-#define DECREMENT_DEPTH \
-  if (--(g->depth) >= YAJL_MAX_DEPTH) return yajl_gen_generation_complete;
+/* leave a container.  the enclosing level had its separator and
+ * whitespace output before the container, so it continues as after a
+ * value */
+#define POP_STATE \
+    if (yajl_bs_depth(g->stateStack) == g->fragDepth) {             \
+        return yajl_gen_generation_complete;                        \
+    }                                                               \
+    yajl_bs_pop(g->stateStack, yajl_gen_start, yajl_gen_map_val2,   \
+                yajl_gen_in_array);
 
 #define APPENDED_ATOM \
-    switch (g->state[g->depth]) {                   \
-        case yajl_gen_start:                        \
-            g->state[g->depth] = yajl_gen_complete; \
-            break;                                  \
-        case yajl_gen_map_start:                    \
-        case yajl_gen_map_key:                      \
-            g->state[g->depth] = yajl_gen_map_val;  \
-            break;                                  \
-        case yajl_gen_array_start:                  \
-            g->state[g->depth] = yajl_gen_in_array; \
-            break;                                  \
-        case yajl_gen_map_val:                      \
-        case yajl_gen_map_val2:                     \
-            g->state[g->depth] = yajl_gen_map_key;  \
-            break;                                  \
-        default:                                    \
-            break;                                  \
-    }                                               \
+    switch (yajl_bs_current(g->stateStack)) {              \
+        case yajl_gen_start:                               \
+            yajl_bs_set(g->stateStack, yajl_gen_complete); \
+            break;                                         \
+        case yajl_gen_map_start:                           \
+        case yajl_gen_map_key:                             \
+            yajl_bs_set(g->stateStack, yajl_gen_map_val);  \
+            break;                                         \
+        case yajl_gen_array_start:                         \
+            yajl_bs_set(g->stateStack, yajl_gen_in_array); \
+            break;                                         \
+        case yajl_gen_map_val:                             \
+        case yajl_gen_map_val2:                            \
+            yajl_bs_set(g->stateStack, yajl_gen_map_key);  \
+            break;                                         \
+        default:                                           \
+            break;                                         \
+    }                                                      \
 
 #define FINAL_NEWLINE \
     if (((g->flags &                                             \
           (yajl_gen_beautify | yajl_gen_no_final_newline)) ==    \
          yajl_gen_beautify) &&                                   \
-        g->state[g->depth] == yajl_gen_complete)                 \
+        yajl_bs_current(g->stateStack) == yajl_gen_complete)     \
     {                                                            \
         g->print(g->ctx, "\n", 1);                               \
     }
@@ -244,6 +591,16 @@ yajl_gen_free(yajl_gen g)
     if (g->print == (yajl_print_t)&yajl_buf_append) {           \
         g->endOffset = yajl_buf_len((yajl_buf)g->ctx);          \
     }
+
+/* the internal buffer drops what it can't allocate room for, the
+ * generator is then left in the error state */
+#define ENSURE_PRINTED \
+    if ((g->print == (yajl_print_t)&yajl_buf_append &&          \
+         yajl_buf_err((yajl_buf)g->ctx)) ||                     \
+        (g->iov != NULL && g->iov->err)) {                      \
+        yajl_bs_set(g->stateStack, yajl_gen_error);             \
+        return yajl_gen_out_of_memory;                          \
+    }
  
 yajl_gen_status
 yajl_gen_integer(yajl_gen g, long long int number)
@@ -256,6 +613,7 @@ yajl_gen_integer(yajl_gen g, long long int number)
     END_OFFSET;
     APPENDED_ATOM;
     FINAL_NEWLINE;
+    ENSURE_PRINTED;
     return yajl_gen_status_ok;
 }
 
@@ -265,6 +623,16 @@ yajl_gen_integer(yajl_gen g, long long int number)
 #define isinf !_finite
 #endif
 
+/* print a finite double, so that it reads back as a double */
+static void
+yajl_gen_format_double(char * i, double number)
+{
+    sprintf(i, "%.20g", number);
+    if (strspn(i, "0123456789-") == strlen(i)) {
+        strcat(i, ".0");
+    }
+}
+
 yajl_gen_status
 yajl_gen_double(yajl_gen g, double number)
 {
@@ -272,15 +640,14 @@ yajl_gen_double(yajl_gen g, double number)
     ENSURE_VALID_STATE; ENSURE_NOT_KEY;
     if (isnan(number) || isinf(number)) return yajl_gen_invalid_number;
     INSERT_SEP; INSERT_WHITESPACE;
-    sprintf(i, "%.20g", number);
-    if (strspn(i, "0123456789-") == strlen(i)) {
-        strcat(i, ".0");
-    }
+    if (g->flags & yajl_gen_canonical) yajl_number_canonical(i, number);
+    else yajl_gen_format_double(i, number);
     START_OFFSET;
     g->print(g->ctx, i, (unsigned int)strlen(i));
     END_OFFSET;
     APPENDED_ATOM;
     FINAL_NEWLINE;
+    ENSURE_PRINTED;
     return yajl_gen_status_ok;
 }
 
@@ -293,6 +660,7 @@ yajl_gen_number(yajl_gen g, const char * s, size_t l)
     END_OFFSET;
     APPENDED_ATOM;
     FINAL_NEWLINE;
+    ENSURE_PRINTED;
     return yajl_gen_status_ok;
 }
 
@@ -311,14 +679,145 @@ yajl_gen_string(yajl_gen g, const unsigned char * str,
     ENSURE_VALID_STATE; INSERT_SEP; INSERT_WHITESPACE;
     START_OFFSET;
     g->print(g->ctx, "\"", 1);
-    yajl_string_encode(g->print, g->ctx, str, len, g->flags & yajl_gen_escape_solidus);
+    yajl_string_encode(PRINT_REF, g->ctx, str, len, g->flags & yajl_gen_escape_solidus);
+    g->print(g->ctx, "\"", 1);
+    END_OFFSET;
+    APPENDED_ATOM;
+    FINAL_NEWLINE;
+    ENSURE_PRINTED;
+    return yajl_gen_status_ok;
+}
+
+yajl_gen_status
+yajl_gen_raw_value(yajl_gen g, const char * json, size_t len)
+{
+    ENSURE_VALID_STATE; ENSURE_NOT_KEY; INSERT_SEP; INSERT_WHITESPACE;
+    START_OFFSET;
+    PRINT_REF(g->ctx, json, len);
+    END_OFFSET;
+    APPENDED_ATOM;
+    FINAL_NEWLINE;
+    ENSURE_PRINTED;
+    return yajl_gen_status_ok;
+}
+
+yajl_gen_status
+yajl_gen_string_open(yajl_gen g)
+{
+    ENSURE_VALID_STATE; INSERT_SEP; INSERT_WHITESPACE;
+    START_OFFSET;
+    g->print(g->ctx, "\"", 1);
+    g->inString = 1;
+    g->utf8PendingLen = 0;
+    ENSURE_PRINTED;
+    return yajl_gen_status_ok;
+}
+
+yajl_gen_status
+yajl_gen_string_append(yajl_gen g, const unsigned char * str, size_t len)
+{
+    int escapeSolidus = g->flags & yajl_gen_escape_solidus;
+    size_t tail;
+
+    if (!g->inString) return yajl_gen_string_unbalanced;
+    if (!(g->flags & yajl_gen_validate_utf8)) {
+        yajl_string_encode(PRINT_REF, g->ctx, str, len, escapeSolidus);
+        ENSURE_PRINTED;
+        return yajl_gen_status_ok;
+    }
+
+    /* complete the character the last piece ended in.  only continuation
+     * bytes may follow its lead byte, which bounds it to 4 bytes */
+    while (g->utf8PendingLen > 0 && len > 0) {
+        if ((*str >> 6) != 0x2) return yajl_gen_invalid_string;
+        g->utf8Pending[g->utf8PendingLen++] = *str++;
+        len--;
+        if (!yajl_string_utf8_incomplete(g->utf8Pending, g->utf8PendingLen))
+        {
+            if (!yajl_string_validate_utf8(g->utf8Pending, g->utf8PendingLen))
+            {
+                return yajl_gen_invalid_string;
+            }
+            yajl_string_encode(PRINT_REF, g->ctx, g->utf8Pending,
+                               g->utf8PendingLen, escapeSolidus);
+            g->utf8PendingLen = 0;
+        }
+    }
+
+    tail = yajl_string_utf8_incomplete(str, len);
+    if (!yajl_string_validate_utf8(str, len - tail)) {
+        return yajl_gen_invalid_string;
+    }
+    yajl_string_encode(PRINT_REF, g->ctx, str, len - tail, escapeSolidus);
+    memcpy(g->utf8Pending + g->utf8PendingLen, str + len - tail, tail);
+    g->utf8PendingLen += tail;
+    ENSURE_PRINTED;
+    return yajl_gen_status_ok;
+}
+
+yajl_gen_status
+yajl_gen_string_close(yajl_gen g)
+{
+    if (!g->inString) return yajl_gen_string_unbalanced;
+    /* the string ends part way through a character */
+    if (g->utf8PendingLen > 0) return yajl_gen_invalid_string;
+    g->inString = 0;
     g->print(g->ctx, "\"", 1);
     END_OFFSET;
     APPENDED_ATOM;
     FINAL_NEWLINE;
+    ENSURE_PRINTED;
+    return yajl_gen_status_ok;
+}
+
+yajl_gen_prepared
+yajl_gen_prepare_string(yajl_gen g, const unsigned char * str, size_t len)
+{
+    yajl_gen_prepared p;
+    yajl_buf buf;
+
+    if (g->flags & yajl_gen_validate_utf8) {
+        if (!yajl_string_validate_utf8(str, len)) return NULL;
+    }
+    buf = yajl_buf_alloc(&(g->alloc));
+    if (buf == NULL) return NULL;
+    yajl_buf_append(buf, "\"", 1);
+    yajl_string_encode((yajl_print_t)&yajl_buf_append, buf, str, len,
+                       g->flags & yajl_gen_escape_solidus);
+    yajl_buf_append(buf, "\"", 1);
+
+    p = NULL;
+    if (!yajl_buf_err(buf)) {
+        p = (yajl_gen_prepared) YA_MALLOC(&(g->alloc),
+            sizeof(struct yajl_gen_prepared_t) + yajl_buf_len(buf));
+    }
+    if (p != NULL) {
+        p->len = yajl_buf_len(buf);
+        memcpy(p->text, yajl_buf_data(buf), p->len);
+    }
+    yajl_buf_free(buf);
+    return p;
+}
+
+yajl_gen_status
+yajl_gen_prepared_string(yajl_gen g, yajl_gen_prepared str)
+{
+    ENSURE_VALID_STATE; INSERT_SEP; INSERT_WHITESPACE;
+    START_OFFSET;
+    PRINT_REF(g->ctx, str->text, str->len);
+    END_OFFSET;
+    APPENDED_ATOM;
+    FINAL_NEWLINE;
+    ENSURE_PRINTED;
     return yajl_gen_status_ok;
 }
 
+void
+yajl_gen_prepared_free(yajl_gen g, yajl_gen_prepared str)
+{
+    if (str != NULL) YA_FREE(&(g->alloc), str);
+}
+
 yajl_gen_status
 yajl_gen_null(yajl_gen g)
 {
@@ -328,6 +827,7 @@ yajl_gen_null(yajl_gen g)
     END_OFFSET;
     APPENDED_ATOM;
     FINAL_NEWLINE;
+    ENSURE_PRINTED;
     return yajl_gen_status_ok;
 }
 
@@ -342,15 +842,18 @@ yajl_gen_bool(yajl_gen g, int boolean)
     END_OFFSET;
     APPENDED_ATOM;
     FINAL_NEWLINE;
+    ENSURE_PRINTED;
     return yajl_gen_status_ok;
 }
 
 #ifdef YAJL_SUPPLEMENTARY
 #define ENSURE_VALID_STATE_SUP \
-    if (g->state[g->depth] != yajl_gen_map_key &&               \
-        g->state[g->depth] != yajl_gen_in_array &&              \
-        g->state[g->depth] != yajl_gen_complete) {              \
-        return yajl_gen_invalid_sup_item;                       \
+    if (g->inString) {                                               \
+        return yajl_gen_string_unbalanced;                           \
+    } else if (yajl_bs_current(g->stateStack) != yajl_gen_map_key && \
+        yajl_bs_current(g->stateStack) != yajl_gen_in_array &&       \
+        yajl_bs_current(g->stateStack) != yajl_gen_complete) {       \
+        return yajl_gen_invalid_sup_item;                            \
     }
 
 
@@ -367,6 +870,7 @@ yajl_gen_sup_integer(yajl_gen g, long long int number)
     g->print(g->ctx, i, (unsigned int)strlen(i));
     END_OFFSET;
     FINAL_NEWLINE;
+    ENSURE_PRINTED;
     return yajl_gen_status_ok;
 }
 
@@ -385,6 +889,7 @@ yajl_gen_sup_double(yajl_gen g, double number)
     g->print(g->ctx, i, (unsigned int)strlen(i));
     END_OFFSET;
     FINAL_NEWLINE;
+    ENSURE_PRINTED;
     return yajl_gen_status_ok;
 }
 
@@ -396,6 +901,7 @@ yajl_gen_sup_number(yajl_gen g, const char * s, size_t l)
     g->print(g->ctx, s, l);
     END_OFFSET;
     FINAL_NEWLINE;
+    ENSURE_PRINTED;
     return yajl_gen_status_ok;
 }
 
@@ -414,10 +920,11 @@ yajl_gen_sup_string(yajl_gen g, const unsigned char * str,
     ENSURE_VALID_STATE_SUP; INSERT_WHITESPACE_SUP;
     START_OFFSET;
     g->print(g->ctx, "\"", 1);
-    yajl_string_encode(g->print, g->ctx, str, len, g->flags & yajl_gen_escape_solidus);
+    yajl_string_encode(PRINT_REF, g->ctx, str, len, g->flags & yajl_gen_escape_solidus);
     g->print(g->ctx, "\"", 1);
     END_OFFSET;
     FINAL_NEWLINE;
+    ENSURE_PRINTED;
     return yajl_gen_status_ok;
 }
 
@@ -429,6 +936,7 @@ yajl_gen_sup_null(yajl_gen g)
     g->print(g->ctx, "null", strlen("null"));
     END_OFFSET;
     FINAL_NEWLINE;
+    ENSURE_PRINTED;
     return yajl_gen_status_ok;
 }
 
@@ -442,6 +950,7 @@ yajl_gen_sup_bool(yajl_gen g, int boolean)
     g->print(g->ctx, val, (unsigned int)strlen(val));
     END_OFFSET;
     FINAL_NEWLINE;
+    ENSURE_PRINTED;
     return yajl_gen_status_ok;
 }
 #endif
@@ -450,11 +959,11 @@ yajl_gen_status
 yajl_gen_map_open(yajl_gen g)
 {
     ENSURE_VALID_STATE; ENSURE_NOT_KEY; INSERT_SEP; INSERT_WHITESPACE;
-    INCREMENT_DEPTH;
-    g->state[g->depth] = yajl_gen_map_start;
+    PUSH_STATE(yajl_gen_map_start, 1);
     START_OFFSET;
     g->print(g->ctx, "{", 1);
     END_OFFSET;
+    ENSURE_PRINTED;
     return yajl_gen_status_ok;
 }
 
@@ -464,17 +973,19 @@ yajl_gen_map_close(yajl_gen g)
     yajl_gen_state state;
 
     ENSURE_VALID_STATE;
-    state = g->state[g->depth];
-    DECREMENT_DEPTH;
+    state = yajl_bs_current(g->stateStack);
+    POP_STATE;
     if (state != yajl_gen_map_start) {
-        if ((g->flags & yajl_gen_beautify)) g->print(g->ctx, "\n", 1);
-        INSERT_WHITESPACE;
+        if ((g->flags & yajl_gen_beautify)) {
+            yajl_gen_newline(g, yajl_bs_depth(g->stateStack));
+        }
     }
     START_OFFSET;
     g->print(g->ctx, "}", 1);
     END_OFFSET;
     APPENDED_ATOM;
     FINAL_NEWLINE;
+    ENSURE_PRINTED;
     return yajl_gen_status_ok;
 }
 
@@ -482,11 +993,11 @@ yajl_gen_status
 yajl_gen_array_open(yajl_gen g)
 {
     ENSURE_VALID_STATE; ENSURE_NOT_KEY; INSERT_SEP; INSERT_WHITESPACE;
-    INCREMENT_DEPTH;
-    g->state[g->depth] = yajl_gen_array_start;
+    PUSH_STATE(yajl_gen_array_start, 0);
     START_OFFSET;
     g->print(g->ctx, "[", 1);
     END_OFFSET;
+    ENSURE_PRINTED;
     return yajl_gen_status_ok;
 }
 
@@ -496,17 +1007,289 @@ yajl_gen_array_close(yajl_gen g)
     yajl_gen_state state;
 
     ENSURE_VALID_STATE;
-    state = g->state[g->depth];
-    DECREMENT_DEPTH;
+    state = yajl_bs_current(g->stateStack);
+    POP_STATE;
     if (state != yajl_gen_array_start) {
-        if ((g->flags & yajl_gen_beautify)) g->print(g->ctx, "\n", 1);
-        INSERT_WHITESPACE;
+        if ((g->flags & yajl_gen_beautify)) {
+            yajl_gen_newline(g, yajl_bs_depth(g->stateStack));
+        }
     }
     START_OFFSET;
     g->print(g->ctx, "]", 1);
     END_OFFSET;
     APPENDED_ATOM;
     FINAL_NEWLINE;
+    ENSURE_PRINTED;
+    return yajl_gen_status_ok;
+}
+
+/* bytes gathered by yajl_tree_generate() before calling a print callback */
+#define YAJL_GEN_BATCH 4096
+
+typedef struct
+{
+    yajl_print_t print;
+    void * ctx;
+    size_t used;
+    char buf[YAJL_GEN_BATCH];
+} yajl_gen_batch;
+
+static void
+yajl_gen_batch_flush(yajl_gen_batch * b)
+{
+    if (b->used > 0) b->print(b->ctx, b->buf, b->used);
+    b->used = 0;
+}
+
+static void
+yajl_gen_batch_print(void * ctx, const char * str, size_t len)
+{
+    yajl_gen_batch * b = (yajl_gen_batch *) ctx;
+
+    if (len > sizeof(b->buf) - b->used) {
+        yajl_gen_batch_flush(b);
+        if (len >= sizeof(b->buf)) {
+            b->print(b->ctx, str, len);
+            return;
+        }
+    }
+    memcpy(b->buf + b->used, str, len);
+    b->used += len;
+}
+
+/* output a string of a tree, quoted */
+static yajl_gen_status
+yajl_gen_tree_string(yajl_gen g, const char * str)
+{
+    size_t len = strlen(str);
+
+    if ((g->flags & yajl_gen_validate_utf8) &&
+        !yajl_string_validate_utf8((const unsigned char *) str, len))
+    {
+        return yajl_gen_invalid_string;
+    }
+    g->print(g->ctx, "\"", 1);
+    yajl_string_encode(PRINT_REF, g->ctx, (const unsigned char *) str, len,
+                       (g->flags & (yajl_gen_escape_solidus |
+                                    yajl_gen_canonical)) ==
+                       yajl_gen_escape_solidus);
+    g->print(g->ctx, "\"", 1);
+    return yajl_gen_status_ok;
+}
+
+/* byte order of the keys pointed to, then their order in the map */
+static int
+yajl_gen_key_compare(const void * a, const void * b)
+{
+    const char * const * ka = *(const char * const * const *) a;
+    const char * const * kb = *(const char * const * const *) b;
+    int c = strcmp(*ka, *kb);
+
+    if (c != 0) return c;
+    return ka < kb ? -1 : ka > kb;
+}
+
+/* the canonical number of a tree, in i: an integer exactly, others from
+ * their value as a double so that it doesn't matter how they were
+ * written */
+static int
+yajl_gen_tree_canonical_number(char * i, yajl_val v)
+{
+    if (v->u.number.flags & YAJL_NUMBER_INT_VALID) {
+        sprintf(i, "%lld", v->u.number.i);
+    } else if ((v->u.number.flags & YAJL_NUMBER_DOUBLE_VALID) &&
+               !isnan(v->u.number.d) && !isinf(v->u.number.d)) {
+        yajl_number_canonical(i, v->u.number.d);
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+static yajl_gen_status
+yajl_gen_tree_value(yajl_gen g, yajl_val v, size_t depth);
+
+/* output the members of a map in the byte order of their keys */
+static yajl_gen_status
+yajl_gen_tree_sorted_members(yajl_gen g, yajl_val v, size_t depth)
+{
+    const char ** keys = v->u.object.keys;
+    const char *** order;
+    size_t base, n;
+    yajl_gen_status s;
+
+    if (g->keyOrder == NULL) {
+        g->keyOrder = yajl_buf_alloc(&(g->alloc));
+        if (g->keyOrder == NULL) return yajl_gen_out_of_memory;
+    }
+    /* nested maps sort above this one in the same buffer, which may move,
+     * so it is found by offset */
+    base = yajl_buf_len(g->keyOrder);
+    for (n = 0; n < v->u.object.len; n++) {
+        const char ** key = keys + n;
+        yajl_buf_append(g->keyOrder, &key, sizeof(key));
+    }
+    if (yajl_buf_err(g->keyOrder)) {
+        yajl_buf_truncate(g->keyOrder, base);
+        return yajl_gen_out_of_memory;
+    }
+    order = (const char ***) (yajl_buf_data(g->keyOrder) + base);
+    qsort((void *) order, v->u.object.len, sizeof(*order),
+          &yajl_gen_key_compare);
+
+    s = yajl_gen_status_ok;
+    for (n = 0; n < v->u.object.len && s == yajl_gen_status_ok; n++) {
+        size_t k;
+
+        order = (const char ***) (yajl_buf_data(g->keyOrder) + base);
+        k = (size_t) (order[n] - keys);
+        if (n > 0) g->print(g->ctx, ",", 1);
+        s = yajl_gen_tree_string(g, keys[k]);
+        if (s != yajl_gen_status_ok) break;
+        g->print(g->ctx, ":", 1);
+        s = yajl_gen_tree_value(g, v->u.object.values[k], depth + 1);
+    }
+    yajl_buf_truncate(g->keyOrder, base);
+    return s;
+}
+
+/* output a tree value inside depth containers.  the separator before it
+ * has been output */
+static yajl_gen_status
+yajl_gen_tree_value(yajl_gen g, yajl_val v, size_t depth)
+{
+    /* canonical output has no whitespace */
+    int beautify = (g->flags & (yajl_gen_beautify | yajl_gen_canonical)) ==
+                   yajl_gen_beautify;
+    yajl_gen_status s;
+    char i[32];
+    size_t n;
+
+    if (v == NULL) {
+        g->print(g->ctx, "null", 4);
+        return yajl_gen_status_ok;
+    }
+    switch (v->type) {
+        case yajl_t_string:
+            return yajl_gen_tree_string(g, v->u.string);
+        case yajl_t_number:
+            if ((g->flags & yajl_gen_canonical) &&
+                yajl_gen_tree_canonical_number(i, v))
+            {
+                g->print(g->ctx, i, strlen(i));
+                break;
+            }
+            /* the text the number was parsed from is output as it was */
+            if (v->u.number.r != NULL) {
+                g->print(g->ctx, v->u.number.r, strlen(v->u.number.r));
+                break;
+            }
+            if (v->u.number.flags & YAJL_NUMBER_INT_VALID) {
+                sprintf(i, "%lld", v->u.number.i);
+            } else if ((v->u.number.flags & YAJL_NUMBER_DOUBLE_VALID) &&
+                       !isnan(v->u.number.d) && !isinf(v->u.number.d)) {
+                yajl_gen_format_double(i, v->u.number.d);
+            } else {
+                return yajl_gen_invalid_number;
+            }
+            g->print(g->ctx, i, strlen(i));
+            break;
+        case yajl_t_object:
+            if (g->maxDepth != 0 && depth >= g->maxDepth) {
+                return yajl_max_depth_exceeded;
+            }
+            g->print(g->ctx, "{", 1);
+            if (g->flags & yajl_gen_canonical) {
+                s = yajl_gen_tree_sorted_members(g, v, depth);
+                if (s != yajl_gen_status_ok) return s;
+                g->print(g->ctx, "}", 1);
+                break;
+            }
+            for (n = 0; n < v->u.object.len; n++) {
+                if (n > 0) g->print(g->ctx, ",", 1);
+                if (beautify) {
+                    yajl_gen_newline(g, depth + 1);
+                }
+                s = yajl_gen_tree_string(g, v->u.object.keys[n]);
+                if (s != yajl_gen_status_ok) return s;
+                if (beautify) g->print(g->ctx, ": ", 2);
+                else g->print(g->ctx, ":", 1);
+                s = yajl_gen_tree_value(g, v->u.object.values[n], depth + 1);
+                if (s != yajl_gen_status_ok) return s;
+            }
+            if (n > 0 && beautify) {
+                yajl_gen_newline(g, depth);
+            }
+            g->print(g->ctx, "}", 1);
+            break;
+        case yajl_t_array:
+            if (g->maxDepth != 0 && depth >= g->maxDepth) {
+                return yajl_max_depth_exceeded;
+            }
+            g->print(g->ctx, "[", 1);
+            for (n = 0; n < v->u.array.len; n++) {
+                if (n > 0) g->print(g->ctx, ",", 1);
+                if (beautify) {
+                    yajl_gen_newline(g, depth + 1);
+                }
+                s = yajl_gen_tree_value(g, v->u.array.values[n], depth + 1);
+                if (s != yajl_gen_status_ok) return s;
+            }
+            if (n > 0 && beautify) {
+                yajl_gen_newline(g, depth);
+            }
+            g->print(g->ctx, "]", 1);
+            break;
+        case yajl_t_true:
+            g->print(g->ctx, "true", 4);
+            break;
+        case yajl_t_false:
+            g->print(g->ctx, "false", 5);
+            break;
+        default:
+            g->print(g->ctx, "null", 4);
+            break;
+    }
+    return yajl_gen_status_ok;
+}
+
+yajl_gen_status
+yajl_tree_generate(yajl_gen g, yajl_val v)
+{
+    yajl_gen_batch * batch = NULL;
+    yajl_gen_batch batchBuffer;
+    yajl_gen_status s;
+
+    ENSURE_VALID_STATE; ENSURE_NOT_KEY; INSERT_SEP; INSERT_WHITESPACE;
+    START_OFFSET;
+    /* the internal buffer and the iov sink gather output already, a print
+     * callback is called for larger batches than single tokens */
+    if (g->print != (yajl_print_t)&yajl_buf_append && g->iov == NULL) {
+        batch = &batchBuffer;
+        batch->print = g->print;
+        batch->ctx = g->ctx;
+        batch->used = 0;
+        g->print = &yajl_gen_batch_print;
+        g->ctx = batch;
+    }
+    s = yajl_gen_tree_value(g, v, yajl_bs_depth(g->stateStack));
+    if (batch != NULL) {
+        yajl_gen_batch_flush(batch);
+        g->print = batch->print;
+        g->ctx = batch->ctx;
+    }
+    if (s != yajl_gen_status_ok) {
+        /* part of the value may have been output */
+        yajl_bs_set(g->stateStack, yajl_gen_error);
+        return s;
+    }
+    END_OFFSET;
+    APPENDED_ATOM;
+    /* canonical output has no whitespace, not even the final newline */
+    if (!(g->flags & yajl_gen_canonical)) {
+        FINAL_NEWLINE;
+    }
+    ENSURE_PRINTED;
     return yajl_gen_status_ok;
 }
 
@@ -520,6 +1303,237 @@ yajl_gen_get_buf(yajl_gen g, const unsigned char ** buf,
     return yajl_gen_status_ok;
 }
 
+yajl_gen_status
+yajl_gen_steal_buf(yajl_gen g, unsigned char ** buf, size_t * len)
+{
+    if (g->print != (yajl_print_t)&yajl_buf_append) return yajl_gen_no_buf;
+    *buf = yajl_buf_steal((yajl_buf)g->ctx, len);
+    if (*buf == NULL) return yajl_gen_out_of_memory;
+    yajl_gen_drop_savepoints(g);
+    return yajl_gen_status_ok;
+}
+
+yajl_gen_status
+yajl_gen_get_iov(yajl_gen g, const yajl_iovec ** iov, size_t * count)
+{
+    if (g->iov == NULL) return yajl_gen_no_buf;
+    yajl_gen_iov_flush(g->iov);
+    *iov = (const yajl_iovec *) yajl_buf_data(g->iov->iov);
+    *count = yajl_buf_len(g->iov->iov) / sizeof(yajl_iovec);
+    return yajl_gen_status_ok;
+}
+
+yajl_gen_status
+yajl_gen_savepoint(yajl_gen g, size_t * sp)
+{
+    yajl_gen_savepoint_rec rec;
+    size_t count;
+
+    if (g->print != (yajl_print_t)&yajl_buf_append && g->iov == NULL) {
+        return yajl_gen_no_buf;
+    }
+    if (g->inString) return yajl_gen_string_unbalanced;
+    if (g->savepoints == NULL) {
+        g->savepoints = yajl_buf_alloc(&(g->alloc));
+        g->savedBits = yajl_buf_alloc(&(g->alloc));
+        if (g->savepoints == NULL || g->savedBits == NULL) {
+            yajl_buf_free(g->savepoints);
+            yajl_buf_free(g->savedBits);
+            g->savepoints = g->savedBits = NULL;
+            return yajl_gen_out_of_memory;
+        }
+    }
+
+    if (g->iov != NULL) {
+        /* later copies start a piece of their own */
+        yajl_gen_iov_flush(g->iov);
+        rec.outLen = yajl_buf_len(g->iov->iov) / sizeof(yajl_iovec);
+        rec.outErr = g->iov->err;
+    } else {
+        rec.outLen = yajl_buf_len((yajl_buf)g->ctx);
+        rec.outErr = yajl_buf_err((yajl_buf)g->ctx);
+    }
+    rec.startOffset = g->startOffset;
+    rec.endOffset = g->endOffset;
+    rec.depth = g->stateStack.depth;
+    rec.current = g->stateStack.current;
+    rec.err = g->stateStack.err;
+    memcpy(rec.bits, g->stateStack.bits, sizeof(rec.bits));
+    rec.heapOffset = yajl_buf_len(g->savedBits);
+    rec.heapLen = yajl_bs_heap_used(g->stateStack);
+    count = yajl_buf_len(g->savepoints) / sizeof(rec);
+
+    yajl_buf_append(g->savedBits, g->stateStack.heap, rec.heapLen);
+    yajl_buf_append(g->savepoints, &rec, sizeof(rec));
+    if (yajl_buf_err(g->savedBits) || yajl_buf_err(g->savepoints)) {
+        yajl_buf_truncate(g->savedBits, rec.heapOffset);
+        yajl_buf_truncate(g->savepoints, count * sizeof(rec));
+        return yajl_gen_out_of_memory;
+    }
+    *sp = count;
+    return yajl_gen_status_ok;
+}
+
+/* the savepoint sp if it is held, else NULL */
+static const yajl_gen_savepoint_rec *
+yajl_gen_find_savepoint(yajl_gen g, size_t sp)
+{
+    if (g->savepoints == NULL ||
+        sp >= yajl_buf_len(g->savepoints) / sizeof(yajl_gen_savepoint_rec))
+    {
+        return NULL;
+    }
+    return (const yajl_gen_savepoint_rec *) yajl_buf_data(g->savepoints) + sp;
+}
+
+yajl_gen_status
+yajl_gen_rollback(yajl_gen g, size_t sp)
+{
+    const yajl_gen_savepoint_rec * rec = yajl_gen_find_savepoint(g, sp);
+
+    if (rec == NULL) return yajl_gen_invalid_savepoint;
+
+    if (rec->outErr) {
+        /* nothing was output since */
+    } else if (g->iov != NULL) {
+        g->iov->isOpen = 0;
+        g->iov->err = 0;
+        yajl_buf_truncate(g->iov->iov, rec->outLen * sizeof(yajl_iovec));
+    } else {
+        yajl_buf_truncate((yajl_buf)g->ctx, rec->outLen);
+    }
+    g->startOffset = rec->startOffset;
+    g->endOffset = rec->endOffset;
+    g->inString = 0;
+    g->utf8PendingLen = 0;
+
+    /* the heap only grows, so it still has room for the saved bytes */
+    g->stateStack.depth = rec->depth;
+    g->stateStack.current = rec->current;
+    g->stateStack.err = rec->err;
+    memcpy(g->stateStack.bits, rec->bits, sizeof(rec->bits));
+    if (rec->heapLen > 0) {
+        memcpy(g->stateStack.heap,
+               yajl_buf_data(g->savedBits) + rec->heapOffset, rec->heapLen);
+    }
+
+    yajl_buf_truncate(g->savedBits, rec->heapOffset);
+    yajl_buf_truncate(g->savepoints, sp * sizeof(yajl_gen_savepoint_rec));
+    return yajl_gen_status_ok;
+}
+
+yajl_gen_status
+yajl_gen_release_savepoint(yajl_gen g, size_t sp)
+{
+    const yajl_gen_savepoint_rec * rec = yajl_gen_find_savepoint(g, sp);
+
+    if (rec == NULL) return yajl_gen_invalid_savepoint;
+    yajl_buf_truncate(g->savedBits, rec->heapOffset);
+    yajl_buf_truncate(g->savepoints, sp * sizeof(yajl_gen_savepoint_rec));
+    return yajl_gen_status_ok;
+}
+
+/* the first state of the level g is in */
+static unsigned char
+yajl_gen_level_start(yajl_gen g)
+{
+    size_t d = yajl_bs_depth(g->stateStack);
+
+    if (d == 0) return yajl_gen_start;
+    return yajl_bs_is_map(g->stateStack, d - 1) ? yajl_gen_map_start
+                                                : yajl_gen_array_start;
+}
+
+/* the state of a level after values were added to it */
+static unsigned char
+yajl_gen_level_next(unsigned char start)
+{
+    switch (start) {
+        case yajl_gen_map_start: return yajl_gen_map_key;
+        case yajl_gen_array_start: return yajl_gen_in_array;
+        default: return yajl_gen_complete;
+    }
+}
+
+yajl_gen_status
+yajl_gen_begin_fragment(yajl_gen frag, yajl_gen g)
+{
+    unsigned char start = yajl_gen_level_start(g);
+    unsigned char state = yajl_bs_current(g->stateStack);
+
+    if (frag->print != (yajl_print_t)&yajl_buf_append) return yajl_gen_no_buf;
+    ENSURE_VALID_STATE;
+    if (state != start &&
+        (start == yajl_gen_start || state != yajl_gen_level_next(start)))
+    {
+        return yajl_gen_fragment_mismatch;
+    }
+
+    yajl_bs_copy(frag->stateStack, g->stateStack, start);
+    if (yajl_bs_err(frag->stateStack)) {
+        frag->stateStack.err = 0;
+        return yajl_gen_out_of_memory;
+    }
+    frag->fragDepth = yajl_bs_depth(g->stateStack);
+    frag->fragState = start;
+    frag->flags = (frag->flags & yajl_gen_collect_stats) |
+                  (g->flags & ~yajl_gen_collect_stats);
+    frag->maxDepth = g->maxDepth;
+    frag->indentString = g->indentString;
+    frag->indentLen = g->indentLen;
+    frag->indentRunLen = 0;
+    frag->inString = 0;
+    frag->utf8PendingLen = 0;
+    frag->startOffset = frag->endOffset = 0;
+    yajl_gen_clear(frag);
+    return yajl_gen_status_ok;
+}
+
+yajl_gen_status
+yajl_gen_splice(yajl_gen g, yajl_gen frag)
+{
+    unsigned char next = yajl_gen_level_next(frag->fragState);
+    unsigned char state = yajl_bs_current(g->stateStack);
+    yajl_buf buf = (yajl_buf)frag->ctx;
+    size_t base;
+
+    ENSURE_VALID_STATE;
+    if (frag->print != (yajl_print_t)&yajl_buf_append) return yajl_gen_no_buf;
+    if (frag->inString) return yajl_gen_string_unbalanced;
+    if (yajl_bs_current(frag->stateStack) == yajl_gen_error) {
+        return yajl_gen_in_error_state;
+    }
+    if (yajl_buf_err(buf)) return yajl_gen_out_of_memory;
+    if (yajl_bs_depth(g->stateStack) != frag->fragDepth ||
+        yajl_gen_level_start(g) != frag->fragState ||
+        (state != frag->fragState && state != next) ||
+        yajl_bs_depth(frag->stateStack) != frag->fragDepth)
+    {
+        return yajl_gen_fragment_mismatch;
+    }
+    if (yajl_bs_current(frag->stateStack) == frag->fragState) {
+        /* nothing was generated */
+        return yajl_gen_status_ok;
+    }
+    if (yajl_bs_current(frag->stateStack) != next) {
+        return yajl_gen_fragment_mismatch;
+    }
+
+    if (state == next) g->print(g->ctx, ",", 1);
+    if (g->print == (yajl_print_t)&yajl_buf_append) {
+        base = yajl_buf_len((yajl_buf)g->ctx);
+        g->startOffset = base + frag->startOffset;
+        g->endOffset = base + frag->endOffset;
+    }
+    g->print(g->ctx, (const char *) yajl_buf_data(buf), yajl_buf_len(buf));
+    yajl_bs_set(g->stateStack, next);
+    ENSURE_PRINTED;
+
+    yajl_gen_clear(frag);
+    yajl_bs_set(frag->stateStack, frag->fragState);
+    return yajl_gen_status_ok;
+}
+
 size_t
 yajl_gen_get_start_offset(yajl_gen g)
 {
@@ -536,4 +1550,6 @@ void
 yajl_gen_clear(yajl_gen g)
 {
     if (g->print == (yajl_print_t)&yajl_buf_append) yajl_buf_clear((yajl_buf)g->ctx);
+    if (g->iov != NULL) yajl_gen_iov_clear(g->iov);
+    yajl_gen_drop_savepoints(g);
 }
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2007-2014, Lloyd Hilaiel <me@lloyd.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "yajl_hash.h"
+
+#define YAJL_HASH_P1 0x9e3779b185ebca87ULL
+#define YAJL_HASH_P2 0xc2b2ae3d27d4eb4fULL
+#define YAJL_HASH_P3 0x165667b19e3779f9ULL
+
+#define YAJL_HASH_ROTL(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+/* mix a whole word into the state */
+#define YAJL_HASH_ROUND(h, w)                                           \
+    ((h) = YAJL_HASH_ROTL((h) ^ ((w) * YAJL_HASH_P2), 31)               \
+           * YAJL_HASH_P1 + YAJL_HASH_P3)
+
+void
+yajl_hash_init(yajl_hash * hs, unsigned long long seed)
+{
+    hs->h = seed * YAJL_HASH_P1 + YAJL_HASH_P3;
+    hs->tail = 0;
+    hs->tailLen = 0;
+    hs->len = 0;
+}
+
+void
+yajl_hash_update(yajl_hash * hs, const unsigned char * buf, size_t len)
+{
+    const unsigned char * end = buf + len;
+
+    hs->len += len;
+
+    /* finish the word begun by the last update */
+    while (hs->tailLen > 0 && buf < end) {
+        hs->tail |= (unsigned long long) *buf++ << (8 * hs->tailLen);
+        if (++hs->tailLen == 8) {
+            YAJL_HASH_ROUND(hs->h, hs->tail);
+            hs->tail = 0;
+            hs->tailLen = 0;
+        }
+    }
+
+    while (end - buf >= 8) {
+        unsigned long long w =
+            (unsigned long long) buf[0] |
+            (unsigned long long) buf[1] << 8 |
+            (unsigned long long) buf[2] << 16 |
+            (unsigned long long) buf[3] << 24 |
+            (unsigned long long) buf[4] << 32 |
+            (unsigned long long) buf[5] << 40 |
+            (unsigned long long) buf[6] << 48 |
+            (unsigned long long) buf[7] << 56;
+        YAJL_HASH_ROUND(hs->h, w);
+        buf += 8;
+    }
+
+    while (buf < end) {
+        hs->tail |= (unsigned long long) *buf++ << (8 * hs->tailLen++);
+    }
+}
+
+void
+yajl_hash_word(yajl_hash * hs, unsigned long long w)
+{
+    if (hs->tailLen == 0) {
+        hs->len += 8;
+        YAJL_HASH_ROUND(hs->h, w);
+    } else {
+        unsigned char b[8];
+        unsigned int i;
+        for (i = 0; i < 8; i++) b[i] = (unsigned char) (w >> (8 * i));
+        yajl_hash_update(hs, b, 8);
+    }
+}
+
+unsigned long long
+yajl_hash_final(const yajl_hash * hs)
+{
+    unsigned long long h = hs->h ^ hs->len;
+
+    if (hs->tailLen > 0) YAJL_HASH_ROUND(h, hs->tail);
+    return yajl_hash_mix(h);
+}
+
+unsigned long long
+yajl_hash_mix(unsigned long long x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
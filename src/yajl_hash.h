@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2007-2014, Lloyd Hilaiel <me@lloyd.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __YAJL_HASH_H__
+#define __YAJL_HASH_H__
+
+#include <stddef.h>
+
+/*
+ * A fast 64-bit hash, not a cryptographic one, computed incrementally.
+ * Input is taken eight bytes at a time in little endian order, so the
+ * result doesn't depend on how it is split up nor on the byte order of
+ * the machine.
+ */
+typedef struct yajl_hash_t
+{
+    unsigned long long h;
+    /* bytes not making up a whole word yet */
+    unsigned long long tail;
+    unsigned int tailLen;
+    unsigned long long len;
+} yajl_hash;
+
+/* start a hash.  different seeds give unrelated hashes of the same bytes */
+void yajl_hash_init(yajl_hash * hs, unsigned long long seed);
+
+/* add len bytes to the hash */
+void yajl_hash_update(yajl_hash * hs, const unsigned char * buf, size_t len);
+
+/* add the eight bytes of w, least significant first */
+void yajl_hash_word(yajl_hash * hs, unsigned long long w);
+
+/* the hash of the bytes added so far.  more may be added afterwards */
+unsigned long long yajl_hash_final(const yajl_hash * hs);
+
+/* scramble the bits of x, so that similar values give unrelated ones */
+unsigned long long yajl_hash_mix(unsigned long long x);
+
+#endif
@@ -41,6 +41,9 @@ tokToStr(yajl_tok tok)
         case yajl_tok_right_bracket: return "bracket";
         case yajl_tok_string: return "string";
         case yajl_tok_string_with_escapes: return "string_with_escapes";
+        case yajl_tok_string_segments: return "string_segments";
+        case yajl_tok_string_part: return "string_part";
+        case yajl_tok_string_end: return "string_end";
     }
     return "unknown";
 }
@@ -120,6 +123,35 @@ struct yajl_lexer_t {
     unsigned int validateUTF8;
 
     yajl_alloc_funcs * alloc;
+
+    /* bytes copied into buf, for statistics */
+    size_t bufferedBytes;
+
+    /* longest token accepted, 0 for no limit */
+    size_t maxTokenLength;
+
+    /* keep the pieces of a token spread over multiple chunks in the
+     * chunks, which the client promised to retain, rather than in buf */
+    unsigned int retainChunks;
+    /* hand out strings without escapes as pieces, see
+     * yajl_tok_string_segments */
+    unsigned int segmentStrings;
+    /* the pieces, an array of yajl_segment, their total length and the
+     * chunk holding the first one */
+    yajl_buf segs;
+    size_t segLen;
+    const unsigned char * firstChunk;
+
+    /* hand out a string starting in the next call to yajl_lex_lex in
+     * pieces, see yajl_tok_string_part */
+    unsigned int streamStrings;
+    /* a string is being handed out in pieces, and the bytes so far */
+    unsigned int streaming;
+    size_t streamedLen;
+
+    /* bytes of input making up the last token, counting the parts in
+     * earlier chunks */
+    size_t tokenLen;
 };
 
 #define readChar(lxr, txt, off) ((txt)[(*(off))++])
@@ -130,8 +162,16 @@ yajl_lex_alloc(yajl_alloc_funcs * alloc,
                unsigned int allowComments, unsigned int validateUTF8)
 {
     yajl_lexer lxr = (yajl_lexer) YA_MALLOC(alloc, sizeof(struct yajl_lexer_t));
+    if (lxr == NULL) return NULL;
     memset((void *) lxr, 0, sizeof(struct yajl_lexer_t));
     lxr->buf = yajl_buf_alloc(alloc);
+    lxr->segs = yajl_buf_alloc(alloc);
+    if (lxr->buf == NULL || lxr->segs == NULL) {
+        yajl_buf_free(lxr->buf);
+        yajl_buf_free(lxr->segs);
+        YA_FREE(alloc, lxr);
+        return NULL;
+    }
     lxr->allowComments = allowComments;
     lxr->validateUTF8 = validateUTF8;
     lxr->alloc = alloc;
@@ -141,14 +181,155 @@ yajl_lex_alloc(yajl_alloc_funcs * alloc,
 void
 yajl_lex_reset(yajl_lexer lxr)
 {
+    lxr->lineOff = 0;
+    lxr->charOff = 0;
     lxr->error = yajl_lex_e_ok;
     lxr->state = state_start;
+    lxr->substate = 0;
+    lxr->subsubstate = 0;
+    yajl_buf_clear(lxr->buf);
+    yajl_buf_clear(lxr->segs);
+    lxr->segLen = 0;
+    lxr->streamStrings = 0;
+    lxr->streaming = 0;
+    lxr->streamedLen = 0;
+}
+
+void
+yajl_lex_config(yajl_lexer lxr, unsigned int allowComments,
+                unsigned int validateUTF8)
+{
+    lxr->allowComments = allowComments;
+    lxr->validateUTF8 = validateUTF8;
+}
+
+void
+yajl_lex_set_max_token_length(yajl_lexer lxr, size_t maxTokenLength)
+{
+    lxr->maxTokenLength = maxTokenLength;
+}
+
+void
+yajl_lex_retain_chunks(yajl_lexer lxr, unsigned int retainChunks,
+                       unsigned int segmentStrings)
+{
+    lxr->retainChunks = retainChunks;
+    lxr->segmentStrings = retainChunks && segmentStrings;
+}
+
+void
+yajl_lex_stream_strings(yajl_lexer lxr, unsigned int streamStrings)
+{
+    lxr->streamStrings = streamStrings;
+}
+
+size_t
+yajl_lex_token_length(yajl_lexer lxr)
+{
+    return lxr->tokenLen;
+}
+
+int
+yajl_lex_in_token(yajl_lexer lxr)
+{
+    return lxr->state != state_start;
+}
+
+const unsigned char *
+yajl_lex_retained_chunk(yajl_lexer lxr)
+{
+    if (lxr->state == state_start || yajl_buf_len(lxr->segs) == 0) {
+        return NULL;
+    }
+    return lxr->firstChunk;
+}
+
+const yajl_segment *
+yajl_lex_segments(yajl_lexer lxr, size_t * count)
+{
+    *count = yajl_buf_len(lxr->segs) / sizeof(yajl_segment);
+    return (const yajl_segment *) yajl_buf_data(lxr->segs);
+}
+
+/* copy the pieces of the token into buf */
+static int
+yajl_lex_copy_segments(yajl_lexer lxr)
+{
+    size_t count;
+    const yajl_segment * seg = yajl_lex_segments(lxr, &count);
+
+    yajl_buf_clear(lxr->buf);
+    for (; count > 0; count--, seg++) {
+        yajl_buf_append(lxr->buf, seg->buf, seg->len);
+    }
+    lxr->bufferedBytes += lxr->segLen;
+    return !yajl_buf_err(lxr->buf);
+}
+
+int
+yajl_lex_stitch(yajl_lexer lxr, const unsigned char ** outBuf,
+                size_t * outLen)
+{
+    if (!yajl_lex_copy_segments(lxr)) {
+        lxr->error = yajl_lex_out_of_memory;
+        return 0;
+    }
+    *outBuf = yajl_buf_data(lxr->buf);
+    *outLen = yajl_buf_len(lxr->buf);
+    return 1;
+}
+
+/* remember the piece of the token in this chunk */
+static int
+yajl_lex_add_segment(yajl_lexer lxr, const unsigned char * chunk,
+                     const unsigned char * data, size_t len)
+{
+    yajl_segment seg;
+
+    if (len == 0) return 1;
+    if (yajl_buf_len(lxr->segs) == 0) lxr->firstChunk = chunk;
+    seg.buf = data;
+    seg.len = len;
+    yajl_buf_append(lxr->segs, &seg, sizeof(seg));
+    lxr->segLen += len;
+    return !yajl_buf_err(lxr->segs);
+}
+
+/* drop the quotes around a string held as pieces, and the pieces they
+ * leave empty */
+static void
+yajl_lex_unquote_segments(yajl_lexer lxr)
+{
+    size_t count;
+    yajl_segment * segs = (yajl_segment *) yajl_lex_segments(lxr, &count);
+
+    assert(count >= 1 && segs[0].len >= 1 && segs[count - 1].len >= 1);
+    segs[0].buf++;
+    segs[0].len--;
+    segs[count - 1].len--;
+    lxr->segLen -= 2;
+    if (segs[count - 1].len == 0) count--;
+    if (count > 0 && segs[0].len == 0) {
+        memmove(segs, segs + 1, --count * sizeof(yajl_segment));
+    }
+    yajl_buf_truncate(lxr->segs, count * sizeof(yajl_segment));
+}
+
+void
+yajl_lex_get_stats(yajl_lexer lxr, yajl_stats * stats)
+{
+    size_t capacity = yajl_buf_peak_capacity(lxr->buf);
+
+    stats->lexBufferedBytes += lxr->bufferedBytes;
+    stats->bufGrows += yajl_buf_grows(lxr->buf);
+    if (capacity > stats->peakBufCapacity) stats->peakBufCapacity = capacity;
 }
 
 void
 yajl_lex_free(yajl_lexer lxr)
 {
     yajl_buf_free(lxr->buf);
+    yajl_buf_free(lxr->segs);
     YA_FREE(lxr->alloc, lxr);
     return;
 }
@@ -584,9 +765,11 @@ yajl_lex_lex(yajl_lexer lexer, const unsigned char * jsonText,
     unsigned char c;
     size_t startOffset = *offset;
     static unsigned char expect[] = "rue\0alse\0ull";
+    unsigned int streamStrings = lexer->streamStrings;
 
     *outBuf = NULL;
     *outLen = 0;
+    lexer->streamStrings = 0;
 
     /* if entryState != state_start then buffer is in use */
     yajl_lex_state entryState = lexer->state;
@@ -606,6 +789,8 @@ yajl_lex_lex(yajl_lexer lexer, const unsigned char * jsonText,
     }
 
     yajl_buf_clear(lexer->buf);
+    yajl_buf_clear(lexer->segs);
+    lexer->segLen = 0;
     for (;;) {
         assert(*offset <= jsonTextLen);
 
@@ -712,6 +897,8 @@ yajl_lex_lex(yajl_lexer lexer, const unsigned char * jsonText,
                     /* behave as if we had returned a token then re-entered */
                     tok = yajl_tok_error;
                     yajl_buf_clear(lexer->buf);
+                    yajl_buf_clear(lexer->segs);
+                    lexer->segLen = 0;
                     lexer->state = state_start;
                     entryState = state_start;
                     startOffset = *offset;
@@ -728,11 +915,79 @@ yajl_lex_lex(yajl_lexer lexer, const unsigned char * jsonText,
 
 
   lexed:
+    lexer->tokenLen =
+        (lexer->retainChunks ? lexer->segLen : yajl_buf_len(lexer->buf)) +
+        lexer->streamedLen + (*offset - startOffset);
+
+    /* the token, or the part of it read so far, may not be too long.  the
+     * rest of this chunk is not buffered then */
+    if (lexer->maxTokenLength != 0 && tok != yajl_tok_error &&
+        lexer->tokenLen > lexer->maxTokenLength)
+    {
+        lexer->error = yajl_lex_token_too_long;
+        tok = yajl_tok_error;
+        entryState = state_start;
+    }
+
     /* need to append to buffer if the buffer is in use or
      * if it's an EOF token */
-    if (tok == yajl_tok_eof || entryState != state_start) {
+    if (lexer->streaming ||
+        (streamStrings && tok == yajl_tok_eof &&
+         lexer->state == state_string && entryState == state_start))
+    {
+        /* the string is handed out as it arrives, nothing is buffered.
+         * the opening quote is in this chunk if the string started here */
+        size_t start = startOffset + (entryState == state_start);
+
+        if (tok == yajl_tok_eof) {
+            *outBuf = jsonText + start;
+            *outLen = *offset - start;
+            tok = yajl_tok_string_part;
+            lexer->streaming = 1;
+            lexer->streamedLen += *offset - startOffset;
+        } else {
+            if (tok != yajl_tok_error) {
+                *outBuf = jsonText + start;
+                *outLen = *offset - start - 1;
+                tok = yajl_tok_string_end;
+            }
+            lexer->streaming = 0;
+            lexer->streamedLen = 0;
+            lexer->state = state_start;
+        }
+    } else if ((tok == yajl_tok_eof || entryState != state_start) &&
+               lexer->retainChunks)
+    {
+        /* the token stays in the chunks, and is only copied together if
+         * it is complete and can't be handed out in pieces */
+        if (!yajl_lex_add_segment(lexer, jsonText, jsonText + startOffset,
+                                  *offset - startOffset))
+        {
+            lexer->error = yajl_lex_out_of_memory;
+            tok = yajl_tok_error;
+        }
+        if (tok == yajl_tok_string && lexer->segmentStrings) {
+            yajl_lex_unquote_segments(lexer);
+            tok = yajl_tok_string_segments;
+            *outLen = lexer->segLen;
+        } else if (tok != yajl_tok_eof && tok != yajl_tok_error) {
+            if (!yajl_lex_copy_segments(lexer)) {
+                lexer->error = yajl_lex_out_of_memory;
+                tok = yajl_tok_error;
+            } else {
+                *outBuf = yajl_buf_data(lexer->buf);
+                *outLen = yajl_buf_len(lexer->buf);
+            }
+        }
+        if (tok != yajl_tok_eof) lexer->state = state_start;
+    } else if (tok == yajl_tok_eof || entryState != state_start) {
         yajl_buf_append(lexer->buf, jsonText + startOffset,
                         *offset - startOffset);
+        lexer->bufferedBytes += *offset - startOffset;
+        if (yajl_buf_err(lexer->buf)) {
+            lexer->error = yajl_lex_out_of_memory;
+            tok = yajl_tok_error;
+        }
         if (tok != yajl_tok_eof) {
             if (tok != yajl_tok_error) { /* Nick added this test, see below */
                 *outBuf = yajl_buf_data(lexer->buf);
@@ -758,6 +1013,8 @@ yajl_lex_lex(yajl_lexer lexer, const unsigned char * jsonText,
         assert(*outLen >= 2);
         (*outBuf)++;
         *outLen -= 2;
+        /* a whole string, as its only piece */
+        if (streamStrings) tok = yajl_tok_string_end;
     }
 
 
@@ -819,6 +1076,10 @@ yajl_lex_error_to_string(yajl_lex_error error)
         case yajl_lex_missing_exponent_before_plus:
             return "malformed number, an exponent is required before the "
                    "plus sign.";
+        case yajl_lex_out_of_memory:
+            return "out of memory buffering a token.";
+        case yajl_lex_token_too_long:
+            return "token exceeds the maximum length.";
     }
     return "unknown error code";
 }
@@ -849,18 +1110,35 @@ yajl_tok yajl_lex_peek(yajl_lexer lexer, const unsigned char * jsonText,
     const unsigned char * outBuf;
     size_t outLen;
     size_t bufLen = yajl_buf_len(lexer->buf);
+    size_t segsLen = yajl_buf_len(lexer->segs);
+    size_t segLen = lexer->segLen;
     yajl_lex_state state = lexer->state;
     int substate = lexer->substate;
     int subsubstate = lexer->subsubstate;
+    unsigned int segmentStrings = lexer->segmentStrings;
+    unsigned int streamStrings = lexer->streamStrings;
+    unsigned int streaming = lexer->streaming;
+    size_t streamedLen = lexer->streamedLen;
     yajl_tok tok;
 
+    /* pieces are unquoted in place, which can't be undone */
+    lexer->segmentStrings = 0;
     tok = yajl_lex_lex(lexer, jsonText, jsonTextLen, &offset,
                        &outBuf, &outLen);
+    if (tok == yajl_tok_string && segmentStrings) {
+        tok = yajl_tok_string_segments;
+    }
 
+    lexer->segmentStrings = segmentStrings;
+    lexer->streamStrings = streamStrings;
+    lexer->streaming = streaming;
+    lexer->streamedLen = streamedLen;
     lexer->state = state;
     lexer->substate = substate;
     lexer->subsubstate = subsubstate;
     yajl_buf_truncate(lexer->buf, bufLen);
+    yajl_buf_truncate(lexer->segs, segsLen);
+    lexer->segLen = segLen;
 
     return tok;
 }
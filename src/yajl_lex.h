@@ -17,7 +17,7 @@
 #ifndef __YAJL_LEX_H__
 #define __YAJL_LEX_H__
 
-#include "api/yajl_common.h"
+#include "api/yajl_parse.h"
 
 typedef enum {
     yajl_tok_bool,
@@ -41,19 +41,81 @@ typedef enum {
     yajl_tok_string,
     yajl_tok_string_with_escapes,
 
+    /* a string without escapes spread over multiple chunks, which are
+     * retained by the client.  it is left in the chunks, get the pieces
+     * with yajl_lex_segments() */
+    yajl_tok_string_segments,
+
+    /* a string handed out in pieces as it arrives, see
+     * yajl_lex_stream_strings().  the pieces are the raw text between the
+     * quotes, which may end part way through an escape sequence.  each
+     * piece but the last is yajl_tok_string_part and ends the chunk */
+    yajl_tok_string_part,
+    yajl_tok_string_end,
+
     /* comment tokens are not currently returned to the parser, ever */
     yajl_tok_comment
 } yajl_tok;
 
 typedef struct yajl_lexer_t * yajl_lexer;
 
+/* returns NULL if out of memory */
 yajl_lexer yajl_lex_alloc(yajl_alloc_funcs * alloc,
                           unsigned int allowComments,
                           unsigned int validateUTF8);
+/* return the lexer to its initial state, keeping the memory it has
+ * allocated for buffering tokens */
 void yajl_lex_reset(yajl_lexer lexer);
 
+/* change the options given to yajl_lex_alloc */
+void yajl_lex_config(yajl_lexer lexer, unsigned int allowComments,
+                     unsigned int validateUTF8);
+
 void yajl_lex_free(yajl_lexer lexer);
 
+/* limit the length of tokens, 0 for no limit.  a longer token is a
+ * yajl_lex_token_too_long error */
+void yajl_lex_set_max_token_length(yajl_lexer lexer, size_t maxTokenLength);
+
+/* leave tokens spread over multiple chunks in the chunks instead of
+ * copying them piece by piece as they are lexed, the client retains the
+ * chunks.  they are copied together once complete, except strings without
+ * escapes if segmentStrings is set, which are returned as
+ * yajl_tok_string_segments */
+void yajl_lex_retain_chunks(yajl_lexer lexer, unsigned int retainChunks,
+                            unsigned int segmentStrings);
+
+/* hand out a string which starts in the next call to yajl_lex_lex in
+ * pieces, as yajl_tok_string_part and yajl_tok_string_end tokens, rather
+ * than buffering it until it is complete */
+YAJL_API void yajl_lex_stream_strings(yajl_lexer lexer,
+                                      unsigned int streamStrings);
+
+/* the number of bytes of input the last token took up, including those
+ * in earlier chunks and the quotes of a string */
+size_t yajl_lex_token_length(yajl_lexer lexer);
+
+/* is the lexer part way through a token? */
+int yajl_lex_in_token(yajl_lexer lexer);
+
+/* the earliest chunk holding part of an unfinished token, NULL if no
+ * chunk is needed any more */
+const unsigned char * yajl_lex_retained_chunk(yajl_lexer lexer);
+
+/* the pieces of the string returned as yajl_tok_string_segments, without
+ * the quotes */
+YAJL_API const yajl_segment * yajl_lex_segments(yajl_lexer lexer,
+                                                size_t * count);
+
+/* copy the pieces of the string returned as yajl_tok_string_segments
+ * together, for a caller which needs it in one piece.  returns 0 if out of
+ * memory */
+YAJL_API int yajl_lex_stitch(yajl_lexer lexer, const unsigned char ** outBuf,
+                             size_t * outLen);
+
+/* add the lexer's buffering figures to stats */
+void yajl_lex_get_stats(yajl_lexer lexer, yajl_stats * stats);
+
 /**
  * run/continue a lex. "offset" is an input/output parameter.
  * It should be initialized to zero for a
@@ -76,9 +138,11 @@ void yajl_lex_free(yajl_lexer lexer);
  * implications which require that the client choose a reasonable chunk
  * size to get adequate performance.
  */
-yajl_tok yajl_lex_lex(yajl_lexer lexer, const unsigned char * jsonText,
-                      size_t jsonTextLen, size_t * offset,
-                      const unsigned char ** outBuf, size_t * outLen);
+YAJL_API yajl_tok yajl_lex_lex(yajl_lexer lexer,
+                               const unsigned char * jsonText,
+                               size_t jsonTextLen, size_t * offset,
+                               const unsigned char ** outBuf,
+                               size_t * outLen);
 
 /** have a peek at the next token, but don't move the lexer forward */
 yajl_tok yajl_lex_peek(yajl_lexer lexer, const unsigned char * jsonText,
@@ -101,7 +165,9 @@ typedef enum {
     /* yajl_rev_lex_lex() specific error messages: */
     yajl_lex_missing_integer_before_exponent,
     yajl_lex_missing_integer_before_decimal,
-    yajl_lex_missing_exponent_before_plus
+    yajl_lex_missing_exponent_before_plus,
+    yajl_lex_out_of_memory,
+    yajl_lex_token_too_long
 } yajl_lex_error;
 
 const char * yajl_lex_error_to_string(yajl_lex_error error);
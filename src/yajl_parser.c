@@ -18,7 +18,7 @@
 #include "yajl_lex.h"
 #include "yajl_parser.h"
 #include "yajl_encode.h"
-#include "yajl_bytestack.h"
+#include "yajl_bitstack.h"
 
 #include <stdlib.h>
 #include <limits.h>
@@ -61,6 +61,328 @@ yajl_parse_integer(const unsigned char *number, unsigned int length)
     return sign * ret;
 }
 
+/* seeds keeping the hashes of different kinds of values apart */
+#define YAJL_HASH_STRING 1
+#define YAJL_HASH_INTEGER 2
+#define YAJL_HASH_DOUBLE 3
+#define YAJL_HASH_TRUE 4
+#define YAJL_HASH_FALSE 5
+#define YAJL_HASH_NULL 6
+#define YAJL_HASH_ARRAY 7
+#define YAJL_HASH_MAP 8
+#define YAJL_HASH_MEMBER 9
+
+/* the hash of a container being parsed */
+typedef struct
+{
+    /* an array: the hashes of the elements in order */
+    yajl_hash seq;
+    /* a map: the hash of the key waiting for its value, and the sum of the
+     * hashes of the members, which doesn't depend on their order */
+    unsigned long long key;
+    unsigned long long sum;
+    size_t count;
+} yajl_hash_frame;
+
+/* add the hash of a value or key to the container depth levels in */
+static void
+yajl_hash_feed(yajl_handle hand, unsigned long long h, int isKey,
+               size_t depth)
+{
+    yajl_hash_frame * f;
+
+    if (depth == 0 ||
+        depth > yajl_buf_len(hand->hashFrames) / sizeof(yajl_hash_frame))
+    {
+        return;
+    }
+    f = (yajl_hash_frame *) yajl_buf_data(hand->hashFrames) + depth - 1;
+    if (isKey) {
+        f->key = h;
+    } else if (yajl_bs_is_map(hand->stateStack, depth - 1)) {
+        f->sum += yajl_hash_mix(f->key +
+                                yajl_hash_mix(h ^ YAJL_HASH_MEMBER));
+        f->count++;
+    } else {
+        yajl_hash_word(&(f->seq), h);
+        f->count++;
+    }
+}
+
+/* begin the hash of the integer i */
+static void
+yajl_hash_integer(yajl_hash * hs, long long i)
+{
+    yajl_hash_init(hs, YAJL_HASH_INTEGER);
+    yajl_hash_word(hs, (unsigned long long) i);
+}
+
+/* begin the hash of the number d: whole numbers as the integer they are,
+ * others by their double */
+static void
+yajl_hash_double(yajl_hash * hs, double d)
+{
+    unsigned long long bits;
+    long long i;
+
+    if (yajl_number_integer(d, &i)) {
+        yajl_hash_integer(hs, i);
+    } else {
+        memcpy(&bits, &d, sizeof(bits));
+        yajl_hash_init(hs, YAJL_HASH_DOUBLE);
+        yajl_hash_word(hs, bits);
+    }
+}
+
+/* hash the number token by the value yajl_gen_canonical prints: an
+ * integer that fits a long long exactly, others by their value as a
+ * double */
+static int
+yajl_hash_number(yajl_handle hand, yajl_hash * hs, yajl_tok tok,
+                 const unsigned char * buf, size_t bufLen)
+{
+    char local[64];
+    const char * text = local;
+    long long i;
+
+    if (tok == yajl_tok_integer) {
+        errno = 0;
+        i = yajl_parse_integer(buf, bufLen);
+        if (errno == 0) {
+            yajl_hash_integer(hs, i);
+            return 1;
+        }
+    }
+    if (bufLen < sizeof(local)) {
+        memcpy(local, buf, bufLen);
+        local[bufLen] = 0;
+    } else {
+        yajl_buf_clear(hand->decodeBuf);
+        yajl_buf_append(hand->decodeBuf, buf, bufLen);
+        if (yajl_buf_err(hand->decodeBuf)) return 0;
+        text = (const char *) yajl_buf_data(hand->decodeBuf);
+    }
+    yajl_hash_double(hs, strtod(text, NULL));
+    return 1;
+}
+
+int
+yajl_hash_token(yajl_handle hand, yajl_tok tok, const unsigned char * buf,
+                size_t bufLen, int isKey)
+{
+    yajl_hash hs;
+
+    switch (tok) {
+        case yajl_tok_string:
+            yajl_hash_init(&hs, YAJL_HASH_STRING);
+            yajl_hash_update(&hs, buf, bufLen);
+            break;
+        case yajl_tok_string_segments: {
+            size_t count, i;
+            const yajl_segment * segs = yajl_lex_segments(hand->lexer, &count);
+            yajl_hash_init(&hs, YAJL_HASH_STRING);
+            for (i = 0; i < count; i++) {
+                yajl_hash_update(&hs, segs[i].buf, segs[i].len);
+            }
+            break;
+        }
+        case yajl_tok_bool:
+            yajl_hash_init(&hs, *buf == 't' ? YAJL_HASH_TRUE : YAJL_HASH_FALSE);
+            break;
+        case yajl_tok_null:
+            yajl_hash_init(&hs, YAJL_HASH_NULL);
+            break;
+        case yajl_tok_integer:
+        case yajl_tok_double:
+            if (!yajl_hash_number(hand, &hs, tok, buf, bufLen)) return 0;
+            break;
+        case yajl_tok_left_bracket:
+        case yajl_tok_left_brace: {
+            yajl_hash_frame f;
+            yajl_hash_init(&(f.seq), YAJL_HASH_ARRAY);
+            f.key = 0;
+            f.sum = 0;
+            f.count = 0;
+            yajl_buf_append(hand->hashFrames, &f, sizeof(f));
+            return !yajl_buf_err(hand->hashFrames);
+        }
+        default:
+            /* streamed strings are hashed as they are decoded, strings
+             * with escapes once decoded by yajl_hash_string() or
+             * yajl_hash_escaped() */
+            return 1;
+    }
+    yajl_hash_feed(hand, yajl_hash_final(&hs), isKey,
+                   yajl_bs_depth(hand->stateStack));
+    return 1;
+}
+
+void
+yajl_hash_string(yajl_handle hand, const unsigned char * str, size_t len,
+                 int isKey)
+{
+    yajl_hash hs;
+
+    yajl_hash_init(&hs, YAJL_HASH_STRING);
+    yajl_hash_update(&hs, str, len);
+    yajl_hash_feed(hand, yajl_hash_final(&hs), isKey,
+                   yajl_bs_depth(hand->stateStack));
+}
+
+int
+yajl_hash_escaped(yajl_handle hand, const unsigned char * buf, size_t bufLen,
+                  int isKey)
+{
+    yajl_buf_clear(hand->decodeBuf);
+    yajl_string_decode(hand->decodeBuf, buf, bufLen);
+    if (yajl_buf_err(hand->decodeBuf)) return 0;
+    yajl_hash_string(hand, yajl_buf_data(hand->decodeBuf),
+                     yajl_buf_len(hand->decodeBuf), isKey);
+    return 1;
+}
+
+void
+yajl_hash_end(yajl_handle hand)
+{
+    size_t depth = yajl_bs_depth(hand->stateStack);
+    const yajl_hash_frame * f;
+
+    if (depth == 0 ||
+        depth > yajl_buf_len(hand->hashFrames) / sizeof(yajl_hash_frame))
+    {
+        return;
+    }
+    f = (const yajl_hash_frame *) yajl_buf_data(hand->hashFrames) + depth - 1;
+    if (yajl_bs_is_map(hand->stateStack, depth - 1)) {
+        hand->containerHash =
+            yajl_hash_mix(f->sum ^ yajl_hash_mix(f->count + YAJL_HASH_MAP));
+    } else {
+        hand->containerHash = yajl_hash_final(&(f->seq));
+    }
+    yajl_buf_truncate(hand->hashFrames,
+                      (depth - 1) * sizeof(yajl_hash_frame));
+    yajl_hash_feed(hand, hand->containerHash, 0, depth - 1);
+}
+
+int
+yajl_stream_string(yajl_handle hand, const unsigned char * str, size_t len,
+                   int isKey, int last)
+{
+    const yajl_string_callbacks * cbs = hand->stringCallbacks;
+    int cont = 1;
+
+    if (!hand->streaming) {
+        hand->streaming = 1;
+        hand->streamPendingLen = 0;
+        yajl_hash_init(&(hand->stringHash), YAJL_HASH_STRING);
+        cont = isKey ? cbs->yajl_map_key_begin(hand->ctx)
+                     : cbs->yajl_string_begin(hand->ctx);
+    }
+
+    yajl_buf_clear(hand->decodeBuf);
+    yajl_string_decode_part(hand->decodeBuf, hand->streamPending,
+                            &(hand->streamPendingLen), str, len, last);
+    if (yajl_buf_err(hand->decodeBuf)) return -1;
+    if (hand->flags & yajl_hash_containers) {
+        yajl_hash_update(&(hand->stringHash), yajl_buf_data(hand->decodeBuf),
+                         yajl_buf_len(hand->decodeBuf));
+        if (last) {
+            yajl_hash_feed(hand, yajl_hash_final(&(hand->stringHash)), isKey,
+                           yajl_bs_depth(hand->stateStack));
+        }
+    }
+    if (cont && yajl_buf_len(hand->decodeBuf) > 0) {
+        cont = isKey
+            ? cbs->yajl_map_key_segment(hand->ctx,
+                                        yajl_buf_data(hand->decodeBuf),
+                                        yajl_buf_len(hand->decodeBuf))
+            : cbs->yajl_string_segment(hand->ctx,
+                                       yajl_buf_data(hand->decodeBuf),
+                                       yajl_buf_len(hand->decodeBuf));
+    }
+
+    if (last) {
+        hand->streaming = 0;
+        if (cont) {
+            cont = isKey ? cbs->yajl_map_key_end(hand->ctx)
+                         : cbs->yajl_string_end(hand->ctx);
+        }
+    }
+    return cont;
+}
+
+int
+yajl_decode_string(yajl_handle hand, const unsigned char * jsonText,
+                   size_t offset, const unsigned char ** buf,
+                   size_t * bufLen)
+{
+    /* the closing quote follows the token unless it was put together in
+     * the lexer's buffer */
+    if ((hand->flags & yajl_allow_in_place_decode) &&
+        offset >= *bufLen + 1 && *buf == jsonText + offset - *bufLen - 1)
+    {
+        *bufLen = yajl_string_decode_in_place((unsigned char *) *buf,
+                                              *bufLen);
+        return 1;
+    }
+
+    yajl_buf_clear(hand->decodeBuf);
+    yajl_string_decode(hand->decodeBuf, *buf, *bufLen);
+    if (yajl_buf_err(hand->decodeBuf)) return 0;
+    *buf = yajl_buf_data(hand->decodeBuf);
+    *bufLen = yajl_buf_len(hand->decodeBuf);
+    return 1;
+}
+
+void
+yajl_begin_raw(yajl_handle hand, size_t offset)
+{
+    hand->rawStart = hand->chunkBase + offset -
+        yajl_lex_token_length(hand->lexer);
+    hand->rawDepth = yajl_bs_depth(hand->stateStack);
+    hand->rawSavedCallbacks = hand->callbacks;
+    hand->callbacks = NULL;
+    hand->rawCapturing = 1;
+}
+
+int
+yajl_end_raw(yajl_handle hand, const unsigned char * jsonText,
+             size_t offset)
+{
+    yajl_raw_value_callback cb = hand->rawCallback;
+    size_t end = hand->chunkBase + offset;
+    const unsigned char * text = NULL;
+
+    yajl_cancel_raw(hand);
+    if (hand->rawStart >= hand->chunkBase) {
+        text = jsonText + (hand->rawStart - hand->chunkBase);
+    }
+    hand->bytesConsumed = offset;
+    return cb(hand->ctx, text, hand->rawStart, end);
+}
+
+void
+yajl_cancel_raw(yajl_handle hand)
+{
+    if (hand->rawCapturing) hand->callbacks = hand->rawSavedCallbacks;
+    hand->rawCapturing = 0;
+    hand->rawCallback = NULL;
+}
+
+yajl_state
+yajl_lex_error_state(yajl_handle hand)
+{
+    switch (yajl_lex_get_error(hand->lexer)) {
+        case yajl_lex_out_of_memory:
+            return yajl_state_memory_error;
+        case yajl_lex_token_too_long:
+            hand->limitStatus = yajl_status_max_token_length_exceeded;
+            return yajl_state_limit_error;
+        default:
+            return yajl_state_lexical_error;
+    }
+}
+
 unsigned char *
 yajl_render_error_string(yajl_handle hand, const unsigned char * jsonText,
                          size_t jsonTextLen, int verbose)
@@ -78,6 +400,12 @@ yajl_render_error_string(yajl_handle hand, const unsigned char * jsonText,
     } else if (yajl_bs_current(hand->stateStack) == yajl_state_lexical_error) {
         errorType = "lexical";
         errorText = yajl_lex_error_to_string(yajl_lex_get_error(hand->lexer));
+    } else if (yajl_bs_current(hand->stateStack) == yajl_state_memory_error) {
+        errorType = "allocation";
+        errorText = "out of memory";
+    } else if (yajl_bs_current(hand->stateStack) == yajl_state_limit_error) {
+        errorType = "limit";
+        errorText = yajl_status_to_string(hand->limitStatus);
     } else {
         errorType = "unknown";
     }
@@ -149,9 +477,15 @@ yajl_render_error_string(yajl_handle hand, const unsigned char * jsonText,
 yajl_status
 yajl_do_finish(yajl_handle hand)
 {
-    yajl_status stat;
-    stat = yajl_do_parse(hand,(const unsigned char *) " ",1);
+    /* the space is not counted in totalBytes, but follows the input */
+    hand->chunkBase = hand->totalBytes;
+    return yajl_finish_status(hand,
+        yajl_do_parse(hand, (const unsigned char *) " ", 1));
+}
 
+yajl_status
+yajl_finish_status(yajl_handle hand, yajl_status stat)
+{
     if (stat != yajl_status_ok) return stat;
 
     switch(yajl_bs_current(hand->stateStack))
@@ -159,6 +493,10 @@ yajl_do_finish(yajl_handle hand)
         case yajl_state_parse_error:
         case yajl_state_lexical_error:
             return yajl_status_error;
+        case yajl_state_memory_error:
+            return yajl_status_out_of_memory;
+        case yajl_state_limit_error:
+            return hand->limitStatus;
         case yajl_state_got_value:
         case yajl_state_parse_complete:
             return yajl_status_ok;
@@ -173,742 +511,6 @@ yajl_do_finish(yajl_handle hand)
     }
 }
 
-yajl_status
-yajl_do_parse(yajl_handle hand, const unsigned char * jsonText,
-              size_t jsonTextLen)
-{
-    yajl_tok tok;
-    const unsigned char * buf;
-    size_t bufLen;
-    size_t offset = 0;
-    int cont = 1;
-
-around_again:
-    if (!cont) {
-        if (!(hand->flags & yajl_resume_after_cancel)) {
-            yajl_bs_set(hand->stateStack, yajl_state_parse_error);
-            hand->parseError =
-                "client cancelled parse via callback return value";
-        }
-        hand->bytesConsumed = offset;
-        return yajl_status_client_canceled;
-    }
-    switch (yajl_bs_current(hand->stateStack)) {
-        case yajl_state_parse_complete:
-            if (hand->flags & yajl_allow_multiple_values) {
-                yajl_bs_set(hand->stateStack, yajl_state_got_value);
-                goto around_again;
-            }
-#ifdef YAJL_SUPPLEMENTARY
-            tok = yajl_lex_lex(hand->lexer, jsonText, jsonTextLen,
-                               &offset, &buf, &bufLen);
-            switch (tok) {
-                case yajl_tok_eof:
-                    hand->bytesConsumed = offset;
-                    return yajl_status_ok;
-                case yajl_tok_string:
-                    if (hand->callbacks && hand->callbacks->yajl_sup_string) {
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_sup_string(hand->ctx,
-                            buf, bufLen);
-                        goto around_again;
-                    }
-                    goto root_unallowed;
-                case yajl_tok_string_with_escapes:
-                    if (hand->callbacks && hand->callbacks->yajl_sup_string) {
-                        yajl_buf_clear(hand->decodeBuf);
-                        yajl_string_decode(hand->decodeBuf, buf, bufLen);
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_sup_string(hand->ctx,
-                            yajl_buf_data(hand->decodeBuf),
-                            yajl_buf_len(hand->decodeBuf));
-                        goto around_again;
-                    }
-                    goto root_unallowed;
-                case yajl_tok_bool:
-                    if (hand->callbacks && hand->callbacks->yajl_sup_boolean) {
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_sup_boolean(hand->ctx,
-                            *buf == 't');
-                        goto around_again;
-                    }
-                    goto root_unallowed;
-                case yajl_tok_null:
-                    if (hand->callbacks && hand->callbacks->yajl_sup_null) {
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_sup_null(hand->ctx);
-                        goto around_again;
-                    }
-                    goto root_unallowed;
-                case yajl_tok_integer:
-                    if (hand->callbacks) {
-                        if (hand->callbacks->yajl_sup_number) {
-                            hand->bytesConsumed = offset;
-                            hand->startOffset = offset - bufLen;
-                            hand->endOffset = offset;
-                            cont = hand->callbacks->yajl_sup_number(hand->ctx,
-                                (const char *) buf, bufLen);
-                            goto around_again;
-                        } else if (hand->callbacks->yajl_sup_integer) {
-                            long long int i = 0;
-                            errno = 0;
-                            i = yajl_parse_integer(buf, bufLen);
-                            if ((i == LLONG_MIN || i == LLONG_MAX) &&
-                                errno == ERANGE)
-                            {
-                                yajl_bs_set(hand->stateStack,
-                                            yajl_state_parse_error);
-                                hand->parseError = "integer overflow" ;
-                                /* try to restore error offset */
-                                if (offset >= bufLen) offset -= bufLen;
-                                else offset = 0;
-                                goto around_again;
-                            }
-                            hand->bytesConsumed = offset;
-                            hand->startOffset = offset - bufLen;
-                            hand->endOffset = offset;
-                            cont = hand->callbacks->yajl_sup_integer(hand->ctx,
-                                i);
-                            goto around_again;
-                        }
-                    }
-                    goto root_unallowed;
-                case yajl_tok_double:
-                    if (hand->callbacks) {
-                        if (hand->callbacks->yajl_sup_number) {
-                            hand->bytesConsumed = offset;
-                            hand->startOffset = offset - bufLen;
-                            hand->endOffset = offset;
-                            cont = hand->callbacks->yajl_sup_number(hand->ctx,
-                                (const char *) buf, bufLen);
-                            goto around_again;
-                        } else if (hand->callbacks->yajl_sup_double) {
-                            double d = 0.0;
-                            yajl_buf_clear(hand->decodeBuf);
-                            yajl_buf_append(hand->decodeBuf, buf, bufLen);
-                            buf = yajl_buf_data(hand->decodeBuf);
-                            errno = 0;
-                            d = strtod((char *) buf, NULL);
-                            if ((d == HUGE_VAL || d == -HUGE_VAL) &&
-                                errno == ERANGE)
-                            {
-                                yajl_bs_set(hand->stateStack,
-                                            yajl_state_parse_error);
-                                hand->parseError = "numeric (floating point) "
-                                    "overflow";
-                                /* try to restore error offset */
-                                if (offset >= bufLen) offset -= bufLen;
-                                else offset = 0;
-                                goto around_again;
-                            }
-                            hand->bytesConsumed = offset;
-                            hand->startOffset = offset - bufLen;
-                            hand->endOffset = offset;
-                            cont = hand->callbacks->yajl_sup_double(hand->ctx,
-                                d);
-                            goto around_again;
-                        }
-                    }
-                    /* intentional fallthru */
-                root_unallowed:
-                default:
-                    if (hand->flags & yajl_allow_trailing_garbage) {
-                        hand->bytesConsumed = offset;
-                        return yajl_status_ok;
-                    }
-                    yajl_bs_set(hand->stateStack, yajl_state_parse_error);
-                    hand->parseError = "trailing garbage";
-                    goto around_again;
-            }
-#else
-            if (!(hand->flags & yajl_allow_trailing_garbage)) {
-                if (offset != jsonTextLen) {
-                    tok = yajl_lex_lex(hand->lexer, jsonText, jsonTextLen,
-                                       &offset, &buf, &bufLen);
-                    if (tok != yajl_tok_eof) {
-                        yajl_bs_set(hand->stateStack, yajl_state_parse_error);
-                        hand->parseError = "trailing garbage";
-                    }
-                    goto around_again;
-                }
-            }
-            hand->bytesConsumed = offset;
-            return yajl_status_ok;
-#endif
-        case yajl_state_lexical_error:
-        case yajl_state_parse_error:
-            hand->bytesConsumed = offset;
-            return yajl_status_error;
-        case yajl_state_start:
-        case yajl_state_got_value:
-        case yajl_state_map_need_val:
-        case yajl_state_array_need_val:
-        case yajl_state_array_start:  {
-            /* for arrays and maps, we advance the state for this
-             * depth, then push the state of the next depth.
-             * If an error occurs during the parsing of the nesting
-             * enitity, the state at this level will not matter.
-             * a state that needs pushing will be anything other
-             * than state_start */
-
-            yajl_state stateToPush = yajl_state_start;
-
-            tok = yajl_lex_lex(hand->lexer, jsonText, jsonTextLen,
-                               &offset, &buf, &bufLen);
-
-            switch (tok) {
-                case yajl_tok_eof:
-                    hand->bytesConsumed = offset;
-                    return yajl_status_ok;
-                case yajl_tok_error:
-                    yajl_bs_set(hand->stateStack, yajl_state_lexical_error);
-                    goto around_again;
-                case yajl_tok_string:
-                    if (hand->callbacks && hand->callbacks->yajl_string) {
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_string(hand->ctx,
-                            buf, bufLen);
-                    }
-                    break;
-                case yajl_tok_string_with_escapes:
-                    if (hand->callbacks && hand->callbacks->yajl_string) {
-                        yajl_buf_clear(hand->decodeBuf);
-                        yajl_string_decode(hand->decodeBuf, buf, bufLen);
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_string(hand->ctx,
-                            yajl_buf_data(hand->decodeBuf),
-                            yajl_buf_len(hand->decodeBuf));
-                    }
-                    break;
-                case yajl_tok_bool:
-                    if (hand->callbacks && hand->callbacks->yajl_boolean) {
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_boolean(hand->ctx,
-                            *buf == 't');
-                    }
-                    break;
-                case yajl_tok_null:
-                    if (hand->callbacks && hand->callbacks->yajl_null) {
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_null(hand->ctx);
-                    }
-                    break;
-                case yajl_tok_left_bracket:
-                    if (hand->callbacks && hand->callbacks->yajl_start_map) {
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_start_map(hand->ctx);
-                    }
-                    stateToPush = yajl_state_map_start;
-                    break;
-                case yajl_tok_left_brace:
-                    if (hand->callbacks && hand->callbacks->yajl_start_array) {
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_start_array(hand->ctx);
-                    }
-                    stateToPush = yajl_state_array_start;
-                    break;
-                case yajl_tok_integer:
-                    if (hand->callbacks) {
-                        if (hand->callbacks->yajl_number) {
-                            hand->bytesConsumed = offset;
-                            hand->startOffset = offset - bufLen;
-                            hand->endOffset = offset;
-                            cont = hand->callbacks->yajl_number(hand->ctx,
-                                (const char *) buf, bufLen);
-                        } else if (hand->callbacks->yajl_integer) {
-                            long long int i = 0;
-                            errno = 0;
-                            i = yajl_parse_integer(buf, bufLen);
-                            if ((i == LLONG_MIN || i == LLONG_MAX) &&
-                                errno == ERANGE)
-                            {
-                                yajl_bs_set(hand->stateStack,
-                                            yajl_state_parse_error);
-                                hand->parseError = "integer overflow" ;
-                                /* try to restore error offset */
-                                if (offset >= bufLen) offset -= bufLen;
-                                else offset = 0;
-                                goto around_again;
-                            }
-                            hand->bytesConsumed = offset;
-                            hand->startOffset = offset - bufLen;
-                            hand->endOffset = offset;
-                            cont = hand->callbacks->yajl_integer(hand->ctx,
-                                i);
-                        }
-                    }
-                    break;
-                case yajl_tok_double:
-                    if (hand->callbacks) {
-                        if (hand->callbacks->yajl_number) {
-                            hand->bytesConsumed = offset;
-                            hand->startOffset = offset - bufLen;
-                            hand->endOffset = offset;
-                            cont = hand->callbacks->yajl_number(hand->ctx,
-                                (const char *) buf, bufLen);
-                        } else if (hand->callbacks->yajl_double) {
-                            double d = 0.0;
-                            yajl_buf_clear(hand->decodeBuf);
-                            yajl_buf_append(hand->decodeBuf, buf, bufLen);
-                            buf = yajl_buf_data(hand->decodeBuf);
-                            errno = 0;
-                            d = strtod((char *) buf, NULL);
-                            if ((d == HUGE_VAL || d == -HUGE_VAL) &&
-                                errno == ERANGE)
-                            {
-                                yajl_bs_set(hand->stateStack,
-                                            yajl_state_parse_error);
-                                hand->parseError = "numeric (floating point) "
-                                    "overflow";
-                                /* try to restore error offset */
-                                if (offset >= bufLen) offset -= bufLen;
-                                else offset = 0;
-                                goto around_again;
-                            }
-                            hand->bytesConsumed = offset;
-                            hand->startOffset = offset - bufLen;
-                            hand->endOffset = offset;
-                            cont = hand->callbacks->yajl_double(hand->ctx,
-                                d);
-                        }
-                    }
-                    break;
-                case yajl_tok_right_brace: {
-                    if (yajl_bs_current(hand->stateStack) ==
-                        yajl_state_array_start)
-                    {
-                        if (hand->callbacks &&
-                            hand->callbacks->yajl_end_array)
-                        {
-                            hand->bytesConsumed = offset;
-                            hand->startOffset = offset - bufLen;
-                            hand->endOffset = offset;
-                            cont = hand->callbacks->yajl_end_array(hand->ctx);
-                        }
-                        yajl_bs_pop(hand->stateStack);
-                        goto around_again;
-                    }
-                    /* intentional fall-through */
-                }
-                case yajl_tok_colon:
-                case yajl_tok_comma:
-                case yajl_tok_right_bracket:
-                    yajl_bs_set(hand->stateStack, yajl_state_parse_error);
-                    hand->parseError =
-                        "unallowed token at this point in JSON text";
-                    goto around_again;
-                default:
-                    yajl_bs_set(hand->stateStack, yajl_state_parse_error);
-                    hand->parseError = "invalid token, internal error";
-                    goto around_again;
-            }
-            /* got a value.  transition depends on the state we're in. */
-            {
-                yajl_state s = yajl_bs_current(hand->stateStack);
-                if (s == yajl_state_start || s == yajl_state_got_value) {
-                    yajl_bs_set(hand->stateStack, yajl_state_parse_complete);
-                } else if (s == yajl_state_map_need_val) {
-                    yajl_bs_set(hand->stateStack, yajl_state_map_got_val);
-                } else {
-                    yajl_bs_set(hand->stateStack, yajl_state_array_got_val);
-                }
-            }
-            if (stateToPush != yajl_state_start) {
-                yajl_bs_push(hand->stateStack, stateToPush);
-            }
-
-            goto around_again;
-        }
-        case yajl_state_map_start:
-        case yajl_state_map_need_key: {
-            /* only difference between these two states is that in
-             * start '}' is valid, whereas in need_key, we've parsed
-             * a comma, and a string key _must_ follow */
-            tok = yajl_lex_lex(hand->lexer, jsonText, jsonTextLen,
-                               &offset, &buf, &bufLen);
-            switch (tok) {
-                case yajl_tok_eof:
-                    hand->bytesConsumed = offset;
-                    return yajl_status_ok;
-                case yajl_tok_error:
-                    yajl_bs_set(hand->stateStack, yajl_state_lexical_error);
-                    goto around_again;
-                case yajl_tok_string_with_escapes:
-                    if (hand->callbacks && hand->callbacks->yajl_map_key) {
-                        yajl_buf_clear(hand->decodeBuf);
-                        yajl_string_decode(hand->decodeBuf, buf, bufLen);
-                        buf = yajl_buf_data(hand->decodeBuf);
-                        bufLen = yajl_buf_len(hand->decodeBuf);
-                    }
-                    /* intentional fall-through */
-                case yajl_tok_string:
-                    if (hand->callbacks && hand->callbacks->yajl_map_key) {
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_map_key(hand->ctx, buf,
-                            bufLen);
-                    }
-                    yajl_bs_set(hand->stateStack, yajl_state_map_sep);
-                    goto around_again;
-                case yajl_tok_right_bracket:
-                    if (yajl_bs_current(hand->stateStack) ==
-                        yajl_state_map_start)
-                    {
-                        if (hand->callbacks && hand->callbacks->yajl_end_map) {
-                            hand->bytesConsumed = offset;
-                            hand->startOffset = offset - bufLen;
-                            hand->endOffset = offset;
-                            cont = hand->callbacks->yajl_end_map(hand->ctx);
-                        }
-                        yajl_bs_pop(hand->stateStack);
-                        goto around_again;
-                    }
-                default:
-                    yajl_bs_set(hand->stateStack, yajl_state_parse_error);
-                    hand->parseError =
-                        "invalid object key (must be a string)"; 
-                    goto around_again;
-            }
-        }
-        case yajl_state_map_sep: {
-            tok = yajl_lex_lex(hand->lexer, jsonText, jsonTextLen,
-                               &offset, &buf, &bufLen);
-            switch (tok) {
-                case yajl_tok_colon:
-                    yajl_bs_set(hand->stateStack, yajl_state_map_need_val);
-                    goto around_again;
-                case yajl_tok_eof:
-                    hand->bytesConsumed = offset;
-                    return yajl_status_ok;
-                case yajl_tok_error:
-                    yajl_bs_set(hand->stateStack, yajl_state_lexical_error);
-                    goto around_again;
-                default:
-                    yajl_bs_set(hand->stateStack, yajl_state_parse_error);
-                    hand->parseError = "object key and value must "
-                        "be separated by a colon (':')";
-                    goto around_again;
-            }
-        }
-        case yajl_state_map_got_val: {
-            tok = yajl_lex_lex(hand->lexer, jsonText, jsonTextLen,
-                               &offset, &buf, &bufLen);
-            switch (tok) {
-                case yajl_tok_right_bracket:
-                    if (hand->callbacks && hand->callbacks->yajl_end_map) {
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_end_map(hand->ctx);
-                    }
-                    yajl_bs_pop(hand->stateStack);
-                    goto around_again;
-                case yajl_tok_comma:
-                    yajl_bs_set(hand->stateStack, yajl_state_map_need_key);
-                    goto around_again;
-                case yajl_tok_eof:
-                    hand->bytesConsumed = offset;
-                    return yajl_status_ok;
-                case yajl_tok_error:
-                    yajl_bs_set(hand->stateStack, yajl_state_lexical_error);
-                    goto around_again;
-#ifdef YAJL_SUPPLEMENTARY
-                case yajl_tok_string:
-                    if (hand->callbacks && hand->callbacks->yajl_sup_string) {
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_sup_string(hand->ctx,
-                            buf, bufLen);
-                        goto around_again;
-                    }
-                    goto map_unallowed;
-                case yajl_tok_string_with_escapes:
-                    if (hand->callbacks && hand->callbacks->yajl_sup_string) {
-                        yajl_buf_clear(hand->decodeBuf);
-                        yajl_string_decode(hand->decodeBuf, buf, bufLen);
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_sup_string(hand->ctx,
-                            yajl_buf_data(hand->decodeBuf),
-                            yajl_buf_len(hand->decodeBuf));
-                        goto around_again;
-                    }
-                    goto map_unallowed;
-                case yajl_tok_bool:
-                    if (hand->callbacks && hand->callbacks->yajl_sup_boolean) {
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_sup_boolean(hand->ctx,
-                            *buf == 't');
-                        goto around_again;
-                    }
-                    goto map_unallowed;
-                case yajl_tok_null:
-                    if (hand->callbacks && hand->callbacks->yajl_sup_null) {
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_sup_null(hand->ctx);
-                        goto around_again;
-                    }
-                    goto map_unallowed;
-                case yajl_tok_integer:
-                    if (hand->callbacks) {
-                        if (hand->callbacks->yajl_sup_number) {
-                            hand->bytesConsumed = offset;
-                            hand->startOffset = offset - bufLen;
-                            hand->endOffset = offset;
-                            cont = hand->callbacks->yajl_sup_number(hand->ctx,
-                                (const char *) buf, bufLen);
-                            goto around_again;
-                        } else if (hand->callbacks->yajl_sup_integer) {
-                            long long int i = 0;
-                            errno = 0;
-                            i = yajl_parse_integer(buf, bufLen);
-                            if ((i == LLONG_MIN || i == LLONG_MAX) &&
-                                errno == ERANGE)
-                            {
-                                yajl_bs_set(hand->stateStack,
-                                            yajl_state_parse_error);
-                                hand->parseError = "integer overflow" ;
-                                /* try to restore error offset */
-                                if (offset >= bufLen) offset -= bufLen;
-                                else offset = 0;
-                                goto around_again;
-                            }
-                            hand->bytesConsumed = offset;
-                            hand->startOffset = offset - bufLen;
-                            hand->endOffset = offset;
-                            cont = hand->callbacks->yajl_sup_integer(hand->ctx,
-                                i);
-                            goto around_again;
-                        }
-                    }
-                    goto map_unallowed;
-                case yajl_tok_double:
-                    if (hand->callbacks) {
-                        if (hand->callbacks->yajl_sup_number) {
-                            hand->bytesConsumed = offset;
-                            hand->startOffset = offset - bufLen;
-                            hand->endOffset = offset;
-                            cont = hand->callbacks->yajl_sup_number(hand->ctx,
-                                (const char *) buf, bufLen);
-                            goto around_again;
-                        } else if (hand->callbacks->yajl_sup_double) {
-                            double d = 0.0;
-                            yajl_buf_clear(hand->decodeBuf);
-                            yajl_buf_append(hand->decodeBuf, buf, bufLen);
-                            buf = yajl_buf_data(hand->decodeBuf);
-                            errno = 0;
-                            d = strtod((char *) buf, NULL);
-                            if ((d == HUGE_VAL || d == -HUGE_VAL) &&
-                                errno == ERANGE)
-                            {
-                                yajl_bs_set(hand->stateStack,
-                                            yajl_state_parse_error);
-                                hand->parseError = "numeric (floating point) "
-                                    "overflow";
-                                /* try to restore error offset */
-                                if (offset >= bufLen) offset -= bufLen;
-                                else offset = 0;
-                                goto around_again;
-                            }
-                            hand->bytesConsumed = offset;
-                            hand->startOffset = offset - bufLen;
-                            hand->endOffset = offset;
-                            cont = hand->callbacks->yajl_sup_double(hand->ctx,
-                                d);
-                            goto around_again;
-                        }
-                    }
-                    /* intentional fallthru */
-                map_unallowed:
-#endif
-                default:
-                    yajl_bs_set(hand->stateStack, yajl_state_parse_error);
-                    hand->parseError = "after key and value, inside map, "
-                                       "I expect ',' or '}'";
-                    /* try to restore error offset */
-                    if (offset >= bufLen) offset -= bufLen;
-                    else offset = 0;
-                    goto around_again;
-            }
-        }
-        case yajl_state_array_got_val: {
-            tok = yajl_lex_lex(hand->lexer, jsonText, jsonTextLen,
-                               &offset, &buf, &bufLen);
-            switch (tok) {
-                case yajl_tok_right_brace:
-                    if (hand->callbacks && hand->callbacks->yajl_end_array) {
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_end_array(hand->ctx);
-                    }
-                    yajl_bs_pop(hand->stateStack);
-                    goto around_again;
-                case yajl_tok_comma:
-                    yajl_bs_set(hand->stateStack, yajl_state_array_need_val);
-                    goto around_again;
-                case yajl_tok_eof:
-                    hand->bytesConsumed = offset;
-                    return yajl_status_ok;
-                case yajl_tok_error:
-                    yajl_bs_set(hand->stateStack, yajl_state_lexical_error);
-                    goto around_again;
-#ifdef YAJL_SUPPLEMENTARY
-                case yajl_tok_string:
-                    if (hand->callbacks && hand->callbacks->yajl_sup_string) {
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_sup_string(hand->ctx,
-                            buf, bufLen);
-                        goto around_again;
-                    }
-                    goto array_unallowed;
-                case yajl_tok_string_with_escapes:
-                    if (hand->callbacks && hand->callbacks->yajl_sup_string) {
-                        yajl_buf_clear(hand->decodeBuf);
-                        yajl_string_decode(hand->decodeBuf, buf, bufLen);
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_sup_string(hand->ctx,
-                            yajl_buf_data(hand->decodeBuf),
-                            yajl_buf_len(hand->decodeBuf));
-                        goto around_again;
-                    }
-                    goto array_unallowed;
-                case yajl_tok_bool:
-                    if (hand->callbacks && hand->callbacks->yajl_sup_boolean) {
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_sup_boolean(hand->ctx,
-                            *buf == 't');
-                        goto around_again;
-                    }
-                    goto array_unallowed;
-                case yajl_tok_null:
-                    if (hand->callbacks && hand->callbacks->yajl_sup_null) {
-                        hand->bytesConsumed = offset;
-                        hand->startOffset = offset - bufLen;
-                        hand->endOffset = offset;
-                        cont = hand->callbacks->yajl_sup_null(hand->ctx);
-                        goto around_again;
-                    }
-                    goto array_unallowed;
-                case yajl_tok_integer:
-                    if (hand->callbacks) {
-                        if (hand->callbacks->yajl_sup_number) {
-                            hand->bytesConsumed = offset;
-                            hand->startOffset = offset - bufLen;
-                            hand->endOffset = offset;
-                            cont = hand->callbacks->yajl_sup_number(hand->ctx,
-                                (const char *) buf, bufLen);
-                            goto around_again;
-                        } else if (hand->callbacks->yajl_sup_integer) {
-                            long long int i = 0;
-                            errno = 0;
-                            i = yajl_parse_integer(buf, bufLen);
-                            if ((i == LLONG_MIN || i == LLONG_MAX) &&
-                                errno == ERANGE)
-                            {
-                                yajl_bs_set(hand->stateStack,
-                                            yajl_state_parse_error);
-                                hand->parseError = "integer overflow" ;
-                                /* try to restore error offset */
-                                if (offset >= bufLen) offset -= bufLen;
-                                else offset = 0;
-                                goto around_again;
-                            }
-                            hand->bytesConsumed = offset;
-                            hand->startOffset = offset - bufLen;
-                            hand->endOffset = offset;
-                            cont = hand->callbacks->yajl_sup_integer(hand->ctx,
-                                i);
-                            goto around_again;
-                        }
-                    }
-                    goto array_unallowed;
-                case yajl_tok_double:
-                    if (hand->callbacks) {
-                        if (hand->callbacks->yajl_sup_number) {
-                            hand->bytesConsumed = offset;
-                            hand->startOffset = offset - bufLen;
-                            hand->endOffset = offset;
-                            cont = hand->callbacks->yajl_sup_number(hand->ctx,
-                                (const char *) buf, bufLen);
-                            goto around_again;
-                        } else if (hand->callbacks->yajl_sup_double) {
-                            double d = 0.0;
-                            yajl_buf_clear(hand->decodeBuf);
-                            yajl_buf_append(hand->decodeBuf, buf, bufLen);
-                            buf = yajl_buf_data(hand->decodeBuf);
-                            errno = 0;
-                            d = strtod((char *) buf, NULL);
-                            if ((d == HUGE_VAL || d == -HUGE_VAL) &&
-                                errno == ERANGE)
-                            {
-                                yajl_bs_set(hand->stateStack,
-                                            yajl_state_parse_error);
-                                hand->parseError = "numeric (floating point) "
-                                    "overflow";
-                                /* try to restore error offset */
-                                if (offset >= bufLen) offset -= bufLen;
-                                else offset = 0;
-                                goto around_again;
-                            }
-                            hand->bytesConsumed = offset;
-                            hand->startOffset = offset - bufLen;
-                            hand->endOffset = offset;
-                            cont = hand->callbacks->yajl_sup_double(hand->ctx,
-                                d);
-                            goto around_again;
-                        }
-                    }
-                    /* intentional fallthru */
-                array_unallowed:
-#endif
-                default:
-                    yajl_bs_set(hand->stateStack, yajl_state_parse_error);
-                    hand->parseError =
-                        "after array element, I expect ',' or ']'";
-                    goto around_again;
-            }
-        }
-#ifdef YAJL_SUPPLEMENTARY
-        default:
-            break;
-#endif 
-    }
-
-    abort();
-    return yajl_status_error;
-}
+#define YAJL_PARSER_NAME yajl_do_parse
+#include "yajl_parser_tmpl.h"
 
@@ -18,16 +18,23 @@
 #define __YAJL_PARSER_H__
 
 #include "api/yajl_parse.h"
-#include "yajl_bytestack.h"
+#include "yajl_bitstack.h"
 #include "yajl_buf.h"
 #include "yajl_lex.h"
+#include "yajl_alloc.h"
+#include "yajl_encode.h"
+#include "yajl_hash.h"
 
+/* the routines the parse loop in yajl_parser_tmpl.h calls are exported
+ * with YAJL_API, for code outside the library to instantiate it */
 
 typedef enum {
     yajl_state_start = 0,
     yajl_state_parse_complete,
     yajl_state_parse_error,
     yajl_state_lexical_error,
+    yajl_state_memory_error,
+    yajl_state_limit_error,
     yajl_state_map_start,
     yajl_state_map_sep,
     yajl_state_map_need_val,
@@ -60,14 +67,140 @@ struct yajl_handle_t {
     size_t endOffset;
     /* temporary storage for decoded strings */
     yajl_buf decodeBuf;
-    /* a stack of states.  access with yajl_state_XXX routines */
-    yajl_bytestack stateStack;
+    /* a stack of states.  access with yajl_bs_XXX routines */
+    yajl_bitstack stateStack;
     /* memory allocation routines */
     yajl_alloc_funcs alloc;
+    /* counters behind alloc while yajl_collect_stats is on */
+    yajl_counting_alloc countingAlloc;
     /* bitfield */
     unsigned int flags;
+    /* is lexer a reverse lexer (allocated by yajl_rev_parse)? */
+    unsigned int revLexer;
+    /* limits set with yajl_config, 0 for no limit */
+    size_t maxDepth;
+    size_t maxTokenLength;
+    size_t maxTotalBytes;
+    /* input passed since allocation or reset, checked against maxTotalBytes */
+    size_t totalBytes;
+    /* which limit was hit, returned in yajl_state_limit_error */
+    yajl_status limitStatus;
+    /* set by the yajl_retain_chunks option */
+    const yajl_chunk_callbacks * chunkCallbacks;
+    /* chunks not released yet, in the order they were parsed */
+    yajl_buf retainedChunks;
+    /* set by the yajl_stream_strings option */
+    const yajl_string_callbacks * stringCallbacks;
+    /* a string is being streamed */
+    unsigned int streaming;
+    /* the end of the last piece of a streamed string, if it may be the
+     * start of an escape sequence */
+    unsigned char streamPending[YAJL_DECODE_PENDING];
+    size_t streamPendingLen;
+    /* offset of the chunk being parsed in all the input, see totalBytes */
+    size_t chunkBase;
+    /* set by yajl_capture_raw_value until the value is complete */
+    yajl_raw_value_callback rawCallback;
+    /* the value has begun, its callbacks are set aside meanwhile */
+    unsigned int rawCapturing;
+    const yajl_callbacks * rawSavedCallbacks;
+    size_t rawDepth;
+    size_t rawStart;
+    /* a yajl_hash_frame per container entered, for the
+     * yajl_hash_containers option */
+    yajl_buf hashFrames;
+    /* a streamed string hashed so far */
+    yajl_hash stringHash;
+    /* of the container that ended last */
+    unsigned long long containerHash;
 };
 
+/* pass a piece of a streamed string on to the yajl_stream_strings
+ * callbacks, beginning the string at the first piece and ending it at the
+ * last.  returns what the callbacks returned, or -1 if out of memory */
+YAJL_API int
+yajl_stream_string(yajl_handle hand, const unsigned char * str, size_t len,
+                   int isKey, int last);
+
+/* decode the string token *buf, which the lexer returned at offset in
+ * jsonText, replacing *buf and *bufLen with the result.  this is done
+ * within jsonText when the yajl_allow_in_place_decode option allows it
+ * and the token lies there, otherwise in decodeBuf.  returns 0 if out of
+ * memory */
+YAJL_API int
+yajl_decode_string(yajl_handle hand, const unsigned char * jsonText,
+                   size_t offset, const unsigned char ** buf,
+                   size_t * bufLen);
+
+/* begin capturing a value for yajl_capture_raw_value, its first token
+ * having been lexed up to offset */
+YAJL_API void
+yajl_begin_raw(yajl_handle hand, size_t offset);
+
+/* finish capturing, the value having ended at offset in jsonText, and
+ * pass it to the callback.  returns what that returned */
+YAJL_API int
+yajl_end_raw(yajl_handle hand, const unsigned char * jsonText,
+             size_t offset);
+
+/* stop capturing without passing the value on */
+void
+yajl_cancel_raw(yajl_handle hand);
+
+/* add the value or map key lexed as tok to the hash of the container it
+ * is in, or for a map or array begin hashing it.  returns 0 if out of
+ * memory */
+YAJL_API int
+yajl_hash_token(yajl_handle hand, yajl_tok tok, const unsigned char * buf,
+                size_t bufLen, int isKey);
+
+/* add the decoded string str, a value or map key, to the hash of the
+ * container it is in.  yajl_hash_token() leaves strings with escapes to
+ * this once they are decoded for a callback */
+YAJL_API void
+yajl_hash_string(yajl_handle hand, const unsigned char * str, size_t len,
+                 int isKey);
+
+/* decode the string token buf with escapes, which no callback needs, into
+ * decodeBuf and hash it as yajl_hash_string() does.  returns 0 if out of
+ * memory */
+YAJL_API int
+yajl_hash_escaped(yajl_handle hand, const unsigned char * buf, size_t bufLen,
+                  int isKey);
+
+/* finish the hash of the innermost container, which is ending, and add it
+ * to the hash of the one around it */
+YAJL_API void
+yajl_hash_end(yajl_handle hand);
+
+/* the error state to enter when the lexer returns yajl_tok_error */
+YAJL_API yajl_state
+yajl_lex_error_state(yajl_handle hand);
+
+/* enter yajl_state_limit_error, to return stat from now on */
+#define yajl_set_limit_error(hand, stat)                                \
+    do {                                                                \
+        (hand)->limitStatus = (stat);                                   \
+        yajl_bs_set((hand)->stateStack, yajl_state_limit_error);        \
+    } while (0)
+
+/* have more containers been entered than the yajl_max_depth option
+ * allows? */
+#define yajl_depth_exceeded(hand)                                       \
+    ((hand)->maxDepth != 0 &&                                           \
+     yajl_bs_depth((hand)->stateStack) > (hand)->maxDepth)
+
+/* enter the container whose first state is state */
+#define yajl_push_container(hand, state)                                \
+    yajl_bs_push((hand)->stateStack, (state),                           \
+                 (state) == yajl_state_map_start)
+
+/* leave a container.  the enclosing level was advanced past the container
+ * when it was entered, to the state yajl_do_parse gives it after a value */
+#define yajl_pop_container(hand)                                        \
+    yajl_bs_pop((hand)->stateStack, yajl_state_parse_complete,          \
+                yajl_state_map_got_val, yajl_state_array_got_val)
+
 yajl_status
 yajl_do_parse(yajl_handle handle, const unsigned char * jsonText,
               size_t jsonTextLen);
@@ -75,13 +208,25 @@ yajl_do_parse(yajl_handle handle, const unsigned char * jsonText,
 yajl_status
 yajl_do_finish(yajl_handle handle);
 
+/* the result of completing a parse, given stat from feeding the parse
+ * routine a final " " */
+YAJL_API yajl_status
+yajl_finish_status(yajl_handle handle, yajl_status stat);
+
+/* get the handle ready for another chunk of jsonTextLen bytes, parsed
+ * forwards or in reverse.  anything but yajl_status_ok is an error to
+ * return without parsing */
+YAJL_API yajl_status
+yajl_parse_prepare(yajl_handle handle, size_t jsonTextLen,
+                   unsigned int reverse);
+
 unsigned char *
 yajl_render_error_string(yajl_handle hand, const unsigned char * jsonText,
                          size_t jsonTextLen, int verbose);
 
 /* A little built in integer parsing routine with the same semantics as strtol
  * that's unaffected by LOCALE. */
-long long
+YAJL_API long long
 yajl_parse_integer(const unsigned char *number, unsigned int length);
 
 
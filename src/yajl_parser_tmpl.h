@@ -0,0 +1,998 @@
+/*
+ * Copyright (c) 2007-2014, Lloyd Hilaiel <me@lloyd.io>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * The forward parse loop, written once and instantiated by including this
+ * file.  yajl_parser.c includes it to define yajl_do_parse, which calls the
+ * callbacks the handle was allocated with.  Code with a fixed set of
+ * callbacks, like yajl_tree.c, can include it to get its own copy of the
+ * loop, in which the compiler knows every callback:
+ *
+ *   static const yajl_callbacks my_callbacks = { ... };
+ *
+ *   #define YAJL_PARSER_NAME my_do_parse
+ *   #define YAJL_PARSER_CALLBACKS my_callbacks
+ *   #include <yajl/parse_loop/yajl_parser_tmpl.h>
+ *
+ * my_do_parse is then a static function taking the same arguments as
+ * yajl_do_parse.  It ignores the callbacks in the handle, calls its
+ * callbacks directly where they may be inlined, and drops the branches of
+ * the ones which are NULL, including the supplementary ones.  Allocate the
+ * handle with yajl_alloc() and the same callbacks, configure it as usual,
+ * and run the loop the way yajl_parse() and yajl_complete_parse() run
+ * yajl_do_parse:
+ *
+ *   st = yajl_parse_prepare(h, len, 0);
+ *   if (st == yajl_status_ok) st = my_do_parse(h, text, len);
+ *   ...
+ *   st = yajl_parse_prepare(h, 0, 0);
+ *   if (st == yajl_status_ok) {
+ *       st = my_do_parse(h, (const unsigned char *) " ", 1);
+ *       st = yajl_finish_status(h, st);
+ *   }
+ *
+ * yajl_get_error(), yajl_reset() and the other handle routines work as
+ * they do with yajl_parse().  yajl_retain_chunks and
+ * yajl_capture_raw_value() need yajl_parse() and are not available.
+ *
+ * The template is installed under yajl/parse_loop/ with the headers it
+ * includes, and the routines it calls are exported.  These are the
+ * library's internals: code using them is tied to the version of yajl it
+ * is built against, and must be rebuilt along with it.
+ *
+ * YAJL_PARSER_NAME and YAJL_PARSER_CALLBACKS are undefined at the end.
+ */
+
+#include "api/yajl_parse.h"
+#include "yajl_lex.h"
+#include "yajl_parser.h"
+#include "yajl_encode.h"
+#include "yajl_bitstack.h"
+
+#include <stdlib.h>
+#include <limits.h>
+#include <errno.h>
+#include <math.h>
+
+#ifndef YAJL_PARSER_NAME
+#error "define YAJL_PARSER_NAME before including yajl_parser_tmpl.h"
+#endif
+
+/* with fixed callbacks there is no handle for yajl_capture_raw_value(),
+ * so capturing a value is left out */
+#ifdef YAJL_PARSER_CALLBACKS
+#define YAJL_HAS_CBS 1
+#define YAJL_CBS (&(YAJL_PARSER_CALLBACKS))
+#define YAJL_CAN_CAPTURE 0
+#else
+#define YAJL_HAS_CBS (hand->callbacks != NULL)
+#define YAJL_CBS hand->callbacks
+#define YAJL_CAN_CAPTURE 1
+#endif
+
+/* after a container closes, finish a value being captured if it was the
+ * container */
+#define YAJL_CAPTURED_CONTAINER \
+    if (YAJL_CAN_CAPTURE && hand->rawCapturing &&                       \
+        yajl_bs_depth(hand->stateStack) == hand->rawDepth)              \
+    {                                                                   \
+        cont = yajl_end_raw(hand, jsonText, offset);                    \
+    }
+
+/* with yajl_hash_containers, work out the hash of the container ending
+ * before its callback */
+#define YAJL_HASH_CONTAINER_END \
+    if (hand->flags & yajl_hash_containers) yajl_hash_end(hand);
+
+#ifdef YAJL_PARSER_CALLBACKS
+static
+#endif
+yajl_status
+YAJL_PARSER_NAME(yajl_handle hand, const unsigned char * jsonText,
+                 size_t jsonTextLen)
+{
+    yajl_tok tok;
+    const unsigned char * buf;
+    size_t bufLen;
+    size_t offset = 0;
+    int cont = 1;
+
+around_again:
+    if (!cont) {
+        if (!(hand->flags & yajl_resume_after_cancel)) {
+            yajl_bs_set(hand->stateStack, yajl_state_parse_error);
+            hand->parseError =
+                "client cancelled parse via callback return value";
+        }
+        hand->bytesConsumed = offset;
+        return yajl_status_client_canceled;
+    }
+    switch (yajl_bs_current(hand->stateStack)) {
+        case yajl_state_parse_complete:
+            if (hand->flags & yajl_allow_multiple_values) {
+                yajl_bs_set(hand->stateStack, yajl_state_got_value);
+                goto around_again;
+            }
+#ifdef YAJL_SUPPLEMENTARY
+            tok = yajl_lex_lex(hand->lexer, jsonText, jsonTextLen,
+                               &offset, &buf, &bufLen);
+            switch (tok) {
+                case yajl_tok_eof:
+                    hand->bytesConsumed = offset;
+                    return yajl_status_ok;
+                case yajl_tok_string_segments:
+                    if (!yajl_lex_stitch(hand->lexer, &buf, &bufLen)) {
+                        goto memory_error;
+                    }
+                    /* intentional fall-through */
+                case yajl_tok_string:
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_sup_string) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        cont = YAJL_CBS->yajl_sup_string(hand->ctx,
+                            buf, bufLen);
+                        goto around_again;
+                    }
+                    goto root_unallowed;
+                case yajl_tok_string_with_escapes:
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_sup_string) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        if (!yajl_decode_string(hand, jsonText, offset, &buf,
+                                                &bufLen))
+                        {
+                            goto memory_error;
+                        }
+                        cont = YAJL_CBS->yajl_sup_string(hand->ctx, buf, bufLen);
+                        goto around_again;
+                    }
+                    goto root_unallowed;
+                case yajl_tok_bool:
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_sup_boolean) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        cont = YAJL_CBS->yajl_sup_boolean(hand->ctx,
+                            *buf == 't');
+                        goto around_again;
+                    }
+                    goto root_unallowed;
+                case yajl_tok_null:
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_sup_null) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        cont = YAJL_CBS->yajl_sup_null(hand->ctx);
+                        goto around_again;
+                    }
+                    goto root_unallowed;
+                case yajl_tok_integer:
+                    if (YAJL_HAS_CBS) {
+                        if (YAJL_CBS->yajl_sup_number) {
+                            hand->bytesConsumed = offset;
+                            hand->startOffset = offset - bufLen;
+                            hand->endOffset = offset;
+                            cont = YAJL_CBS->yajl_sup_number(hand->ctx,
+                                (const char *) buf, bufLen);
+                            goto around_again;
+                        } else if (YAJL_CBS->yajl_sup_integer) {
+                            long long int i = 0;
+                            errno = 0;
+                            i = yajl_parse_integer(buf, bufLen);
+                            if ((i == LLONG_MIN || i == LLONG_MAX) &&
+                                errno == ERANGE)
+                            {
+                                yajl_bs_set(hand->stateStack,
+                                            yajl_state_parse_error);
+                                hand->parseError = "integer overflow" ;
+                                /* try to restore error offset */
+                                if (offset >= bufLen) offset -= bufLen;
+                                else offset = 0;
+                                goto around_again;
+                            }
+                            hand->bytesConsumed = offset;
+                            hand->startOffset = offset - bufLen;
+                            hand->endOffset = offset;
+                            cont = YAJL_CBS->yajl_sup_integer(hand->ctx,
+                                i);
+                            goto around_again;
+                        }
+                    }
+                    goto root_unallowed;
+                case yajl_tok_double:
+                    if (YAJL_HAS_CBS) {
+                        if (YAJL_CBS->yajl_sup_number) {
+                            hand->bytesConsumed = offset;
+                            hand->startOffset = offset - bufLen;
+                            hand->endOffset = offset;
+                            cont = YAJL_CBS->yajl_sup_number(hand->ctx,
+                                (const char *) buf, bufLen);
+                            goto around_again;
+                        } else if (YAJL_CBS->yajl_sup_double) {
+                            double d = 0.0;
+                            yajl_buf_clear(hand->decodeBuf);
+                            yajl_buf_append(hand->decodeBuf, buf, bufLen);
+                            if (yajl_buf_err(hand->decodeBuf)) goto memory_error;
+                            buf = yajl_buf_data(hand->decodeBuf);
+                            errno = 0;
+                            d = strtod((char *) buf, NULL);
+                            if ((d == HUGE_VAL || d == -HUGE_VAL) &&
+                                errno == ERANGE)
+                            {
+                                yajl_bs_set(hand->stateStack,
+                                            yajl_state_parse_error);
+                                hand->parseError = "numeric (floating point) "
+                                    "overflow";
+                                /* try to restore error offset */
+                                if (offset >= bufLen) offset -= bufLen;
+                                else offset = 0;
+                                goto around_again;
+                            }
+                            hand->bytesConsumed = offset;
+                            hand->startOffset = offset - bufLen;
+                            hand->endOffset = offset;
+                            cont = YAJL_CBS->yajl_sup_double(hand->ctx,
+                                d);
+                            goto around_again;
+                        }
+                    }
+                    /* intentional fallthru */
+                root_unallowed:
+                default:
+                    if (hand->flags & yajl_allow_trailing_garbage) {
+                        hand->bytesConsumed = offset;
+                        return yajl_status_ok;
+                    }
+                    yajl_bs_set(hand->stateStack, yajl_state_parse_error);
+                    hand->parseError = "trailing garbage";
+                    goto around_again;
+            }
+#else
+            if (!(hand->flags & yajl_allow_trailing_garbage)) {
+                if (offset != jsonTextLen) {
+                    tok = yajl_lex_lex(hand->lexer, jsonText, jsonTextLen,
+                                       &offset, &buf, &bufLen);
+                    if (tok != yajl_tok_eof) {
+                        yajl_bs_set(hand->stateStack, yajl_state_parse_error);
+                        hand->parseError = "trailing garbage";
+                    }
+                    goto around_again;
+                }
+            }
+            hand->bytesConsumed = offset;
+            return yajl_status_ok;
+#endif
+        case yajl_state_lexical_error:
+        case yajl_state_parse_error:
+            hand->bytesConsumed = offset;
+            return yajl_status_error;
+        case yajl_state_memory_error:
+            hand->bytesConsumed = offset;
+            return yajl_status_out_of_memory;
+        case yajl_state_limit_error:
+            hand->bytesConsumed = offset;
+            return hand->limitStatus;
+        case yajl_state_start:
+        case yajl_state_got_value:
+        case yajl_state_map_need_val:
+        case yajl_state_array_need_val:
+        case yajl_state_array_start:  {
+            /* for arrays and maps, we advance the state for this
+             * depth, then push the state of the next depth.
+             * If an error occurs during the parsing of the nesting
+             * enitity, the state at this level will not matter.
+             * a state that needs pushing will be anything other
+             * than state_start */
+
+            yajl_state stateToPush = yajl_state_start;
+
+            if (hand->stringCallbacks != NULL && hand->rawCallback == NULL) {
+                yajl_lex_stream_strings(hand->lexer,
+                    hand->stringCallbacks->yajl_string_begin != NULL);
+            }
+            tok = yajl_lex_lex(hand->lexer, jsonText, jsonTextLen,
+                               &offset, &buf, &bufLen);
+
+            /* the value asked for by yajl_capture_raw_value() begins */
+            if (YAJL_CAN_CAPTURE && hand->rawCallback != NULL &&
+                !hand->rawCapturing && tok != yajl_tok_eof &&
+                tok != yajl_tok_error && tok != yajl_tok_right_brace)
+            {
+                yajl_begin_raw(hand, offset);
+            }
+
+            if ((hand->flags & yajl_hash_containers) &&
+                !yajl_hash_token(hand, tok, buf, bufLen, 0))
+            {
+                goto memory_error;
+            }
+
+            switch (tok) {
+                case yajl_tok_eof:
+                    hand->bytesConsumed = offset;
+                    return yajl_status_ok;
+                case yajl_tok_error:
+                    yajl_bs_set(hand->stateStack, yajl_lex_error_state(hand));
+                    goto around_again;
+                case yajl_tok_string_segments: {
+                    size_t count;
+                    const yajl_segment * segs =
+                        yajl_lex_segments(hand->lexer, &count);
+                    hand->bytesConsumed = offset;
+                    hand->startOffset = offset - bufLen;
+                    hand->endOffset = offset;
+                    if (hand->rawCallback == NULL) {
+                        cont = hand->chunkCallbacks->string_segments(
+                            hand->ctx, 0, segs, count);
+                    }
+                    break;
+                }
+                case yajl_tok_string_part:
+                case yajl_tok_string_end:
+                    hand->bytesConsumed = offset;
+                    hand->startOffset = offset - bufLen;
+                    hand->endOffset = offset;
+                    cont = yajl_stream_string(hand, buf, bufLen, 0,
+                                              tok == yajl_tok_string_end);
+                    if (cont < 0) goto memory_error;
+                    /* the rest is in the next chunk */
+                    if (tok == yajl_tok_string_part) {
+                        if (!cont) goto around_again;
+                        return yajl_status_ok;
+                    }
+                    break;
+                case yajl_tok_string:
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_string) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        cont = YAJL_CBS->yajl_string(hand->ctx,
+                            buf, bufLen);
+                    }
+                    break;
+                case yajl_tok_string_with_escapes:
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_string) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        if (!yajl_decode_string(hand, jsonText, offset, &buf,
+                                                &bufLen))
+                        {
+                            goto memory_error;
+                        }
+                        if (hand->flags & yajl_hash_containers) {
+                            yajl_hash_string(hand, buf, bufLen, 0);
+                        }
+                        cont = YAJL_CBS->yajl_string(hand->ctx, buf, bufLen);
+                    } else if ((hand->flags & yajl_hash_containers) &&
+                               !yajl_hash_escaped(hand, buf, bufLen, 0))
+                    {
+                        goto memory_error;
+                    }
+                    break;
+                case yajl_tok_bool:
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_boolean) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        cont = YAJL_CBS->yajl_boolean(hand->ctx,
+                            *buf == 't');
+                    }
+                    break;
+                case yajl_tok_null:
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_null) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        cont = YAJL_CBS->yajl_null(hand->ctx);
+                    }
+                    break;
+                case yajl_tok_left_bracket:
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_start_map) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        cont = YAJL_CBS->yajl_start_map(hand->ctx);
+                    }
+                    stateToPush = yajl_state_map_start;
+                    break;
+                case yajl_tok_left_brace:
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_start_array) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        cont = YAJL_CBS->yajl_start_array(hand->ctx);
+                    }
+                    stateToPush = yajl_state_array_start;
+                    break;
+                case yajl_tok_integer:
+                    if (YAJL_HAS_CBS) {
+                        if (YAJL_CBS->yajl_number) {
+                            hand->bytesConsumed = offset;
+                            hand->startOffset = offset - bufLen;
+                            hand->endOffset = offset;
+                            cont = YAJL_CBS->yajl_number(hand->ctx,
+                                (const char *) buf, bufLen);
+                        } else if (YAJL_CBS->yajl_integer) {
+                            long long int i = 0;
+                            errno = 0;
+                            i = yajl_parse_integer(buf, bufLen);
+                            if ((i == LLONG_MIN || i == LLONG_MAX) &&
+                                errno == ERANGE)
+                            {
+                                yajl_bs_set(hand->stateStack,
+                                            yajl_state_parse_error);
+                                hand->parseError = "integer overflow" ;
+                                /* try to restore error offset */
+                                if (offset >= bufLen) offset -= bufLen;
+                                else offset = 0;
+                                goto around_again;
+                            }
+                            hand->bytesConsumed = offset;
+                            hand->startOffset = offset - bufLen;
+                            hand->endOffset = offset;
+                            cont = YAJL_CBS->yajl_integer(hand->ctx,
+                                i);
+                        }
+                    }
+                    break;
+                case yajl_tok_double:
+                    if (YAJL_HAS_CBS) {
+                        if (YAJL_CBS->yajl_number) {
+                            hand->bytesConsumed = offset;
+                            hand->startOffset = offset - bufLen;
+                            hand->endOffset = offset;
+                            cont = YAJL_CBS->yajl_number(hand->ctx,
+                                (const char *) buf, bufLen);
+                        } else if (YAJL_CBS->yajl_double) {
+                            double d = 0.0;
+                            yajl_buf_clear(hand->decodeBuf);
+                            yajl_buf_append(hand->decodeBuf, buf, bufLen);
+                            if (yajl_buf_err(hand->decodeBuf)) goto memory_error;
+                            buf = yajl_buf_data(hand->decodeBuf);
+                            errno = 0;
+                            d = strtod((char *) buf, NULL);
+                            if ((d == HUGE_VAL || d == -HUGE_VAL) &&
+                                errno == ERANGE)
+                            {
+                                yajl_bs_set(hand->stateStack,
+                                            yajl_state_parse_error);
+                                hand->parseError = "numeric (floating point) "
+                                    "overflow";
+                                /* try to restore error offset */
+                                if (offset >= bufLen) offset -= bufLen;
+                                else offset = 0;
+                                goto around_again;
+                            }
+                            hand->bytesConsumed = offset;
+                            hand->startOffset = offset - bufLen;
+                            hand->endOffset = offset;
+                            cont = YAJL_CBS->yajl_double(hand->ctx,
+                                d);
+                        }
+                    }
+                    break;
+                case yajl_tok_right_brace: {
+                    if (yajl_bs_current(hand->stateStack) ==
+                        yajl_state_array_start)
+                    {
+                        YAJL_HASH_CONTAINER_END;
+                        if (YAJL_HAS_CBS &&
+                            YAJL_CBS->yajl_end_array)
+                        {
+                            hand->bytesConsumed = offset;
+                            hand->startOffset = offset - bufLen;
+                            hand->endOffset = offset;
+                            cont = YAJL_CBS->yajl_end_array(hand->ctx);
+                        }
+                        yajl_pop_container(hand);
+                        YAJL_CAPTURED_CONTAINER;
+                        goto around_again;
+                    }
+                    /* intentional fall-through */
+                }
+                case yajl_tok_colon:
+                case yajl_tok_comma:
+                case yajl_tok_right_bracket:
+                    yajl_bs_set(hand->stateStack, yajl_state_parse_error);
+                    hand->parseError =
+                        "unallowed token at this point in JSON text";
+                    goto around_again;
+                default:
+                    yajl_bs_set(hand->stateStack, yajl_state_parse_error);
+                    hand->parseError = "invalid token, internal error";
+                    goto around_again;
+            }
+            /* a scalar being captured is complete */
+            if (YAJL_CAN_CAPTURE && hand->rawCapturing &&
+                stateToPush == yajl_state_start &&
+                yajl_bs_depth(hand->stateStack) == hand->rawDepth)
+            {
+                cont = yajl_end_raw(hand, jsonText, offset);
+            }
+            /* got a value.  transition depends on the state we're in. */
+            {
+                yajl_state s = yajl_bs_current(hand->stateStack);
+                if (s == yajl_state_start || s == yajl_state_got_value) {
+                    yajl_bs_set(hand->stateStack, yajl_state_parse_complete);
+                } else if (s == yajl_state_map_need_val) {
+                    yajl_bs_set(hand->stateStack, yajl_state_map_got_val);
+                } else {
+                    yajl_bs_set(hand->stateStack, yajl_state_array_got_val);
+                }
+            }
+            if (stateToPush != yajl_state_start) {
+                yajl_push_container(hand, stateToPush);
+                if (yajl_bs_err(hand->stateStack)) goto memory_error;
+                if (yajl_depth_exceeded(hand)) {
+                    yajl_set_limit_error(hand, yajl_status_max_depth_exceeded);
+                }
+            }
+
+            goto around_again;
+        }
+        case yajl_state_map_start:
+        case yajl_state_map_need_key: {
+            /* only difference between these two states is that in
+             * start '}' is valid, whereas in need_key, we've parsed
+             * a comma, and a string key _must_ follow */
+            if (hand->stringCallbacks != NULL && hand->rawCallback == NULL) {
+                yajl_lex_stream_strings(hand->lexer,
+                    hand->stringCallbacks->yajl_map_key_begin != NULL);
+            }
+            tok = yajl_lex_lex(hand->lexer, jsonText, jsonTextLen,
+                               &offset, &buf, &bufLen);
+            if ((hand->flags & yajl_hash_containers) &&
+                !yajl_hash_token(hand, tok, buf, bufLen, 1))
+            {
+                goto memory_error;
+            }
+            switch (tok) {
+                case yajl_tok_eof:
+                    hand->bytesConsumed = offset;
+                    return yajl_status_ok;
+                case yajl_tok_error:
+                    yajl_bs_set(hand->stateStack, yajl_lex_error_state(hand));
+                    goto around_again;
+                case yajl_tok_string_segments: {
+                    size_t count;
+                    const yajl_segment * segs =
+                        yajl_lex_segments(hand->lexer, &count);
+                    hand->bytesConsumed = offset;
+                    hand->startOffset = offset - bufLen;
+                    hand->endOffset = offset;
+                    if (hand->rawCallback == NULL) {
+                        cont = hand->chunkCallbacks->string_segments(
+                            hand->ctx, 1, segs, count);
+                    }
+                    yajl_bs_set(hand->stateStack, yajl_state_map_sep);
+                    goto around_again;
+                }
+                case yajl_tok_string_part:
+                case yajl_tok_string_end:
+                    hand->bytesConsumed = offset;
+                    hand->startOffset = offset - bufLen;
+                    hand->endOffset = offset;
+                    cont = yajl_stream_string(hand, buf, bufLen, 1,
+                                              tok == yajl_tok_string_end);
+                    if (cont < 0) goto memory_error;
+                    /* the rest is in the next chunk */
+                    if (tok == yajl_tok_string_part) {
+                        if (!cont) goto around_again;
+                        return yajl_status_ok;
+                    }
+                    yajl_bs_set(hand->stateStack, yajl_state_map_sep);
+                    goto around_again;
+                case yajl_tok_string_with_escapes:
+                case yajl_tok_string:
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_map_key) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        if (tok == yajl_tok_string_with_escapes) {
+                            if (!yajl_decode_string(hand, jsonText, offset,
+                                                    &buf, &bufLen))
+                            {
+                                goto memory_error;
+                            }
+                            if (hand->flags & yajl_hash_containers) {
+                                yajl_hash_string(hand, buf, bufLen, 1);
+                            }
+                        }
+                        cont = YAJL_CBS->yajl_map_key(hand->ctx, buf,
+                            bufLen);
+                    } else if (tok == yajl_tok_string_with_escapes &&
+                               (hand->flags & yajl_hash_containers) &&
+                               !yajl_hash_escaped(hand, buf, bufLen, 1))
+                    {
+                        goto memory_error;
+                    }
+                    yajl_bs_set(hand->stateStack, yajl_state_map_sep);
+                    goto around_again;
+                case yajl_tok_right_bracket:
+                    if (yajl_bs_current(hand->stateStack) ==
+                        yajl_state_map_start)
+                    {
+                        YAJL_HASH_CONTAINER_END;
+                        if (YAJL_HAS_CBS && YAJL_CBS->yajl_end_map) {
+                            hand->bytesConsumed = offset;
+                            hand->startOffset = offset - bufLen;
+                            hand->endOffset = offset;
+                            cont = YAJL_CBS->yajl_end_map(hand->ctx);
+                        }
+                        yajl_pop_container(hand);
+                        YAJL_CAPTURED_CONTAINER;
+                        goto around_again;
+                    }
+                default:
+                    yajl_bs_set(hand->stateStack, yajl_state_parse_error);
+                    hand->parseError =
+                        "invalid object key (must be a string)"; 
+                    goto around_again;
+            }
+        }
+        case yajl_state_map_sep: {
+            tok = yajl_lex_lex(hand->lexer, jsonText, jsonTextLen,
+                               &offset, &buf, &bufLen);
+            switch (tok) {
+                case yajl_tok_colon:
+                    yajl_bs_set(hand->stateStack, yajl_state_map_need_val);
+                    goto around_again;
+                case yajl_tok_eof:
+                    hand->bytesConsumed = offset;
+                    return yajl_status_ok;
+                case yajl_tok_error:
+                    yajl_bs_set(hand->stateStack, yajl_lex_error_state(hand));
+                    goto around_again;
+                default:
+                    yajl_bs_set(hand->stateStack, yajl_state_parse_error);
+                    hand->parseError = "object key and value must "
+                        "be separated by a colon (':')";
+                    goto around_again;
+            }
+        }
+        case yajl_state_map_got_val: {
+            tok = yajl_lex_lex(hand->lexer, jsonText, jsonTextLen,
+                               &offset, &buf, &bufLen);
+            switch (tok) {
+                case yajl_tok_right_bracket:
+                    YAJL_HASH_CONTAINER_END;
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_end_map) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        cont = YAJL_CBS->yajl_end_map(hand->ctx);
+                    }
+                    yajl_pop_container(hand);
+                    YAJL_CAPTURED_CONTAINER;
+                    goto around_again;
+                case yajl_tok_comma:
+                    yajl_bs_set(hand->stateStack, yajl_state_map_need_key);
+                    goto around_again;
+                case yajl_tok_eof:
+                    hand->bytesConsumed = offset;
+                    return yajl_status_ok;
+                case yajl_tok_error:
+                    yajl_bs_set(hand->stateStack, yajl_lex_error_state(hand));
+                    goto around_again;
+#ifdef YAJL_SUPPLEMENTARY
+                case yajl_tok_string_segments:
+                    if (!yajl_lex_stitch(hand->lexer, &buf, &bufLen)) {
+                        goto memory_error;
+                    }
+                    /* intentional fall-through */
+                case yajl_tok_string:
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_sup_string) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        cont = YAJL_CBS->yajl_sup_string(hand->ctx,
+                            buf, bufLen);
+                        goto around_again;
+                    }
+                    goto map_unallowed;
+                case yajl_tok_string_with_escapes:
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_sup_string) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        if (!yajl_decode_string(hand, jsonText, offset, &buf,
+                                                &bufLen))
+                        {
+                            goto memory_error;
+                        }
+                        cont = YAJL_CBS->yajl_sup_string(hand->ctx, buf, bufLen);
+                        goto around_again;
+                    }
+                    goto map_unallowed;
+                case yajl_tok_bool:
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_sup_boolean) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        cont = YAJL_CBS->yajl_sup_boolean(hand->ctx,
+                            *buf == 't');
+                        goto around_again;
+                    }
+                    goto map_unallowed;
+                case yajl_tok_null:
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_sup_null) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        cont = YAJL_CBS->yajl_sup_null(hand->ctx);
+                        goto around_again;
+                    }
+                    goto map_unallowed;
+                case yajl_tok_integer:
+                    if (YAJL_HAS_CBS) {
+                        if (YAJL_CBS->yajl_sup_number) {
+                            hand->bytesConsumed = offset;
+                            hand->startOffset = offset - bufLen;
+                            hand->endOffset = offset;
+                            cont = YAJL_CBS->yajl_sup_number(hand->ctx,
+                                (const char *) buf, bufLen);
+                            goto around_again;
+                        } else if (YAJL_CBS->yajl_sup_integer) {
+                            long long int i = 0;
+                            errno = 0;
+                            i = yajl_parse_integer(buf, bufLen);
+                            if ((i == LLONG_MIN || i == LLONG_MAX) &&
+                                errno == ERANGE)
+                            {
+                                yajl_bs_set(hand->stateStack,
+                                            yajl_state_parse_error);
+                                hand->parseError = "integer overflow" ;
+                                /* try to restore error offset */
+                                if (offset >= bufLen) offset -= bufLen;
+                                else offset = 0;
+                                goto around_again;
+                            }
+                            hand->bytesConsumed = offset;
+                            hand->startOffset = offset - bufLen;
+                            hand->endOffset = offset;
+                            cont = YAJL_CBS->yajl_sup_integer(hand->ctx,
+                                i);
+                            goto around_again;
+                        }
+                    }
+                    goto map_unallowed;
+                case yajl_tok_double:
+                    if (YAJL_HAS_CBS) {
+                        if (YAJL_CBS->yajl_sup_number) {
+                            hand->bytesConsumed = offset;
+                            hand->startOffset = offset - bufLen;
+                            hand->endOffset = offset;
+                            cont = YAJL_CBS->yajl_sup_number(hand->ctx,
+                                (const char *) buf, bufLen);
+                            goto around_again;
+                        } else if (YAJL_CBS->yajl_sup_double) {
+                            double d = 0.0;
+                            yajl_buf_clear(hand->decodeBuf);
+                            yajl_buf_append(hand->decodeBuf, buf, bufLen);
+                            if (yajl_buf_err(hand->decodeBuf)) goto memory_error;
+                            buf = yajl_buf_data(hand->decodeBuf);
+                            errno = 0;
+                            d = strtod((char *) buf, NULL);
+                            if ((d == HUGE_VAL || d == -HUGE_VAL) &&
+                                errno == ERANGE)
+                            {
+                                yajl_bs_set(hand->stateStack,
+                                            yajl_state_parse_error);
+                                hand->parseError = "numeric (floating point) "
+                                    "overflow";
+                                /* try to restore error offset */
+                                if (offset >= bufLen) offset -= bufLen;
+                                else offset = 0;
+                                goto around_again;
+                            }
+                            hand->bytesConsumed = offset;
+                            hand->startOffset = offset - bufLen;
+                            hand->endOffset = offset;
+                            cont = YAJL_CBS->yajl_sup_double(hand->ctx,
+                                d);
+                            goto around_again;
+                        }
+                    }
+                    /* intentional fallthru */
+                map_unallowed:
+#endif
+                default:
+                    yajl_bs_set(hand->stateStack, yajl_state_parse_error);
+                    hand->parseError = "after key and value, inside map, "
+                                       "I expect ',' or '}'";
+                    /* try to restore error offset */
+                    if (offset >= bufLen) offset -= bufLen;
+                    else offset = 0;
+                    goto around_again;
+            }
+        }
+        case yajl_state_array_got_val: {
+            tok = yajl_lex_lex(hand->lexer, jsonText, jsonTextLen,
+                               &offset, &buf, &bufLen);
+            switch (tok) {
+                case yajl_tok_right_brace:
+                    YAJL_HASH_CONTAINER_END;
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_end_array) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        cont = YAJL_CBS->yajl_end_array(hand->ctx);
+                    }
+                    yajl_pop_container(hand);
+                    YAJL_CAPTURED_CONTAINER;
+                    goto around_again;
+                case yajl_tok_comma:
+                    yajl_bs_set(hand->stateStack, yajl_state_array_need_val);
+                    goto around_again;
+                case yajl_tok_eof:
+                    hand->bytesConsumed = offset;
+                    return yajl_status_ok;
+                case yajl_tok_error:
+                    yajl_bs_set(hand->stateStack, yajl_lex_error_state(hand));
+                    goto around_again;
+#ifdef YAJL_SUPPLEMENTARY
+                case yajl_tok_string_segments:
+                    if (!yajl_lex_stitch(hand->lexer, &buf, &bufLen)) {
+                        goto memory_error;
+                    }
+                    /* intentional fall-through */
+                case yajl_tok_string:
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_sup_string) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        cont = YAJL_CBS->yajl_sup_string(hand->ctx,
+                            buf, bufLen);
+                        goto around_again;
+                    }
+                    goto array_unallowed;
+                case yajl_tok_string_with_escapes:
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_sup_string) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        if (!yajl_decode_string(hand, jsonText, offset, &buf,
+                                                &bufLen))
+                        {
+                            goto memory_error;
+                        }
+                        cont = YAJL_CBS->yajl_sup_string(hand->ctx, buf, bufLen);
+                        goto around_again;
+                    }
+                    goto array_unallowed;
+                case yajl_tok_bool:
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_sup_boolean) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        cont = YAJL_CBS->yajl_sup_boolean(hand->ctx,
+                            *buf == 't');
+                        goto around_again;
+                    }
+                    goto array_unallowed;
+                case yajl_tok_null:
+                    if (YAJL_HAS_CBS && YAJL_CBS->yajl_sup_null) {
+                        hand->bytesConsumed = offset;
+                        hand->startOffset = offset - bufLen;
+                        hand->endOffset = offset;
+                        cont = YAJL_CBS->yajl_sup_null(hand->ctx);
+                        goto around_again;
+                    }
+                    goto array_unallowed;
+                case yajl_tok_integer:
+                    if (YAJL_HAS_CBS) {
+                        if (YAJL_CBS->yajl_sup_number) {
+                            hand->bytesConsumed = offset;
+                            hand->startOffset = offset - bufLen;
+                            hand->endOffset = offset;
+                            cont = YAJL_CBS->yajl_sup_number(hand->ctx,
+                                (const char *) buf, bufLen);
+                            goto around_again;
+                        } else if (YAJL_CBS->yajl_sup_integer) {
+                            long long int i = 0;
+                            errno = 0;
+                            i = yajl_parse_integer(buf, bufLen);
+                            if ((i == LLONG_MIN || i == LLONG_MAX) &&
+                                errno == ERANGE)
+                            {
+                                yajl_bs_set(hand->stateStack,
+                                            yajl_state_parse_error);
+                                hand->parseError = "integer overflow" ;
+                                /* try to restore error offset */
+                                if (offset >= bufLen) offset -= bufLen;
+                                else offset = 0;
+                                goto around_again;
+                            }
+                            hand->bytesConsumed = offset;
+                            hand->startOffset = offset - bufLen;
+                            hand->endOffset = offset;
+                            cont = YAJL_CBS->yajl_sup_integer(hand->ctx,
+                                i);
+                            goto around_again;
+                        }
+                    }
+                    goto array_unallowed;
+                case yajl_tok_double:
+                    if (YAJL_HAS_CBS) {
+                        if (YAJL_CBS->yajl_sup_number) {
+                            hand->bytesConsumed = offset;
+                            hand->startOffset = offset - bufLen;
+                            hand->endOffset = offset;
+                            cont = YAJL_CBS->yajl_sup_number(hand->ctx,
+                                (const char *) buf, bufLen);
+                            goto around_again;
+                        } else if (YAJL_CBS->yajl_sup_double) {
+                            double d = 0.0;
+                            yajl_buf_clear(hand->decodeBuf);
+                            yajl_buf_append(hand->decodeBuf, buf, bufLen);
+                            if (yajl_buf_err(hand->decodeBuf)) goto memory_error;
+                            buf = yajl_buf_data(hand->decodeBuf);
+                            errno = 0;
+                            d = strtod((char *) buf, NULL);
+                            if ((d == HUGE_VAL || d == -HUGE_VAL) &&
+                                errno == ERANGE)
+                            {
+                                yajl_bs_set(hand->stateStack,
+                                            yajl_state_parse_error);
+                                hand->parseError = "numeric (floating point) "
+                                    "overflow";
+                                /* try to restore error offset */
+                                if (offset >= bufLen) offset -= bufLen;
+                                else offset = 0;
+                                goto around_again;
+                            }
+                            hand->bytesConsumed = offset;
+                            hand->startOffset = offset - bufLen;
+                            hand->endOffset = offset;
+                            cont = YAJL_CBS->yajl_sup_double(hand->ctx,
+                                d);
+                            goto around_again;
+                        }
+                    }
+                    /* intentional fallthru */
+                array_unallowed:
+#endif
+                default:
+                    yajl_bs_set(hand->stateStack, yajl_state_parse_error);
+                    hand->parseError =
+                        "after array element, I expect ',' or ']'";
+                    goto around_again;
+            }
+        }
+#ifdef YAJL_SUPPLEMENTARY
+        default:
+            break;
+#endif 
+    }
+
+    abort();
+    return yajl_status_error;
+
+  memory_error:
+    yajl_bs_set(hand->stateStack, yajl_state_memory_error);
+    goto around_again;
+}
+
+#undef YAJL_HAS_CBS
+#undef YAJL_CBS
+#undef YAJL_CAN_CAPTURE
+#undef YAJL_CAPTURED_CONTAINER
+#undef YAJL_HASH_CONTAINER_END
+#undef YAJL_PARSER_CALLBACKS
+#undef YAJL_PARSER_NAME
@@ -27,39 +27,55 @@ struct yajl_rev_buf_t {
     size_t used;
     unsigned char * data;
     yajl_alloc_funcs * alloc;
+    /* number of times the buffer grew, for statistics */
+    size_t grows;
+    /* an allocation failed since the last clear */
+    int err;
 };
 
 static
-void yajl_rev_buf_ensure_available(yajl_rev_buf rev_buf, size_t want)
+int yajl_rev_buf_ensure_available(yajl_rev_buf rev_buf, size_t want)
 {
     size_t need, have;
+    unsigned char * data;
     
     assert(rev_buf != NULL);
 
     /* first call */
     if (rev_buf->len == 0) {
+        data = (unsigned char *) YA_MALLOC(rev_buf->alloc, YAJL_BUF_INIT_SIZE);
+        if (data == NULL) return 0;
+        rev_buf->data = data;
         rev_buf->len = YAJL_BUF_INIT_SIZE;
         rev_buf->used = YAJL_BUF_INIT_SIZE;
-        rev_buf->data = (unsigned char *) YA_MALLOC(rev_buf->alloc, rev_buf->len);
         rev_buf->data[YAJL_BUF_INIT_SIZE - 1] = 0;
+        rev_buf->grows++;
     }
 
     need = rev_buf->len;
     have = rev_buf->len - rev_buf->used;
 
-    while (want >= (need - have)) need <<= 1;
+    while (want >= (need - have)) {
+        if (need << 1 < need) return 0;
+        need <<= 1;
+    }
 
     if (need != rev_buf->len) {
-        rev_buf->data = (unsigned char *) YA_REALLOC(rev_buf->alloc, rev_buf->data, need);
+        data = (unsigned char *) YA_REALLOC(rev_buf->alloc, rev_buf->data, need);
+        if (data == NULL) return 0;
+        rev_buf->data = data;
         memcpy(rev_buf->data + need - have - 1, rev_buf->data + rev_buf->used - 1, have + 1);
         rev_buf->len = need;
         rev_buf->used = need - have;
+        rev_buf->grows++;
     }
+    return 1;
 }
 
 yajl_rev_buf yajl_rev_buf_alloc(yajl_alloc_funcs * alloc)
 {
     yajl_rev_buf b = YA_MALLOC(alloc, sizeof(struct yajl_rev_buf_t));
+    if (b == NULL) return NULL;
     memset((void *) b, 0, sizeof(struct yajl_rev_buf_t));
     b->data = (unsigned char *) "" + 1;
     b->alloc = alloc;
@@ -68,14 +84,18 @@ yajl_rev_buf yajl_rev_buf_alloc(yajl_alloc_funcs * alloc)
 
 void yajl_rev_buf_free(yajl_rev_buf rev_buf)
 {
-    assert(rev_buf != NULL);
+    if (rev_buf == NULL) return;
     if (rev_buf->len) YA_FREE(rev_buf->alloc, rev_buf->data);
     YA_FREE(rev_buf->alloc, rev_buf);
 }
 
 void yajl_rev_buf_append(yajl_rev_buf rev_buf, const void * data, size_t len)
 {
-    yajl_rev_buf_ensure_available(rev_buf, len);
+    if (rev_buf->err) return;
+    if (!yajl_rev_buf_ensure_available(rev_buf, len)) {
+        rev_buf->err = 1;
+        return;
+    }
     if (len > 0) {
         assert(rev_buf->len);
         rev_buf->used -= len;
@@ -86,6 +106,7 @@ void yajl_rev_buf_append(yajl_rev_buf rev_buf, const void * data, size_t len)
 void yajl_rev_buf_clear(yajl_rev_buf rev_buf)
 {
     rev_buf->used = rev_buf->len;
+    rev_buf->err = 0;
 }
 
 const unsigned char * yajl_rev_buf_data(yajl_rev_buf rev_buf)
@@ -98,6 +119,21 @@ size_t yajl_rev_buf_len(yajl_rev_buf rev_buf)
     return rev_buf->len - rev_buf->used;
 }
 
+int yajl_rev_buf_err(yajl_rev_buf rev_buf)
+{
+    return rev_buf->err;
+}
+
+size_t yajl_rev_buf_capacity(yajl_rev_buf rev_buf)
+{
+    return rev_buf->len;
+}
+
+size_t yajl_rev_buf_grows(yajl_rev_buf rev_buf)
+{
+    return rev_buf->grows;
+}
+
 void
 yajl_rev_buf_truncate(yajl_rev_buf rev_buf, size_t len)
 {
@@ -33,16 +33,18 @@
  */
 typedef struct yajl_rev_buf_t * yajl_rev_buf;
 
-/* allocate a new buffer */
+/* allocate a new buffer, returns NULL if out of memory */
 yajl_rev_buf yajl_rev_buf_alloc(yajl_alloc_funcs * alloc);
 
 /* free the buffer */
 void yajl_rev_buf_free(yajl_rev_buf rev_buf);
 
-/* append a number of bytes to the buffer */
+/* prepend a number of bytes to the buffer.  If the buffer can't grow the
+ * bytes are dropped, and so are those of later calls until the buffer is
+ * cleared, see yajl_rev_buf_err() */
 void yajl_rev_buf_append(yajl_rev_buf rev_buf, const void * data, size_t len);
 
-/* empty the buffer */
+/* empty the buffer, clearing any allocation error */
 void yajl_rev_buf_clear(yajl_rev_buf rev_buf);
 
 /* get a pointer to the beginning of the buffer */
@@ -54,4 +56,13 @@ size_t yajl_rev_buf_len(yajl_rev_buf rev_buf);
 /* truncate the buffer */
 void yajl_rev_buf_truncate(yajl_rev_buf rev_buf, size_t len);
 
+/* has a prepend failed to allocate memory since the last clear? */
+int yajl_rev_buf_err(yajl_rev_buf rev_buf);
+
+/* get the number of bytes allocated for the buffer */
+size_t yajl_rev_buf_capacity(yajl_rev_buf rev_buf);
+
+/* get the number of times the buffer allocation grew */
+size_t yajl_rev_buf_grows(yajl_rev_buf rev_buf);
+
 #endif
@@ -132,6 +132,12 @@ struct yajl_lexer_t/*yajl_rev_lexer_t*/ {
     /* note: add stuff to the end to keep the structures compatible */
     const unsigned char * data; /* entry buf start, for lookback() */
     /* note: lookback() tests rely on data being null-terminated */
+
+    /* bytes copied into rev_buf, for statistics */
+    size_t bufferedBytes;
+
+    /* longest token accepted, 0 for no limit */
+    size_t maxTokenLength;
 };
 
 #define readChar(lxr, txt, off) ((txt)[--*(off)])/*; fprintf(stderr, "readChar '%c'\n", (txt)[*(off)])*/
@@ -142,14 +148,55 @@ yajl_rev_lex_alloc(yajl_alloc_funcs * alloc,
                unsigned int allowComments, unsigned int validateUTF8)
 {
     yajl_rev_lexer lxr = (yajl_rev_lexer) YA_MALLOC(alloc, sizeof(struct yajl_lexer_t/*yajl_rev_lexer_t*/));
+    if (lxr == NULL) return NULL;
     memset((void *) lxr, 0, sizeof(struct yajl_lexer_t/*yajl_rev_lexer_t*/));
     lxr->rev_buf = yajl_rev_buf_alloc(alloc);
+    if (lxr->rev_buf == NULL) {
+        YA_FREE(alloc, lxr);
+        return NULL;
+    }
     lxr->allowComments = allowComments;
     lxr->validateUTF8 = validateUTF8;
     lxr->alloc = alloc;
     return lxr;
 }
 
+void
+yajl_rev_lex_reset(yajl_rev_lexer lxr)
+{
+    lxr->lineOff = 0;
+    lxr->charOff = 0;
+    lxr->error = yajl_lex_e_ok;
+    lxr->state = state_start;
+    lxr->substate = 0;
+    lxr->subsubstate = 0;
+    yajl_rev_buf_clear(lxr->rev_buf);
+}
+
+void
+yajl_rev_lex_config(yajl_rev_lexer lxr, unsigned int allowComments,
+                    unsigned int validateUTF8)
+{
+    lxr->allowComments = allowComments;
+    lxr->validateUTF8 = validateUTF8;
+}
+
+void
+yajl_rev_lex_set_max_token_length(yajl_rev_lexer lxr, size_t maxTokenLength)
+{
+    lxr->maxTokenLength = maxTokenLength;
+}
+
+void
+yajl_rev_lex_get_stats(yajl_rev_lexer lxr, yajl_stats * stats)
+{
+    size_t capacity = yajl_rev_buf_capacity(lxr->rev_buf);
+
+    stats->lexBufferedBytes += lxr->bufferedBytes;
+    stats->bufGrows += yajl_rev_buf_grows(lxr->rev_buf);
+    if (capacity > stats->peakBufCapacity) stats->peakBufCapacity = capacity;
+}
+
 void
 yajl_rev_lex_free(yajl_rev_lexer lxr)
 {
@@ -773,6 +820,17 @@ yajl_rev_lex_lex(yajl_rev_lexer rev_lexer, const unsigned char * jsonText,
 
 
   lexed:
+    /* the token, or the part of it read so far, may not be too long.  the
+     * rest of this chunk is not buffered then */
+    if (rev_lexer->maxTokenLength != 0 && tok != yajl_tok_error &&
+        yajl_rev_buf_len(rev_lexer->rev_buf) + (startOffset - *offset) >
+        rev_lexer->maxTokenLength)
+    {
+        rev_lexer->error = yajl_lex_token_too_long;
+        tok = yajl_tok_error;
+        entryState = state_start;
+    }
+
     /* need to append to buffer if the buffer is in use or
      * if it's an EOF token */
     if (tok == yajl_tok_eof || entryState != state_start) {
@@ -780,6 +838,11 @@ yajl_rev_lex_lex(yajl_rev_lexer rev_lexer, const unsigned char * jsonText,
         }
         yajl_rev_buf_append(rev_lexer->rev_buf, jsonText + *offset,
                             startOffset - *offset);
+        rev_lexer->bufferedBytes += startOffset - *offset;
+        if (yajl_rev_buf_err(rev_lexer->rev_buf)) {
+            rev_lexer->error = yajl_lex_out_of_memory;
+            tok = yajl_tok_error;
+        }
         if (tok != yajl_tok_eof) {
             if (tok != yajl_tok_error) { /* Nick added this test, see below */
                 *outBuf = yajl_rev_buf_data(rev_lexer->rev_buf);
@@ -56,12 +56,30 @@ typedef enum {
  */
 typedef struct yajl_lexer_t/*yajl_rev_lexer_t*/ * yajl_rev_lexer;
 
+/* returns NULL if out of memory */
 yajl_rev_lexer yajl_rev_lex_alloc(yajl_alloc_funcs * alloc,
                           unsigned int allowComments,
                           unsigned int validateUTF8);
 
+/* return the lexer to its initial state, keeping the memory it has
+ * allocated for buffering tokens */
+void yajl_rev_lex_reset(yajl_rev_lexer rev_lexer);
+
+/* change the options given to yajl_rev_lex_alloc */
+void yajl_rev_lex_config(yajl_rev_lexer rev_lexer,
+                         unsigned int allowComments,
+                         unsigned int validateUTF8);
+
 void yajl_rev_lex_free(yajl_rev_lexer rev_lexer);
 
+/* limit the length of tokens, 0 for no limit.  a longer token is a
+ * yajl_lex_token_too_long error */
+void yajl_rev_lex_set_max_token_length(yajl_rev_lexer rev_lexer,
+                                       size_t maxTokenLength);
+
+/* add the lexer's buffering figures to stats */
+void yajl_rev_lex_get_stats(yajl_rev_lexer rev_lexer, yajl_stats * stats);
+
 /**
  * run/continue a rev_lex. "offset" is an input/output parameter.
  * It should be initialized to zero for a
@@ -18,7 +18,7 @@
 #include "yajl_rev_lex.h"
 #include "yajl_rev_parser.h"
 #include "yajl_encode.h"
-#include "yajl_bytestack.h"
+#include "yajl_bitstack.h"
 
 #include <stdlib.h>
 #include <limits.h>
@@ -935,6 +935,13 @@ around_again:
     return yajl_status_error;
 }
 #else
+/* leave a container.  the enclosing level was advanced past the container
+ * when it was entered, to the state yajl_rev_do_parse gives it after a
+ * value */
+#define yajl_rev_pop_container(hand)                                    \
+    yajl_bs_pop((hand)->stateStack, yajl_state_parse_complete,          \
+                yajl_state_map_sep, yajl_state_array_got_val)
+
 yajl_status
 yajl_rev_do_finish(yajl_handle hand)
 {
@@ -964,12 +971,16 @@ around_again:
         case yajl_state_parse_error:
         case yajl_state_lexical_error:
             return yajl_status_error;
+        case yajl_state_memory_error:
+            return yajl_status_out_of_memory;
+        case yajl_state_limit_error:
+            return hand->limitStatus;
         case yajl_state_got_value:
         case yajl_state_parse_complete:
             return yajl_status_ok;
 #ifdef YAJL_SUPPLEMENTARY
         case yajl_state_sup_null: {
-            yajl_bs_pop(hand->stateStack);
+            yajl_bs_pop_lookahead(hand->stateStack);
             if (hand->callbacks->yajl_null) {
                 hand->bytesConsumed = 0;
                 cont = hand->callbacks->yajl_null(hand->ctx);
@@ -989,7 +1000,7 @@ around_again:
             goto around_again;
         }
         case yajl_state_sup_boolean: {
-            yajl_bs_pop(hand->stateStack);
+            yajl_bs_pop_lookahead(hand->stateStack);
             if (hand->callbacks->yajl_boolean) {
                 hand->bytesConsumed = 0;
                 cont = hand->callbacks->yajl_boolean(hand->ctx,
@@ -1010,7 +1021,7 @@ around_again:
             goto around_again;
         }
         case yajl_state_sup_integer: {
-            yajl_bs_pop(hand->stateStack);
+            yajl_bs_pop_lookahead(hand->stateStack);
             if (hand->callbacks->yajl_number) {
                 hand->bytesConsumed = 0;
                 cont = hand->callbacks->yajl_number(hand->ctx,
@@ -1047,7 +1058,7 @@ around_again:
             goto around_again;
         }
         case yajl_state_sup_double: {
-            yajl_bs_pop(hand->stateStack);
+            yajl_bs_pop_lookahead(hand->stateStack);
             if (hand->callbacks->yajl_number) {
                 hand->bytesConsumed = 0;
                 cont = hand->callbacks->yajl_number(hand->ctx,
@@ -1085,7 +1096,7 @@ around_again:
             goto around_again;
         }
         case yajl_state_sup_string: {
-            yajl_bs_pop(hand->stateStack);
+            yajl_bs_pop_lookahead(hand->stateStack);
             if (hand->callbacks->yajl_string) {
                 hand->bytesConsumed = 0;
                 cont = hand->callbacks->yajl_string(hand->ctx,
@@ -1162,6 +1173,12 @@ around_again:
         case yajl_state_parse_error:
             hand->bytesConsumed = (size_t) (offset - jsonTextLen);
             return yajl_status_error;
+        case yajl_state_memory_error:
+            hand->bytesConsumed = (size_t) (offset - jsonTextLen);
+            return yajl_status_out_of_memory;
+        case yajl_state_limit_error:
+            hand->bytesConsumed = (size_t) (offset - jsonTextLen);
+            return hand->limitStatus;
         case yajl_state_start:
         case yajl_state_got_value:
         /* only difference between these two states is that in
@@ -1188,7 +1205,7 @@ around_again:
                     hand->bytesConsumed = (size_t) (offset - jsonTextLen);
                     return yajl_status_ok;
                 case yajl_tok_error:
-                    yajl_bs_set(hand->stateStack, yajl_state_lexical_error);
+                    yajl_bs_set(hand->stateStack, yajl_lex_error_state(hand));
                     goto around_again;
                 case yajl_tok_string:
                     if (hand->callbacks) {
@@ -1199,8 +1216,9 @@ around_again:
                                               bufLen;
                             yajl_buf_clear(hand->decodeBuf);
                             yajl_buf_append(hand->decodeBuf, buf, bufLen);
-                            yajl_bs_push(hand->stateStack,
-                                         yajl_state_sup_string);
+                            if (yajl_buf_err(hand->decodeBuf)) goto memory_error;
+                            yajl_bs_push_lookahead(hand->stateStack,
+                                                   yajl_state_sup_string);
                             goto around_again;
                         }
 #endif
@@ -1223,14 +1241,16 @@ around_again:
                                               bufLen;
                             yajl_buf_clear(hand->decodeBuf);
                             yajl_string_decode(hand->decodeBuf, buf, bufLen);
-                            yajl_bs_push(hand->stateStack,
-                                         yajl_state_sup_string);
+                            if (yajl_buf_err(hand->decodeBuf)) goto memory_error;
+                            yajl_bs_push_lookahead(hand->stateStack,
+                                                   yajl_state_sup_string);
                             goto around_again;
                         }
 #endif
                         if (hand->callbacks->yajl_string) {
                             yajl_buf_clear(hand->decodeBuf);
                             yajl_string_decode(hand->decodeBuf, buf, bufLen);
+                            if (yajl_buf_err(hand->decodeBuf)) goto memory_error;
                             hand->bytesConsumed = (size_t) (offset - jsonTextLen);
                             hand->startOffset = (size_t) (offset - jsonTextLen);
                             hand->endOffset = (size_t) (offset - jsonTextLen) +
@@ -1250,8 +1270,9 @@ around_again:
                                               bufLen;
                             yajl_buf_clear(hand->decodeBuf);
                             yajl_buf_append(hand->decodeBuf, buf, 1/*bufLen*/);
-                            yajl_bs_push(hand->stateStack,
-                                         yajl_state_sup_boolean);
+                            if (yajl_buf_err(hand->decodeBuf)) goto memory_error;
+                            yajl_bs_push_lookahead(hand->stateStack,
+                                                   yajl_state_sup_boolean);
                             goto around_again;
                         }
 #endif
@@ -1272,8 +1293,8 @@ around_again:
                             hand->startOffset = (size_t) (offset - jsonTextLen);
                             hand->endOffset = (size_t) (offset - jsonTextLen) +
                                               bufLen;
-                            yajl_bs_push(hand->stateStack,
-                                         yajl_state_sup_null);
+                            yajl_bs_push_lookahead(hand->stateStack,
+                                                   yajl_state_sup_null);
                             goto around_again;
                         }
 #endif
@@ -1317,8 +1338,9 @@ around_again:
                                               bufLen;
                             yajl_buf_clear(hand->decodeBuf);
                             yajl_buf_append(hand->decodeBuf, buf, bufLen);
-                            yajl_bs_push(hand->stateStack,
-                                         yajl_state_sup_integer);
+                            if (yajl_buf_err(hand->decodeBuf)) goto memory_error;
+                            yajl_bs_push_lookahead(hand->stateStack,
+                                                   yajl_state_sup_integer);
                             goto around_again;
                         }
 #endif
@@ -1360,8 +1382,9 @@ around_again:
                                               bufLen;
                             yajl_buf_clear(hand->decodeBuf);
                             yajl_buf_append(hand->decodeBuf, buf, bufLen);
-                            yajl_bs_push(hand->stateStack,
-                                         yajl_state_sup_double);
+                            if (yajl_buf_err(hand->decodeBuf)) goto memory_error;
+                            yajl_bs_push_lookahead(hand->stateStack,
+                                                   yajl_state_sup_double);
                             goto around_again;
                         }
 #endif
@@ -1376,6 +1399,7 @@ around_again:
                             double d = 0.0;
                             yajl_buf_clear(hand->decodeBuf);
                             yajl_buf_append(hand->decodeBuf, buf, bufLen);
+                            if (yajl_buf_err(hand->decodeBuf)) goto memory_error;
                             buf = yajl_buf_data(hand->decodeBuf);
                             errno = 0;
                             d = strtod((char *) buf, NULL);
@@ -1409,7 +1433,7 @@ around_again:
                                               bufLen;
                             cont = hand->callbacks->yajl_start_array(hand->ctx);
                         }
-                        yajl_bs_pop(hand->stateStack);
+                        yajl_rev_pop_container(hand);
                         goto around_again;
                     }
                     goto unallowed;
@@ -1424,7 +1448,7 @@ around_again:
                                               bufLen;
                             cont = hand->callbacks->yajl_start_map(hand->ctx);
                         }
-                        yajl_bs_pop(hand->stateStack);
+                        yajl_rev_pop_container(hand);
                         goto around_again;
                     }
                     /* intentional fall-through */
@@ -1453,7 +1477,11 @@ around_again:
                 }
             }
             if (stateToPush != yajl_state_start) {
-                yajl_bs_push(hand->stateStack, stateToPush);
+                yajl_push_container(hand, stateToPush);
+                if (yajl_bs_err(hand->stateStack)) goto memory_error;
+                if (yajl_depth_exceeded(hand)) {
+                    yajl_set_limit_error(hand, yajl_status_max_depth_exceeded);
+                }
             }
 
             goto around_again;
@@ -1466,12 +1494,13 @@ around_again:
                     hand->bytesConsumed = (size_t) (offset - jsonTextLen);
                     return yajl_status_ok;
                 case yajl_tok_error:
-                    yajl_bs_set(hand->stateStack, yajl_state_lexical_error);
+                    yajl_bs_set(hand->stateStack, yajl_lex_error_state(hand));
                     goto around_again;
                 case yajl_tok_string_with_escapes:
                     if (hand->callbacks && hand->callbacks->yajl_map_key) {
                         yajl_buf_clear(hand->decodeBuf);
                         yajl_string_decode(hand->decodeBuf, buf, bufLen);
+                        if (yajl_buf_err(hand->decodeBuf)) goto memory_error;
                         buf = yajl_buf_data(hand->decodeBuf);
                         bufLen = yajl_buf_len(hand->decodeBuf);
                     }
@@ -1505,7 +1534,7 @@ around_again:
                     hand->bytesConsumed = (size_t) (offset - jsonTextLen);
                     return yajl_status_ok;
                 case yajl_tok_error:
-                    yajl_bs_set(hand->stateStack, yajl_state_lexical_error);
+                    yajl_bs_set(hand->stateStack, yajl_lex_error_state(hand));
                     goto around_again;
                 default:
                     yajl_bs_set(hand->stateStack, yajl_state_parse_error);
@@ -1526,7 +1555,7 @@ around_again:
                                           bufLen;
                         cont = hand->callbacks->yajl_start_map(hand->ctx);
                     }
-                    yajl_bs_pop(hand->stateStack);
+                    yajl_rev_pop_container(hand);
                     goto around_again;
                 case yajl_tok_comma:
                     yajl_bs_set(hand->stateStack, yajl_state_map_need_val);
@@ -1535,7 +1564,7 @@ around_again:
                     hand->bytesConsumed = (size_t) (offset - jsonTextLen);
                     return yajl_status_ok;
                 case yajl_tok_error:
-                    yajl_bs_set(hand->stateStack, yajl_state_lexical_error);
+                    yajl_bs_set(hand->stateStack, yajl_lex_error_state(hand));
                     goto around_again;
                 default:
                     yajl_bs_set(hand->stateStack, yajl_state_parse_error);
@@ -1556,7 +1585,7 @@ around_again:
                                           bufLen;
                         cont = hand->callbacks->yajl_start_array(hand->ctx);
                     }
-                    yajl_bs_pop(hand->stateStack);
+                    yajl_rev_pop_container(hand);
                     goto around_again;
                 case yajl_tok_comma:
                     yajl_bs_set(hand->stateStack, yajl_state_array_need_val);
@@ -1565,7 +1594,7 @@ around_again:
                     hand->bytesConsumed = (size_t) (offset - jsonTextLen);
                     return yajl_status_ok;
                 case yajl_tok_error:
-                    yajl_bs_set(hand->stateStack, yajl_state_lexical_error);
+                    yajl_bs_set(hand->stateStack, yajl_lex_error_state(hand));
                     goto around_again;
                 default:
                     yajl_bs_set(hand->stateStack, yajl_state_parse_error);
@@ -1585,7 +1614,7 @@ around_again:
                 c = jsonText[--offset];
             } while ((c >= '\t' && c <= '\r') || c == ' ');
             offset++;
-            yajl_bs_pop(hand->stateStack);
+            yajl_bs_pop_lookahead(hand->stateStack);
             if ((c >= '0' && c <= '9') || c == '"' ||
                 (c >= 'A' && c <= 'Z') || c == ']' ||
                 (c >= 'a' && c <= 'z') || c == '}') {
@@ -1621,7 +1650,7 @@ around_again:
                 c = jsonText[--offset];
             } while ((c >= '\t' && c <= '\r') || c == ' ');
             offset++;
-            yajl_bs_pop(hand->stateStack);
+            yajl_bs_pop_lookahead(hand->stateStack);
             if ((c >= '0' && c <= '9') || c == '"' ||
                 (c >= 'A' && c <= 'Z') || c == ']' ||
                 (c >= 'a' && c <= 'z') || c == '}') {
@@ -1659,7 +1688,7 @@ around_again:
                 c = jsonText[--offset];
             } while ((c >= '\t' && c <= '\r') || c == ' ');
             offset++;
-            yajl_bs_pop(hand->stateStack);
+            yajl_bs_pop_lookahead(hand->stateStack);
             if ((c >= '0' && c <= '9') || c == '"' ||
                 (c >= 'A' && c <= 'Z') || c == ']' ||
                 (c >= 'a' && c <= 'z') || c == '}') {
@@ -1731,7 +1760,7 @@ around_again:
                 c = jsonText[--offset];
             } while ((c >= '\t' && c <= '\r') || c == ' ');
             offset++;
-            yajl_bs_pop(hand->stateStack);
+            yajl_bs_pop_lookahead(hand->stateStack);
             if ((c >= '0' && c <= '9') || c == '"' ||
                 (c >= 'A' && c <= 'Z') || c == ']' ||
                 (c >= 'a' && c <= 'z') || c == '}') {
@@ -1805,7 +1834,7 @@ around_again:
                 c = jsonText[--offset];
             } while ((c >= '\t' && c <= '\r') || c == ' ');
             offset++;
-            yajl_bs_pop(hand->stateStack);
+            yajl_bs_pop_lookahead(hand->stateStack);
             if ((c >= '0' && c <= '9') || c == '"' ||
                 (c >= 'A' && c <= 'Z') || c == ']' ||
                 (c >= 'a' && c <= 'z') || c == '}') {
@@ -1840,6 +1869,10 @@ around_again:
 
     abort();
     return yajl_status_error;
+
+  memory_error:
+    yajl_bs_set(hand->stateStack, yajl_state_memory_error);
+    goto around_again;
 }
 #endif
 
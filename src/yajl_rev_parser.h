@@ -19,7 +19,7 @@
 
 #include <sys/types.h> /* for ssize_t */
 #include "api/yajl_parse.h"
-#include "yajl_bytestack.h"
+#include "yajl_bitstack.h"
 #include "yajl_buf.h"
 #include "yajl_rev_lex.h"
 
@@ -55,7 +55,7 @@ struct yajl_handle_t {
     /* temporary storage for decoded strings */
     yajl_buf decodeBuf;
     /* a stack of states.  access with yajl_state_XXX routines */
-    yajl_bytestack stateStack;
+    yajl_bitstack stateStack;
     /* memory allocation routines */
     yajl_alloc_funcs alloc;
     /* bitfield */
@@ -77,7 +77,7 @@ yajl_render_error_string(yajl_handle hand, const unsigned char * jsonText,
 
 /* A little built in integer parsing routine with the same semantics as strtol
  * that's unaffected by LOCALE. */
-long long
+YAJL_API long long
 yajl_parse_integer(const unsigned char *number, unsigned int length);
 #endif
 
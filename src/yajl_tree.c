@@ -38,6 +38,8 @@ struct stack_elem_s
 {
     char * key;
     yajl_val value;
+    /* a value that is still waiting for its key, see the reverse builder */
+    yajl_val pending;
     stack_elem_t *next;
 };
 
@@ -47,6 +49,13 @@ struct context_s
     yajl_val root;
     char *errbuf;
     size_t errbuf_size;
+    /* number of containers on the stack and the limit for it (0: none) */
+    size_t depth;
+    size_t max_depth;
+    /* collect top level values into the "root" array */
+    int multiple;
+    /* allocation routines for the nodes of the tree */
+    const yajl_alloc_funcs *afs;
 };
 typedef struct context_s context_t;
 
@@ -56,11 +65,11 @@ typedef struct context_s context_t;
         return (retval);                                                \
     }
 
-static yajl_val value_alloc (yajl_type type)
+static yajl_val value_alloc (context_t *ctx, yajl_type type)
 {
     yajl_val v;
 
-    v = malloc (sizeof (*v));
+    v = YA_MALLOC (ctx->afs, sizeof (*v));
     if (v == NULL) return (NULL);
     memset (v, 0, sizeof (*v));
     v->type = type;
@@ -68,7 +77,9 @@ static yajl_val value_alloc (yajl_type type)
     return (v);
 }
 
-static void yajl_object_free (yajl_val v)
+static void tree_free (const yajl_alloc_funcs *afs, yajl_val v);
+
+static void yajl_object_free (const yajl_alloc_funcs *afs, yajl_val v)
 {
     size_t i;
 
@@ -76,18 +87,18 @@ static void yajl_object_free (yajl_val v)
 
     for (i = 0; i < v->u.object.len; i++)
     {
-        free((char *) v->u.object.keys[i]);
+        YA_FREE(afs, (char *) v->u.object.keys[i]);
         v->u.object.keys[i] = NULL;
-        yajl_tree_free (v->u.object.values[i]);
+        tree_free (afs, v->u.object.values[i]);
         v->u.object.values[i] = NULL;
     }
 
-    free((void*) v->u.object.keys);
-    free(v->u.object.values);
-    free(v);
+    YA_FREE(afs, (void*) v->u.object.keys);
+    YA_FREE(afs, v->u.object.values);
+    YA_FREE(afs, v);
 }
 
-static void yajl_array_free (yajl_val v)
+static void yajl_array_free (const yajl_alloc_funcs *afs, yajl_val v)
 {
     size_t i;
 
@@ -95,12 +106,12 @@ static void yajl_array_free (yajl_val v)
 
     for (i = 0; i < v->u.array.len; i++)
     {
-        yajl_tree_free (v->u.array.values[i]);
+        tree_free (afs, v->u.array.values[i]);
         v->u.array.values[i] = NULL;
     }
 
-    free(v->u.array.values);
-    free(v);
+    YA_FREE(afs, v->u.array.values);
+    YA_FREE(afs, v);
 }
 
 /*
@@ -114,7 +125,11 @@ static int context_push(context_t *ctx, yajl_val v)
 {
     stack_elem_t *stack;
 
-    stack = malloc (sizeof (*stack));
+    if (ctx->max_depth != 0 && ctx->depth >= ctx->max_depth)
+        RETURN_ERROR (ctx, EINVAL, "Maximum nesting depth of %lu exceeded",
+                      (unsigned long) ctx->max_depth);
+
+    stack = YA_MALLOC (ctx->afs, sizeof (*stack));
     if (stack == NULL)
         RETURN_ERROR (ctx, ENOMEM, "Out of memory");
     memset (stack, 0, sizeof (*stack));
@@ -126,6 +141,7 @@ static int context_push(context_t *ctx, yajl_val v)
     stack->value = v;
     stack->next = ctx->stack;
     ctx->stack = stack;
+    ctx->depth++;
 
     return (0);
 }
@@ -141,19 +157,35 @@ static yajl_val context_pop(context_t *ctx)
 
     stack = ctx->stack;
     ctx->stack = stack->next;
+    ctx->depth--;
 
     v = stack->value;
 
-    free (stack);
+    YA_FREE (ctx->afs, stack);
 
     return (v);
 }
 
+/*
+ * Containers grow to double their size when they are full.  The capacity is
+ * not stored, it is the smallest power of two of at least 4 that holds "len"
+ * elements.  Returns the number of elements to grow to before adding one,
+ * or 0 if there is room.  Growing one element at a time would reallocate
+ * quadratic amounts, which an arena allocator never gets back.
+ */
+static size_t container_grow (size_t len)
+{
+    if (len == 0) return (4);
+    if (len < 4 || (len & (len - 1)) != 0) return (0);
+    return (len * 2);
+}
+
 static int object_add_keyval(context_t *ctx,
                              yajl_val obj, char *key, yajl_val value)
 {
     const char **tmpk;
     yajl_val *tmpv;
+    size_t size;
 
     /* We're checking for NULL in "context_add_value" or its callers. */
     assert (ctx != NULL);
@@ -164,15 +196,19 @@ static int object_add_keyval(context_t *ctx,
     /* We're assuring that "obj" is an object in "context_add_value". */
     assert(YAJL_IS_OBJECT(obj));
 
-    tmpk = realloc((void *) obj->u.object.keys, sizeof(*(obj->u.object.keys)) * (obj->u.object.len + 1));
-    if (tmpk == NULL)
-        RETURN_ERROR(ctx, ENOMEM, "Out of memory");
-    obj->u.object.keys = tmpk;
-
-    tmpv = realloc(obj->u.object.values, sizeof (*obj->u.object.values) * (obj->u.object.len + 1));
-    if (tmpv == NULL)
-        RETURN_ERROR(ctx, ENOMEM, "Out of memory");
-    obj->u.object.values = tmpv;
+    size = container_grow (obj->u.object.len);
+    if (size != 0)
+    {
+        tmpk = YA_REALLOC(ctx->afs, (void *) obj->u.object.keys, sizeof(*(obj->u.object.keys)) * size);
+        if (tmpk == NULL)
+            RETURN_ERROR(ctx, ENOMEM, "Out of memory");
+        obj->u.object.keys = tmpk;
+
+        tmpv = YA_REALLOC(ctx->afs, obj->u.object.values, sizeof (*obj->u.object.values) * size);
+        if (tmpv == NULL)
+            RETURN_ERROR(ctx, ENOMEM, "Out of memory");
+        obj->u.object.values = tmpv;
+    }
 
     obj->u.object.keys[obj->u.object.len] = key;
     obj->u.object.values[obj->u.object.len] = value;
@@ -185,6 +221,7 @@ static int array_add_value (context_t *ctx,
                             yajl_val array, yajl_val value)
 {
     yajl_val *tmp;
+    size_t size;
 
     /* We're checking for NULL pointers in "context_add_value" or its
      * callers. */
@@ -195,11 +232,15 @@ static int array_add_value (context_t *ctx,
     /* "context_add_value" will only call us with array values. */
     assert(YAJL_IS_ARRAY(array));
 
-    tmp = realloc(array->u.array.values,
-                  sizeof(*(array->u.array.values)) * (array->u.array.len + 1));
-    if (tmp == NULL)
-        RETURN_ERROR(ctx, ENOMEM, "Out of memory");
-    array->u.array.values = tmp;
+    size = container_grow (array->u.array.len);
+    if (size != 0)
+    {
+        tmp = YA_REALLOC(ctx->afs, array->u.array.values,
+                         sizeof(*(array->u.array.values)) * size);
+        if (tmp == NULL)
+            RETURN_ERROR(ctx, ENOMEM, "Out of memory");
+        array->u.array.values = tmp;
+    }
     array->u.array.values[array->u.array.len] = value;
     array->u.array.len++;
 
@@ -208,7 +249,8 @@ static int array_add_value (context_t *ctx,
 
 /*
  * Add a value to the value on top of the stack or the "root" member in the
- * context if the end of the parsing process is reached.
+ * context if the end of the parsing process is reached.  When parsing multiple
+ * values, "root" is an array that collects each top level value.
  */
 static int context_add_value (context_t *ctx, yajl_val v)
 {
@@ -229,6 +271,9 @@ static int context_add_value (context_t *ctx, yajl_val v)
      */
     if (ctx->stack == NULL)
     {
+        if (ctx->multiple)
+            return (array_add_value (ctx, ctx->root, v));
+
         assert (ctx->root == NULL);
         ctx->root = v;
         return (0);
@@ -244,7 +289,7 @@ static int context_add_value (context_t *ctx, yajl_val v)
 
             ctx->stack->key = v->u.string;
             v->u.string = NULL;
-            free(v);
+            YA_FREE(ctx->afs, v);
             return (0);
         }
         else /* if (ctx->key != NULL) */
@@ -268,41 +313,42 @@ static int context_add_value (context_t *ctx, yajl_val v)
     }
 }
 
-static int handle_string (void *ctx,
-                          const unsigned char *string, size_t string_length)
+static yajl_val string_alloc (context_t *ctx,
+                              const unsigned char *string, size_t string_length)
 {
     yajl_val v;
 
-    v = value_alloc (yajl_t_string);
+    v = value_alloc (ctx, yajl_t_string);
     if (v == NULL)
-        RETURN_ERROR ((context_t *) ctx, STATUS_ABORT, "Out of memory");
+        RETURN_ERROR (ctx, NULL, "Out of memory");
 
-    v->u.string = malloc (string_length + 1);
+    v->u.string = YA_MALLOC (ctx->afs, string_length + 1);
     if (v->u.string == NULL)
     {
-        free (v);
-        RETURN_ERROR ((context_t *) ctx, STATUS_ABORT, "Out of memory");
+        YA_FREE (ctx->afs, v);
+        RETURN_ERROR (ctx, NULL, "Out of memory");
     }
     memcpy(v->u.string, string, string_length);
     v->u.string[string_length] = 0;
 
-    return ((context_add_value (ctx, v) == 0) ? STATUS_CONTINUE : STATUS_ABORT);
+    return (v);
 }
 
-static int handle_number (void *ctx, const char *string, size_t string_length)
+static yajl_val number_alloc (context_t *ctx,
+                              const char *string, size_t string_length)
 {
     yajl_val v;
     char *endptr;
 
-    v = value_alloc(yajl_t_number);
+    v = value_alloc (ctx, yajl_t_number);
     if (v == NULL)
-        RETURN_ERROR((context_t *) ctx, STATUS_ABORT, "Out of memory");
+        RETURN_ERROR(ctx, NULL, "Out of memory");
 
-    v->u.number.r = malloc(string_length + 1);
+    v->u.number.r = YA_MALLOC(ctx->afs, string_length + 1);
     if (v->u.number.r == NULL)
     {
-        free(v);
-        RETURN_ERROR((context_t *) ctx, STATUS_ABORT, "Out of memory");
+        YA_FREE(ctx->afs, v);
+        RETURN_ERROR(ctx, NULL, "Out of memory");
     }
     memcpy(v->u.number.r, string, string_length);
     v->u.number.r[string_length] = 0;
@@ -321,6 +367,29 @@ static int handle_number (void *ctx, const char *string, size_t string_length)
     if ((errno == 0) && (endptr != NULL) && (*endptr == 0))
         v->u.number.flags |= YAJL_NUMBER_DOUBLE_VALID;
 
+    return (v);
+}
+
+static int handle_string (void *ctx,
+                          const unsigned char *string, size_t string_length)
+{
+    yajl_val v;
+
+    v = string_alloc ((context_t *) ctx, string, string_length);
+    if (v == NULL)
+        return (STATUS_ABORT);
+
+    return ((context_add_value (ctx, v) == 0) ? STATUS_CONTINUE : STATUS_ABORT);
+}
+
+static int handle_number (void *ctx, const char *string, size_t string_length)
+{
+    yajl_val v;
+
+    v = number_alloc ((context_t *) ctx, string, string_length);
+    if (v == NULL)
+        return (STATUS_ABORT);
+
     return ((context_add_value(ctx, v) == 0) ? STATUS_CONTINUE : STATUS_ABORT);
 }
 
@@ -328,7 +397,7 @@ static int handle_start_map (void *ctx)
 {
     yajl_val v;
 
-    v = value_alloc(yajl_t_object);
+    v = value_alloc ((context_t *) ctx, yajl_t_object);
     if (v == NULL)
         RETURN_ERROR ((context_t *) ctx, STATUS_ABORT, "Out of memory");
 
@@ -336,7 +405,13 @@ static int handle_start_map (void *ctx)
     v->u.object.values = NULL;
     v->u.object.len = 0;
 
-    return ((context_push (ctx, v) == 0) ? STATUS_CONTINUE : STATUS_ABORT);
+    if (context_push (ctx, v) != 0)
+    {
+        tree_free (((context_t *) ctx)->afs, v);
+        return (STATUS_ABORT);
+    }
+
+    return (STATUS_CONTINUE);
 }
 
 static int handle_end_map (void *ctx)
@@ -354,14 +429,20 @@ static int handle_start_array (void *ctx)
 {
     yajl_val v;
 
-    v = value_alloc(yajl_t_array);
+    v = value_alloc ((context_t *) ctx, yajl_t_array);
     if (v == NULL)
         RETURN_ERROR ((context_t *) ctx, STATUS_ABORT, "Out of memory");
 
     v->u.array.values = NULL;
     v->u.array.len = 0;
 
-    return ((context_push (ctx, v) == 0) ? STATUS_CONTINUE : STATUS_ABORT);
+    if (context_push (ctx, v) != 0)
+    {
+        tree_free (((context_t *) ctx)->afs, v);
+        return (STATUS_ABORT);
+    }
+
+    return (STATUS_CONTINUE);
 }
 
 static int handle_end_array (void *ctx)
@@ -379,7 +460,7 @@ static int handle_boolean (void *ctx, int boolean_value)
 {
     yajl_val v;
 
-    v = value_alloc (boolean_value ? yajl_t_true : yajl_t_false);
+    v = value_alloc ((context_t *) ctx, boolean_value ? yajl_t_true : yajl_t_false);
     if (v == NULL)
         RETURN_ERROR ((context_t *) ctx, STATUS_ABORT, "Out of memory");
 
@@ -390,65 +471,187 @@ static int handle_null (void *ctx)
 {
     yajl_val v;
 
-    v = value_alloc (yajl_t_null);
+    v = value_alloc ((context_t *) ctx, yajl_t_null);
     if (v == NULL)
         RETURN_ERROR ((context_t *) ctx, STATUS_ABORT, "Out of memory");
 
     return ((context_add_value (ctx, v) == 0) ? STATUS_CONTINUE : STATUS_ABORT);
 }
 
+/*
+ * Free whatever is left on the stack and the root after a failed parse.
+ */
+static void context_free (context_t *ctx)
+{
+    while (ctx->stack != NULL)
+    {
+        YA_FREE (ctx->afs, ctx->stack->key);
+        ctx->stack->key = NULL;
+        tree_free (ctx->afs, ctx->stack->pending);
+        ctx->stack->pending = NULL;
+        tree_free (ctx->afs, context_pop (ctx));
+    }
+    tree_free (ctx->afs, ctx->root);
+    ctx->root = NULL;
+}
+
+/*
+ * Close the containers that are still open when a partial value ended the
+ * input.  A pending key that did not get its value is dropped.
+ */
+static int context_close_partial (context_t *ctx)
+{
+    while (ctx->stack != NULL)
+    {
+        yajl_val v;
+
+        YA_FREE (ctx->afs, ctx->stack->key);
+        ctx->stack->key = NULL;
+
+        v = context_pop (ctx);
+        if (context_add_value (ctx, v) != 0)
+        {
+            tree_free (ctx->afs, v);
+            return (-1);
+        }
+    }
+
+    return (0);
+}
+
 /*
  * Public functions
  */
+static const yajl_callbacks tree_callbacks =
+    {
+        /* null        = */ handle_null,
+        /* boolean     = */ handle_boolean,
+        /* integer     = */ NULL,
+        /* double      = */ NULL,
+        /* number      = */ handle_number,
+        /* string      = */ handle_string,
+        /* start map   = */ handle_start_map,
+        /* map key     = */ handle_string,
+        /* end map     = */ handle_end_map,
+        /* start array = */ handle_start_array,
+        /* end array   = */ handle_end_array
+    };
+
+/* a parse loop of our own, which calls the handlers above directly */
+#define YAJL_PARSER_NAME tree_do_parse
+#define YAJL_PARSER_CALLBACKS tree_callbacks
+#include "yajl_parser_tmpl.h"
+
 yajl_val yajl_tree_parse (const char *input,
                           char *error_buffer, size_t error_buffer_size)
 {
-    static const yajl_callbacks callbacks =
-        {
-            /* null        = */ handle_null,
-            /* boolean     = */ handle_boolean,
-            /* integer     = */ NULL,
-            /* double      = */ NULL,
-            /* number      = */ handle_number,
-            /* string      = */ handle_string,
-            /* start map   = */ handle_start_map,
-            /* map key     = */ handle_string,
-            /* end map     = */ handle_end_map,
-            /* start array = */ handle_start_array,
-            /* end array   = */ handle_end_array
-        };
+    return (yajl_tree_parse_options (input, strlen (input),
+                                     yajl_tree_option_allow_comments, 0, 0,
+                                     error_buffer, error_buffer_size));
+}
+
+yajl_val yajl_tree_parse_options (const char *input, size_t input_length,
+                                  unsigned int options,
+                                  size_t max_depth, size_t max_size,
+                                  char *error_buffer, size_t error_buffer_size)
+{
+    return (yajl_tree_parse_alloc (input, input_length, options,
+                                   max_depth, max_size, NULL,
+                                   error_buffer, error_buffer_size));
+}
 
+yajl_val yajl_tree_parse_alloc (const char *input, size_t input_length,
+                                unsigned int options,
+                                size_t max_depth, size_t max_size,
+                                const yajl_alloc_funcs *afs,
+                                char *error_buffer, size_t error_buffer_size)
+{
+    yajl_alloc_funcs afsBuffer;
     yajl_handle handle;
     yajl_status status;
     char * internal_err_str;
-	context_t ctx = { NULL, NULL, NULL, 0 };
+    context_t ctx;
+
+    /* the handle gets a copy, the nodes are allocated via afsBuffer */
+    if (afs != NULL) {
+        if (afs->malloc == NULL || afs->realloc == NULL || afs->free == NULL)
+        {
+            return NULL;
+        }
+        afsBuffer = *afs;
+    } else {
+        yajl_set_default_alloc_funcs(&afsBuffer);
+    }
 
-	ctx.errbuf = error_buffer;
-	ctx.errbuf_size = error_buffer_size;
+    memset (&ctx, 0, sizeof (ctx));
+    ctx.afs = &afsBuffer;
+    ctx.errbuf = error_buffer;
+    ctx.errbuf_size = error_buffer_size;
+    ctx.max_depth = max_depth;
+    ctx.multiple = (options & yajl_tree_option_allow_multiple_values) != 0;
 
     if (error_buffer != NULL)
         memset (error_buffer, 0, error_buffer_size);
 
-    handle = yajl_alloc (&callbacks, NULL, &ctx);
-    yajl_config(handle, yajl_allow_comments, 1);
+    if (max_size != 0 && input_length > max_size)
+        RETURN_ERROR (&ctx, NULL, "Input exceeds the maximum size of %lu bytes",
+                      (unsigned long) max_size);
+
+    if (ctx.multiple)
+    {
+        ctx.root = value_alloc (&ctx, yajl_t_array);
+        if (ctx.root == NULL)
+            RETURN_ERROR (&ctx, NULL, "Out of memory");
+    }
 
-    status = yajl_parse(handle,
-                        (unsigned char *) input,
-                        strlen (input));
-    status = yajl_complete_parse (handle);
+    handle = yajl_alloc (&tree_callbacks, &afsBuffer, &ctx);
+    if (handle == NULL)
+    {
+        context_free (&ctx);
+        RETURN_ERROR (&ctx, NULL, "Out of memory");
+    }
+    yajl_config(handle, yajl_allow_comments,
+                (options & yajl_tree_option_allow_comments) != 0);
+    yajl_config(handle, yajl_dont_validate_strings,
+                (options & yajl_tree_option_dont_validate_strings) != 0);
+    yajl_config(handle, yajl_allow_trailing_garbage,
+                (options & yajl_tree_option_allow_trailing_garbage) != 0);
+    yajl_config(handle, yajl_allow_multiple_values, ctx.multiple);
+    yajl_config(handle, yajl_allow_partial_values,
+                (options & yajl_tree_option_allow_partial_values) != 0);
+
+    status = yajl_parse_prepare(handle, input_length, 0);
+    if (status == yajl_status_ok)
+        status = tree_do_parse(handle,
+                               (const unsigned char *) input,
+                               input_length);
+    if (status == yajl_status_ok)
+        status = yajl_finish_status(handle,
+                     tree_do_parse(handle, (const unsigned char *) " ", 1));
     if (status != yajl_status_ok) {
-        if (error_buffer != NULL && error_buffer_size > 0) {
+        /* a message set by one of our callbacks is more useful than the
+         * generic "client cancelled" one */
+        if (error_buffer != NULL && error_buffer_size > 0 &&
+            error_buffer[0] == 0) {
                internal_err_str = (char *) yajl_get_error(handle, 1,
                      (const unsigned char *) input,
-                     strlen(input));
+                     input_length);
              snprintf(error_buffer, error_buffer_size, "%s", internal_err_str);
              YA_FREE(&(handle->alloc), internal_err_str);
         }
         yajl_free (handle);
+        context_free (&ctx);
         return NULL;
     }
 
     yajl_free (handle);
+
+    if (context_close_partial (&ctx) != 0)
+    {
+        context_free (&ctx);
+        return NULL;
+    }
+
     return (ctx.root);
 }
 
@@ -474,30 +677,724 @@ yajl_val yajl_tree_get(yajl_val n, const char ** path, yajl_type type)
     return n;
 }
 
-void yajl_tree_free (yajl_val v)
+static void tree_free (const yajl_alloc_funcs *afs, yajl_val v)
 {
     if (v == NULL) return;
 
     if (YAJL_IS_STRING(v))
     {
-        free(v->u.string);
-        free(v);
+        YA_FREE(afs, v->u.string);
+        YA_FREE(afs, v);
     }
     else if (YAJL_IS_NUMBER(v))
     {
-        free(v->u.number.r);
-        free(v);
+        YA_FREE(afs, v->u.number.r);
+        YA_FREE(afs, v);
     }
     else if (YAJL_GET_OBJECT(v))
     {
-        yajl_object_free(v);
+        yajl_object_free(afs, v);
     }
     else if (YAJL_GET_ARRAY(v))
     {
-        yajl_array_free(v);
+        yajl_array_free(afs, v);
     }
     else /* if (yajl_t_true or yajl_t_false or yajl_t_null) */
     {
-        free(v);
+        YA_FREE(afs, v);
+    }
+}
+
+void yajl_tree_free (yajl_val v)
+{
+    yajl_tree_free_alloc (v, NULL);
+}
+
+void yajl_tree_free_alloc (yajl_val v, const yajl_alloc_funcs *afs)
+{
+    yajl_alloc_funcs afsBuffer;
+
+    if (afs == NULL) {
+        yajl_set_default_alloc_funcs(&afsBuffer);
+        afs = &afsBuffer;
+    }
+    tree_free (afs, v);
+}
+
+/*
+ * Streaming tree builder.  Containers above the yield depth are not built,
+ * only counted in "open".  Each value at the yield depth is built using the
+ * context stack as above, handed to the callback and freed.
+ */
+struct yajl_tree_stream_s
+{
+    context_t ctx;
+    yajl_handle handle;
+    yajl_alloc_funcs alloc;
+
+    size_t yield_depth;
+    const char **path;
+    yajl_tree_element_func callback;
+    void *callback_ctx;
+
+    /* number of open containers, built or not */
+    size_t open;
+    /* value of "open" inside the container whose key did not match the
+     * path, 0 if the path matches so far */
+    size_t filtered;
+    /* last key read at or above the yield depth, until its value is read */
+    char *key;
+
+    char errbuf[128];
+};
+typedef struct yajl_tree_stream_s stream_t;
+
+/* does the key of the value at the current depth match the path? */
+static int stream_key_matches (stream_t *s)
+{
+    size_t i;
+
+    if (s->path == NULL || s->open == 0) return (1);
+
+    for (i = 0; i < s->open; i++)
+        if (s->path[i] == NULL) return (1);
+
+    return (s->key != NULL && !strcmp (s->path[s->open - 1], s->key));
+}
+
+/* is the value that starts now part of an element? */
+static int stream_building (stream_t *s)
+{
+    if (s->ctx.stack != NULL) return (1);
+
+    if (s->open == s->yield_depth && s->filtered == 0
+        && stream_key_matches (s))
+        return (1);
+
+    /* the value is skipped, so is its key */
+    YA_FREE (&s->alloc, s->key);
+    s->key = NULL;
+    return (0);
+}
+
+static int stream_yield (stream_t *s, yajl_val v)
+{
+    int rv;
+
+    rv = s->callback (s->callback_ctx, s->key, v);
+    tree_free (&s->alloc, v);
+    YA_FREE (&s->alloc, s->key);
+    s->key = NULL;
+
+    return (rv ? STATUS_CONTINUE : STATUS_ABORT);
+}
+
+/* a complete value "v" at the current depth */
+static int stream_add_value (stream_t *s, yajl_val v)
+{
+    if (s->ctx.stack == NULL)
+        return (stream_yield (s, v));
+
+    if (context_add_value (&s->ctx, v) != 0)
+    {
+        tree_free (&s->alloc, v);
+        return (STATUS_ABORT);
+    }
+    return (STATUS_CONTINUE);
+}
+
+static int stream_handle_string (void *ctx,
+                                 const unsigned char *string,
+                                 size_t string_length)
+{
+    stream_t *s = ctx;
+    yajl_val v;
+
+    if (!stream_building (s)) return (STATUS_CONTINUE);
+
+    v = string_alloc (&s->ctx, string, string_length);
+    if (v == NULL)
+        return (STATUS_ABORT);
+
+    return (stream_add_value (s, v));
+}
+
+static int stream_handle_map_key (void *ctx,
+                                  const unsigned char *string,
+                                  size_t string_length)
+{
+    stream_t *s = ctx;
+
+    if (s->ctx.stack != NULL)
+        return (handle_string (&s->ctx, string, string_length));
+
+    if (s->filtered != 0 || s->open > s->yield_depth)
+        return (STATUS_CONTINUE);
+
+    YA_FREE (&s->alloc, s->key);
+    s->key = YA_MALLOC (&s->alloc, string_length + 1);
+    if (s->key == NULL)
+        RETURN_ERROR (&s->ctx, STATUS_ABORT, "Out of memory");
+    memcpy (s->key, string, string_length);
+    s->key[string_length] = 0;
+
+    return (STATUS_CONTINUE);
+}
+
+static int stream_handle_number (void *ctx, const char *string,
+                                 size_t string_length)
+{
+    stream_t *s = ctx;
+    yajl_val v;
+
+    if (!stream_building (s)) return (STATUS_CONTINUE);
+
+    v = number_alloc (&s->ctx, string, string_length);
+    if (v == NULL)
+        return (STATUS_ABORT);
+
+    return (stream_add_value (s, v));
+}
+
+static int stream_handle_boolean (void *ctx, int boolean_value)
+{
+    stream_t *s = ctx;
+    yajl_val v;
+
+    if (!stream_building (s)) return (STATUS_CONTINUE);
+
+    v = value_alloc (&s->ctx, boolean_value ? yajl_t_true : yajl_t_false);
+    if (v == NULL)
+        RETURN_ERROR (&s->ctx, STATUS_ABORT, "Out of memory");
+
+    return (stream_add_value (s, v));
+}
+
+static int stream_handle_null (void *ctx)
+{
+    stream_t *s = ctx;
+    yajl_val v;
+
+    if (!stream_building (s)) return (STATUS_CONTINUE);
+
+    v = value_alloc (&s->ctx, yajl_t_null);
+    if (v == NULL)
+        RETURN_ERROR (&s->ctx, STATUS_ABORT, "Out of memory");
+
+    return (stream_add_value (s, v));
+}
+
+static int stream_handle_start (stream_t *s, yajl_type type)
+{
+    int rv = STATUS_CONTINUE;
+
+    if (s->ctx.stack == NULL && s->open < s->yield_depth)
+    {
+        /* a container above the elements: only check the path */
+        if (s->filtered == 0 && !stream_key_matches (s))
+            s->filtered = s->open + 1;
+        YA_FREE (&s->alloc, s->key);
+        s->key = NULL;
+    }
+    else if (stream_building (s))
+    {
+        rv = (type == yajl_t_object) ? handle_start_map (&s->ctx)
+                                     : handle_start_array (&s->ctx);
+    }
+
+    s->open++;
+    return (rv);
+}
+
+static int stream_handle_end (void *ctx)
+{
+    stream_t *s = ctx;
+    yajl_val v;
+
+    if (s->filtered == s->open) s->filtered = 0;
+    s->open--;
+
+    if (s->ctx.stack == NULL) return (STATUS_CONTINUE);
+
+    v = context_pop (&s->ctx);
+    if (v == NULL)
+        return (STATUS_ABORT);
+
+    return (stream_add_value (s, v));
+}
+
+static int stream_handle_start_map (void *ctx)
+{
+    return (stream_handle_start (ctx, yajl_t_object));
+}
+
+static int stream_handle_start_array (void *ctx)
+{
+    return (stream_handle_start (ctx, yajl_t_array));
+}
+
+yajl_tree_stream yajl_tree_stream_alloc (size_t depth, const char **path,
+                                         unsigned int options,
+                                         yajl_tree_element_func callback,
+                                         const yajl_alloc_funcs *afs,
+                                         void *ctx)
+{
+    static const yajl_callbacks callbacks =
+        {
+            /* null        = */ stream_handle_null,
+            /* boolean     = */ stream_handle_boolean,
+            /* integer     = */ NULL,
+            /* double      = */ NULL,
+            /* number      = */ stream_handle_number,
+            /* string      = */ stream_handle_string,
+            /* start map   = */ stream_handle_start_map,
+            /* map key     = */ stream_handle_map_key,
+            /* end map     = */ stream_handle_end,
+            /* start array = */ stream_handle_start_array,
+            /* end array   = */ stream_handle_end
+        };
+
+    yajl_alloc_funcs afsBuffer;
+    stream_t *s;
+
+    if (afs != NULL) {
+        if (afs->malloc == NULL || afs->realloc == NULL || afs->free == NULL)
+        {
+            return NULL;
+        }
+    } else {
+        yajl_set_default_alloc_funcs(&afsBuffer);
+        afs = &afsBuffer;
+    }
+
+    s = YA_MALLOC (afs, sizeof (*s));
+    if (s == NULL) return NULL;
+    memset (s, 0, sizeof (*s));
+
+    s->alloc = *afs;
+    s->ctx.afs = &s->alloc;
+    s->ctx.errbuf = s->errbuf;
+    s->ctx.errbuf_size = sizeof (s->errbuf);
+    s->yield_depth = depth;
+    s->path = path;
+    s->callback = callback;
+    s->callback_ctx = ctx;
+
+    s->handle = yajl_alloc (&callbacks, &s->alloc, s);
+    if (s->handle == NULL)
+    {
+        YA_FREE (&s->alloc, s);
+        return NULL;
+    }
+    yajl_config(s->handle, yajl_allow_comments,
+                (options & yajl_tree_option_allow_comments) != 0);
+    yajl_config(s->handle, yajl_dont_validate_strings,
+                (options & yajl_tree_option_dont_validate_strings) != 0);
+    yajl_config(s->handle, yajl_allow_trailing_garbage,
+                (options & yajl_tree_option_allow_trailing_garbage) != 0);
+    yajl_config(s->handle, yajl_allow_multiple_values,
+                (options & yajl_tree_option_allow_multiple_values) != 0);
+    yajl_config(s->handle, yajl_allow_partial_values,
+                (options & yajl_tree_option_allow_partial_values) != 0);
+
+    return s;
+}
+
+yajl_status yajl_tree_stream_parse (yajl_tree_stream s,
+                                    const unsigned char *text, size_t len)
+{
+    return (yajl_parse (s->handle, text, len));
+}
+
+yajl_status yajl_tree_stream_complete (yajl_tree_stream s)
+{
+    yajl_status status;
+    yajl_val v;
+
+    status = yajl_complete_parse (s->handle);
+    if (status != yajl_status_ok || s->ctx.stack == NULL)
+        return (status);
+
+    /* partial values: close what is open and hand out the element */
+    while (s->ctx.stack->next != NULL)
+    {
+        YA_FREE (&s->alloc, s->ctx.stack->key);
+        s->ctx.stack->key = NULL;
+
+        v = context_pop (&s->ctx);
+        if (context_add_value (&s->ctx, v) != 0)
+        {
+            tree_free (&s->alloc, v);
+            return (yajl_status_error);
+        }
+    }
+    YA_FREE (&s->alloc, s->ctx.stack->key);
+    s->ctx.stack->key = NULL;
+
+    v = context_pop (&s->ctx);
+    s->open = 0;
+    return ((stream_yield (s, v) == STATUS_CONTINUE)
+            ? yajl_status_ok : yajl_status_client_canceled);
+}
+
+unsigned char * yajl_tree_stream_get_error (yajl_tree_stream s, int verbose,
+                                            const unsigned char *text,
+                                            size_t len)
+{
+    unsigned char *str;
+    size_t n;
+
+    if (s->errbuf[0] == 0)
+        return (yajl_get_error (s->handle, verbose, text, len));
+
+    n = strlen (s->errbuf) + 1;
+    str = YA_MALLOC (&s->alloc, n);
+    if (str != NULL) memcpy (str, s->errbuf, n);
+    return (str);
+}
+
+void yajl_tree_stream_free_error (yajl_tree_stream s, unsigned char *str)
+{
+    yajl_free_error (s->handle, str);
+}
+
+void yajl_tree_stream_free (yajl_tree_stream s)
+{
+    if (s == NULL) return;
+
+    context_free (&s->ctx);
+    YA_FREE (&s->alloc, s->key);
+    yajl_free (s->handle);
+    YA_FREE (&s->alloc, s);
+}
+
+/*
+ * Reverse tree builder.  yajl_rev_parse() reports a document from its end:
+ * a container is opened by its closing bracket, members and elements come
+ * last to first, and an object member's value comes before its key.  The
+ * value is kept as "pending" on the stack until the key arrives, and each
+ * container is put back into document order when it is complete.
+ */
+struct rev_context_s
+{
+    context_t ctx;
+    /* nesting level of the elements collected: 0 for a stream of values,
+     * 1 for the elements of a top level array */
+    size_t elem_depth;
+    size_t open;
+    size_t count;
+    int done;
+    /* the top level value is not an array.  It is skipped rather than
+     * reported at once, so that a parse error in it is reported instead */
+    int not_array;
+    /* array of the elements collected, last one first */
+    yajl_val result;
+};
+typedef struct rev_context_s rev_context_t;
+
+static void rev_reverse (yajl_val v)
+{
+    size_t i, j;
+
+    if (YAJL_IS_OBJECT (v))
+    {
+        for (i = 0, j = v->u.object.len; i + 1 < j; i++, j--)
+        {
+            const char *k = v->u.object.keys[i];
+            yajl_val val = v->u.object.values[i];
+
+            v->u.object.keys[i] = v->u.object.keys[j - 1];
+            v->u.object.values[i] = v->u.object.values[j - 1];
+            v->u.object.keys[j - 1] = k;
+            v->u.object.values[j - 1] = val;
+        }
+    }
+    else if (YAJL_IS_ARRAY (v))
+    {
+        for (i = 0, j = v->u.array.len; i + 1 < j; i++, j--)
+        {
+            yajl_val val = v->u.array.values[i];
+
+            v->u.array.values[i] = v->u.array.values[j - 1];
+            v->u.array.values[j - 1] = val;
+        }
     }
 }
+
+static int rev_add_value (rev_context_t *rc, yajl_val v)
+{
+    context_t *ctx = &rc->ctx;
+
+    if (ctx->stack == NULL)
+    {
+        if (array_add_value (ctx, rc->result, v) != 0)
+        {
+            tree_free (ctx->afs, v);
+            return (STATUS_ABORT);
+        }
+        if (rc->result->u.array.len < rc->count)
+            return (STATUS_CONTINUE);
+
+        /* that's all we need, stop the parse */
+        rc->done = 1;
+        return (STATUS_ABORT);
+    }
+
+    if (YAJL_IS_OBJECT (ctx->stack->value))
+    {
+        assert (ctx->stack->pending == NULL);
+        ctx->stack->pending = v;
+        return (STATUS_CONTINUE);
+    }
+
+    if (array_add_value (ctx, ctx->stack->value, v) != 0)
+    {
+        tree_free (ctx->afs, v);
+        return (STATUS_ABORT);
+    }
+    return (STATUS_CONTINUE);
+}
+
+/* is the scalar value that is read now part of an element? */
+static int rev_building (rev_context_t *rc)
+{
+    if (rc->ctx.stack != NULL) return (1);
+    if (rc->open == rc->elem_depth && !rc->not_array) return (1);
+
+    rc->not_array = 1;
+    return (0);
+}
+
+static int rev_handle_string (void *ctx,
+                              const unsigned char *string, size_t string_length)
+{
+    rev_context_t *rc = ctx;
+    yajl_val v;
+
+    if (!rev_building (rc))
+        return (STATUS_CONTINUE);
+
+    v = string_alloc (&rc->ctx, string, string_length);
+    if (v == NULL)
+        return (STATUS_ABORT);
+
+    return (rev_add_value (rc, v));
+}
+
+static int rev_handle_map_key (void *ctx,
+                               const unsigned char *string, size_t string_length)
+{
+    rev_context_t *rc = ctx;
+    stack_elem_t *top = rc->ctx.stack;
+    char *key;
+
+    if (top == NULL)
+        return (STATUS_CONTINUE);
+    assert (top->pending != NULL);
+
+    key = YA_MALLOC (rc->ctx.afs, string_length + 1);
+    if (key == NULL)
+        RETURN_ERROR (&rc->ctx, STATUS_ABORT, "Out of memory");
+    memcpy (key, string, string_length);
+    key[string_length] = 0;
+
+    if (object_add_keyval (&rc->ctx, top->value, key, top->pending) != 0)
+    {
+        YA_FREE (rc->ctx.afs, key);
+        return (STATUS_ABORT);
+    }
+    top->pending = NULL;
+
+    return (STATUS_CONTINUE);
+}
+
+static int rev_handle_number (void *ctx, const char *string,
+                              size_t string_length)
+{
+    rev_context_t *rc = ctx;
+    yajl_val v;
+
+    if (!rev_building (rc))
+        return (STATUS_CONTINUE);
+
+    v = number_alloc (&rc->ctx, string, string_length);
+    if (v == NULL)
+        return (STATUS_ABORT);
+
+    return (rev_add_value (rc, v));
+}
+
+static int rev_handle_boolean (void *ctx, int boolean_value)
+{
+    rev_context_t *rc = ctx;
+    yajl_val v;
+
+    if (!rev_building (rc))
+        return (STATUS_CONTINUE);
+
+    v = value_alloc (&rc->ctx, boolean_value ? yajl_t_true : yajl_t_false);
+    if (v == NULL)
+        RETURN_ERROR (&rc->ctx, STATUS_ABORT, "Out of memory");
+
+    return (rev_add_value (rc, v));
+}
+
+static int rev_handle_null (void *ctx)
+{
+    rev_context_t *rc = ctx;
+    yajl_val v;
+
+    if (!rev_building (rc))
+        return (STATUS_CONTINUE);
+
+    v = value_alloc (&rc->ctx, yajl_t_null);
+    if (v == NULL)
+        RETURN_ERROR (&rc->ctx, STATUS_ABORT, "Out of memory");
+
+    return (rev_add_value (rc, v));
+}
+
+/* the closing bracket of a container, which the reverse parser reads first */
+static int rev_handle_open (rev_context_t *rc, yajl_type type)
+{
+    yajl_val v;
+
+    if (rc->ctx.stack == NULL &&
+        (rc->open < rc->elem_depth || rc->not_array))
+    {
+        if (type != yajl_t_array)
+            rc->not_array = 1;
+        rc->open++;
+        return (STATUS_CONTINUE);
+    }
+
+    v = value_alloc (&rc->ctx, type);
+    if (v == NULL)
+        RETURN_ERROR (&rc->ctx, STATUS_ABORT, "Out of memory");
+
+    if (context_push (&rc->ctx, v) != 0)
+    {
+        tree_free (rc->ctx.afs, v);
+        return (STATUS_ABORT);
+    }
+    rc->open++;
+
+    return (STATUS_CONTINUE);
+}
+
+static int rev_handle_end_map (void *ctx)
+{
+    return (rev_handle_open (ctx, yajl_t_object));
+}
+
+static int rev_handle_end_array (void *ctx)
+{
+    return (rev_handle_open (ctx, yajl_t_array));
+}
+
+/* the opening bracket of a container, the container is complete */
+static int rev_handle_close (void *ctx)
+{
+    rev_context_t *rc = ctx;
+    yajl_val v;
+
+    rc->open--;
+    if (rc->ctx.stack == NULL)
+        return (STATUS_CONTINUE);
+
+    v = context_pop (&rc->ctx);
+    if (v == NULL)
+        return (STATUS_ABORT);
+    rev_reverse (v);
+
+    return (rev_add_value (rc, v));
+}
+
+yajl_val yajl_tree_parse_last (const char *input, size_t input_length,
+                               size_t count, unsigned int options,
+                               char *error_buffer, size_t error_buffer_size)
+{
+    static const yajl_callbacks callbacks =
+        {
+            /* null        = */ rev_handle_null,
+            /* boolean     = */ rev_handle_boolean,
+            /* integer     = */ NULL,
+            /* double      = */ NULL,
+            /* number      = */ rev_handle_number,
+            /* string      = */ rev_handle_string,
+            /* start map   = */ rev_handle_close,
+            /* map key     = */ rev_handle_map_key,
+            /* end map     = */ rev_handle_end_map,
+            /* start array = */ rev_handle_close,
+            /* end array   = */ rev_handle_end_array
+        };
+
+    yajl_alloc_funcs afsBuffer;
+    yajl_handle handle;
+    yajl_status status;
+    char * internal_err_str;
+    rev_context_t rc;
+
+    yajl_set_default_alloc_funcs(&afsBuffer);
+
+    memset (&rc, 0, sizeof (rc));
+    rc.ctx.afs = &afsBuffer;
+    rc.ctx.errbuf = error_buffer;
+    rc.ctx.errbuf_size = error_buffer_size;
+    rc.count = count;
+    rc.elem_depth =
+        (options & yajl_tree_option_allow_multiple_values) ? 0 : 1;
+
+    if (error_buffer != NULL)
+        memset (error_buffer, 0, error_buffer_size);
+
+    rc.result = value_alloc (&rc.ctx, yajl_t_array);
+    if (rc.result == NULL)
+        RETURN_ERROR (&rc.ctx, NULL, "Out of memory");
+    if (count == 0)
+        return (rc.result);
+
+    handle = yajl_alloc (&callbacks, &afsBuffer, &rc);
+    yajl_config(handle, yajl_allow_comments,
+                (options & yajl_tree_option_allow_comments) != 0);
+    yajl_config(handle, yajl_dont_validate_strings,
+                (options & yajl_tree_option_dont_validate_strings) != 0);
+    yajl_config(handle, yajl_allow_trailing_garbage,
+                (options & yajl_tree_option_allow_trailing_garbage) != 0);
+    yajl_config(handle, yajl_allow_multiple_values, rc.elem_depth == 0);
+    yajl_config(handle, yajl_allow_partial_values,
+                (options & yajl_tree_option_allow_partial_values) != 0);
+
+    status = yajl_rev_parse(handle,
+                            (const unsigned char *) input,
+                            input_length);
+    if (status == yajl_status_ok)
+        status = yajl_rev_complete_parse (handle);
+    if (status != yajl_status_ok && !rc.done) {
+        if (error_buffer != NULL && error_buffer_size > 0 &&
+            error_buffer[0] == 0) {
+            internal_err_str = (char *) yajl_get_error(handle, 1,
+                  (const unsigned char *) input,
+                  input_length);
+            snprintf(error_buffer, error_buffer_size, "%s", internal_err_str);
+            YA_FREE(&(handle->alloc), internal_err_str);
+        }
+        yajl_free (handle);
+        context_free (&rc.ctx);
+        tree_free (rc.ctx.afs, rc.result);
+        return NULL;
+    }
+
+    yajl_free (handle);
+    context_free (&rc.ctx);
+
+    if (rc.not_array)
+    {
+        tree_free (rc.ctx.afs, rc.result);
+        RETURN_ERROR (&rc.ctx, NULL, "Top level value is not an array");
+    }
+
+    /* collected last to first */
+    rev_reverse (rc.result);
+    return (rc.result);
+}
@@ -0,0 +1,132 @@
+/* use the arena and pool allocators for trees and parser handles */
+
+#include <yajl/yajl_arena.h>
+#include <yajl/yajl_tree.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+static const char * doc =
+  "{\"name\":\"a string that is long enough to be reallocated\","
+  "\"list\":[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20],"
+  "\"nested\":{\"x\":[true,false,null],\"y\":2.5}}";
+
+static int check_tree(yajl_val v)
+{
+  const char * list[] = { "list", NULL };
+  const char * y[] = { "nested", "y", NULL };
+  yajl_val n;
+
+  CHK(YAJL_IS_OBJECT(v) && v->u.object.len == 3);
+  n = yajl_tree_get(v, list, yajl_t_array);
+  CHK(n != NULL && n->u.array.len == 20);
+  CHK(YAJL_GET_INTEGER(n->u.array.values[19]) == 20);
+  n = yajl_tree_get(v, y, yajl_t_number);
+  CHK(n != NULL && YAJL_GET_DOUBLE(n) == 2.5);
+  return 0;
+}
+
+static size_t backingBytes;
+
+static void * count_malloc(void * ctx, size_t sz)
+{
+  backingBytes += sz;
+  return malloc(sz);
+}
+
+static void * count_realloc(void * ctx, void * p, size_t sz)
+{
+  backingBytes += sz;
+  return realloc(p, sz);
+}
+
+static void count_free(void * ctx, void * p)
+{
+  free(p);
+}
+
+static int check_large(void)
+{
+  yajl_alloc_funcs backing = { count_malloc, count_realloc, count_free, NULL };
+  size_t n = 50000, len = 0, i;
+  char errbuf[128];
+  char * big = malloc(n * 8 + 2);
+  yajl_arena arena;
+  yajl_val v;
+
+  big[len++] = '[';
+  for (i = 0; i < n; i++) len += sprintf(big + len, "%u,", (unsigned) i);
+  big[len - 1] = ']';
+  big[len] = 0;
+
+  /* the arena takes memory in proportion to the tree, as containers grow
+   * geometrically rather than by a block per element */
+  arena = yajl_arena_alloc(&backing, 0);
+  v = yajl_tree_parse_alloc(big, len, 0, 0, 0, yajl_arena_funcs(arena),
+                            errbuf, sizeof(errbuf));
+  CHK(YAJL_IS_ARRAY(v) && v->u.array.len == n);
+  CHK(YAJL_GET_INTEGER(v->u.array.values[n - 1]) == (long long) n - 1);
+  CHK(backingBytes < n * 200);
+  yajl_arena_free(arena);
+  free(big);
+  return 0;
+}
+
+static int check_realloc(const yajl_alloc_funcs * afs)
+{
+  unsigned char * a, * b;
+  size_t i;
+
+  /* grown in place and after another allocation, contents survive */
+  a = afs->malloc(afs->ctx, 10);
+  for (i = 0; i < 10; i++) a[i] = (unsigned char) i;
+  a = afs->realloc(afs->ctx, a, 100);
+  b = afs->malloc(afs->ctx, 7);
+  memset(b, 0xff, 7);
+  a = afs->realloc(afs->ctx, a, 100000);
+  for (i = 0; i < 10; i++) CHK(a[i] == i);
+  afs->free(afs->ctx, b);
+  afs->free(afs->ctx, a);
+  return 0;
+}
+
+int main(void) {
+  char errbuf[128];
+  yajl_arena arena;
+  yajl_pool pool;
+  yajl_val v;
+  int i;
+
+  arena = yajl_arena_alloc(NULL, 256);
+  CHK(arena != NULL);
+  CHK(check_realloc(yajl_arena_funcs(arena)) == 0);
+  for (i = 0; i < 3; i++) {
+    v = yajl_tree_parse_alloc(doc, strlen(doc), 0, 0, 0,
+                              yajl_arena_funcs(arena),
+                              errbuf, sizeof(errbuf));
+    CHK(check_tree(v) == 0);
+    /* the whole tree goes with the reset */
+    yajl_arena_reset(arena);
+  }
+  yajl_arena_free(arena);
+  CHK(check_large() == 0);
+
+  pool = yajl_pool_alloc(NULL);
+  CHK(pool != NULL);
+  CHK(check_realloc(yajl_pool_funcs(pool)) == 0);
+  v = yajl_tree_parse_alloc(doc, strlen(doc), 0, 0, 0,
+                            yajl_pool_funcs(pool), errbuf, sizeof(errbuf));
+  CHK(check_tree(v) == 0);
+  yajl_tree_free_alloc(v, yajl_pool_funcs(pool));
+  yajl_pool_free(pool);
+
+  arena = yajl_arena_thread();
+  if (arena != NULL) {
+    CHK(yajl_arena_thread() == arena);
+    yajl_arena_thread_free();
+  }
+
+  return 0;
+}
@@ -0,0 +1,158 @@
+/* nesting deeper than the state stack holds inline, past several steps of
+ * its allocated part and back out again */
+
+#include <yajl/yajl_parse.h>
+#include <yajl/yajl_gen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+#define DEPTH 600
+
+static char doc[DEPTH * 16];
+static size_t mapEnds, arrayEnds;
+static size_t maxOpen, open;
+
+/* level i is a map when i % 3 == 0, an array otherwise */
+static int is_map(size_t i)
+{
+  return i % 3 == 0;
+}
+
+/* parsing forward the ends come innermost first, and must be of the kind
+ * started at that level.  the reverse parser reports ends before starts */
+static int on_start(void * ctx)
+{
+  if (ctx == NULL && ++open > maxOpen) maxOpen = open;
+  return 1;
+}
+
+static int on_end_map(void * ctx)
+{
+  if (ctx == NULL && !is_map(--open)) return 0;
+  mapEnds++;
+  return 1;
+}
+
+static int on_end_array(void * ctx)
+{
+  if (ctx == NULL && is_map(--open)) return 0;
+  arrayEnds++;
+  return 1;
+}
+
+static yajl_callbacks callbacks = {
+  NULL, NULL, NULL, NULL, NULL, NULL, on_start, NULL, on_end_map,
+  on_start, on_end_array
+};
+
+/* each container holds the next and then a value after it, which is only
+ * accepted if the level it returns to has the right kind */
+static void build(void)
+{
+  size_t len = 0, i;
+
+  for (i = 0; i < DEPTH; i++) {
+    if (is_map(i)) len += sprintf(doc + len, "{\"k\":");
+    else len += sprintf(doc + len, "[");
+  }
+  len += sprintf(doc + len, "0");
+  for (i = DEPTH; i-- > 0; ) {
+    if (is_map(i)) len += sprintf(doc + len, ",\"z\":2}");
+    else len += sprintf(doc + len, ",1]");
+  }
+}
+
+static yajl_status parse(const char * json, int reverse)
+{
+  yajl_handle h = yajl_alloc(&callbacks, NULL, reverse ? doc : NULL);
+  yajl_status s;
+
+  mapEnds = 0;
+  arrayEnds = 0;
+  maxOpen = 0;
+  open = 0;
+  if (reverse) {
+    s = yajl_rev_parse(h, (const unsigned char *) json, strlen(json));
+    if (s == yajl_status_ok) s = yajl_rev_complete_parse(h);
+  } else {
+    s = yajl_parse(h, (const unsigned char *) json, strlen(json));
+    if (s == yajl_status_ok) s = yajl_complete_parse(h);
+  }
+  yajl_free(h);
+  return s;
+}
+
+static int generate(void)
+{
+  yajl_gen g = yajl_gen_alloc(NULL);
+  const unsigned char * out;
+  size_t len, i;
+
+  for (i = 0; i < DEPTH; i++) {
+    if (is_map(i)) {
+      CHK(yajl_gen_map_open(g) == yajl_gen_status_ok);
+      CHK(yajl_gen_string(g, (const unsigned char *) "k", 1)
+          == yajl_gen_status_ok);
+    } else {
+      CHK(yajl_gen_array_open(g) == yajl_gen_status_ok);
+    }
+  }
+  CHK(yajl_gen_integer(g, 0) == yajl_gen_status_ok);
+  for (i = DEPTH; i-- > 0; ) {
+    if (is_map(i)) {
+      CHK(yajl_gen_string(g, (const unsigned char *) "z", 1)
+          == yajl_gen_status_ok);
+      CHK(yajl_gen_integer(g, 2) == yajl_gen_status_ok);
+      CHK(yajl_gen_map_close(g) == yajl_gen_status_ok);
+    } else {
+      CHK(yajl_gen_integer(g, 1) == yajl_gen_status_ok);
+      CHK(yajl_gen_array_close(g) == yajl_gen_status_ok);
+    }
+  }
+  CHK(yajl_gen_get_buf(g, &out, &len) == yajl_gen_status_ok);
+  CHK(len == strlen(doc) && memcmp(out, doc, len) == 0);
+  yajl_gen_free(g);
+  return 0;
+}
+
+int main(void) {
+  yajl_handle h;
+  char * bad;
+  int i;
+
+  build();
+
+  CHK(parse(doc, 0) == yajl_status_ok);
+  CHK(maxOpen == DEPTH && open == 0);
+  CHK(mapEnds == DEPTH / 3 && arrayEnds == DEPTH - DEPTH / 3);
+
+  /* the reverse parser keeps its levels the same way */
+  CHK(parse(doc, 1) == yajl_status_ok);
+  CHK(mapEnds == DEPTH / 3 && arrayEnds == DEPTH - DEPTH / 3);
+
+  /* the allocated part is kept for the next document */
+  h = yajl_alloc(&callbacks, NULL, NULL);
+  for (i = 0; i < 2; i++) {
+    open = 0;
+    CHK(yajl_parse(h, (const unsigned char *) doc, strlen(doc))
+        == yajl_status_ok);
+    CHK(yajl_complete_parse(h) == yajl_status_ok);
+    CHK(open == 0);
+    yajl_reset(h);
+  }
+  yajl_free(h);
+
+  CHK(generate() == 0);
+
+  /* closing the wrong kind deep in the allocated part is an error */
+  bad = malloc(strlen(doc) + 1);
+  strcpy(bad, doc);
+  *strchr(bad, '0') = '}';
+  CHK(parse(bad, 0) == yajl_status_error);
+  free(bad);
+
+  return 0;
+}
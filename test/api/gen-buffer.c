@@ -0,0 +1,61 @@
+/* the generator buffer handed over to the caller, and given to it */
+
+#include <yajl/yajl_gen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+int main(void) {
+  yajl_gen g = yajl_gen_alloc(NULL);
+  unsigned char * out;
+  const unsigned char * buf;
+  size_t len;
+  yajl_stats stats;
+  int i;
+
+  /* a small block to start with, which has to grow */
+  CHK(yajl_gen_config(g, yajl_gen_buffer, (unsigned char *) malloc(8),
+                      (size_t) 8));
+  yajl_gen_array_open(g);
+  for (i = 0; i < 100; i++) yajl_gen_integer(g, i);
+  yajl_gen_array_close(g);
+  CHK(yajl_gen_steal_buf(g, &out, &len) == yajl_gen_status_ok);
+  CHK(len == 291 && out[len] == 0);
+  CHK(strncmp((char *) out, "[0,1,2,", 7) == 0);
+  CHK(strcmp((char *) out + len - 4, ",99]") == 0);
+  free(out);
+
+  /* the generator goes on with an empty buffer */
+  CHK(yajl_gen_get_buf(g, &buf, &len) == yajl_gen_status_ok && len == 0);
+  yajl_gen_reset(g, NULL);
+  yajl_gen_bool(g, 1);
+  CHK(yajl_gen_steal_buf(g, &out, &len) == yajl_gen_status_ok);
+  CHK(len == 4 && strcmp((char *) out, "true") == 0);
+  free(out);
+
+  /* or with nothing generated since */
+  CHK(yajl_gen_steal_buf(g, &out, &len) == yajl_gen_status_ok);
+  CHK(len == 0 && out[0] == 0);
+  free(out);
+
+  /* a larger buffer allocated up front doesn't have to grow */
+  CHK(yajl_gen_config(g, yajl_gen_buffer, NULL, (size_t) 65536));
+  yajl_gen_reset(g, NULL);
+  yajl_gen_array_open(g);
+  for (i = 0; i < 5000; i++) yajl_gen_integer(g, i);
+  yajl_gen_array_close(g);
+  yajl_gen_get_stats(g, &stats);
+  CHK(stats.peakBufCapacity == 65536);
+  yajl_gen_free(g);
+
+  /* no buffer to take with a print callback */
+  g = yajl_gen_alloc(NULL);
+  yajl_gen_config(g, yajl_gen_print_callback, NULL, NULL);
+  CHK(yajl_gen_steal_buf(g, &out, &len) == yajl_gen_no_buf);
+  CHK(!yajl_gen_config(g, yajl_gen_buffer, NULL, (size_t) 64));
+  yajl_gen_free(g);
+
+  return 0;
+}
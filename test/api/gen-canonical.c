@@ -0,0 +1,133 @@
+/* canonical output: the same content gives the same bytes */
+
+#include <yajl/yajl_tree.h>
+#include <yajl/yajl_gen.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+static const char * expect =
+  "{\"a\":[1,-2,0.1,1000,1.2345678901234568e+29,\"a/b\"],"
+  "\"b\":{\"d\":1,\"d\":2,\"x\":true},\"z\":null,\"\xc3\xa9\":\"\"}";
+
+static int canonical(const char * doc, int beautify)
+{
+  yajl_val v = yajl_tree_parse(doc, NULL, 0);
+  yajl_gen g = yajl_gen_alloc(NULL);
+  const unsigned char * buf;
+  size_t len;
+  int rv;
+
+  yajl_gen_config(g, yajl_gen_canonical, 1);
+  yajl_gen_config(g, yajl_gen_beautify, beautify);
+  yajl_gen_config(g, yajl_gen_escape_solidus, 1);
+  rv = v != NULL && yajl_tree_generate(g, v) == yajl_gen_status_ok;
+  yajl_gen_get_buf(g, &buf, &len);
+  rv = rv && len == strlen(expect) && memcmp(buf, expect, len) == 0;
+  if (!rv) fprintf(stderr, "got %.*s\n", (int) len, (const char *) buf);
+  yajl_gen_free(g);
+  yajl_tree_free(v);
+  return rv;
+}
+
+/* the canonical form of the number written as text */
+static int number_text(const char * text, char * out)
+{
+  yajl_val v = yajl_tree_parse(text, NULL, 0);
+  yajl_gen g = yajl_gen_alloc(NULL);
+  const unsigned char * buf;
+  size_t len = 0;
+
+  yajl_gen_config(g, yajl_gen_canonical, 1);
+  if (v != NULL && yajl_tree_generate(g, v) == yajl_gen_status_ok) {
+    yajl_gen_get_buf(g, &buf, &len);
+    memcpy(out, buf, len);
+  }
+  out[len] = 0;
+  yajl_gen_free(g);
+  yajl_tree_free(v);
+  return len > 0;
+}
+
+static int number_is(const char * text, const char * expect)
+{
+  char out[64];
+  if (!number_text(text, out)) return 0;
+  if (strcmp(out, expect) != 0) fprintf(stderr, "%s gave %s\n", text, out);
+  return strcmp(out, expect) == 0;
+}
+
+static int same_number(const char * a, const char * b)
+{
+  char outA[64], outB[64];
+  return number_text(a, outA) && number_text(b, outB) &&
+         strcmp(outA, outB) == 0;
+}
+
+int main(void) {
+  yajl_gen g;
+  const unsigned char * buf;
+  size_t len;
+
+  CHK(canonical(
+    "{\"z\":null,\"b\":{\"x\":true,\"d\":1,\"d\":2},\"\\u00e9\":\"\","
+    "\"a\":[1,-2,0.1,1000,123456789012345678901234567890,\"a/b\"]}", 0));
+  CHK(canonical(
+    "{ \"\xc3\xa9\" : \"\", \"a\" : [ 1.0, -2e0, 1e-1, 1E3,\n"
+    "  1.23456789012345678901234567890e29, \"a\\/b\" ],\n"
+    "  \"z\" : null, \"b\" : { \"d\" : 1, \"x\" : true, \"d\" : 2.00 } }", 1));
+
+  /* numbers are normalized by value, not by how they were written */
+  CHK(same_number("1e17", "100000000000000000"));
+  CHK(same_number("1e18", "1000000000000000000"));
+  CHK(same_number("-9.2233720368547758e18", "-9223372036854775808"));
+  CHK(same_number("1e19", "10000000000000000000"));
+  CHK(same_number("1.5e-7", "0.00000015"));
+  CHK(same_number("0.000001", "1e-6"));
+  CHK(same_number("1e21", "1000000000000000000000"));
+  CHK(same_number("-9223372036854775808", "-9223372036854775808.0"));
+  CHK(number_is("1e17", "100000000000000000"));
+  CHK(number_is("1e19", "10000000000000000000"));
+  CHK(number_is("1.5e-7", "1.5e-7"));
+  CHK(number_is("-0.000001", "-0.000001"));
+  CHK(number_is("1e-7", "1e-7"));
+  CHK(number_is("123.456e5", "12345600"));
+  CHK(number_is("1.25e20", "125000000000000000000"));
+  CHK(number_is("1e21", "1e+21"));
+  CHK(number_is("-1.5e300", "-1.5e+300"));
+  CHK(number_is("5e-324", "5e-324"));
+  CHK(number_is("0.1e1", "1"));
+  CHK(number_is("12.5", "12.5"));
+
+  /* integers are output exactly, also those a double can't hold */
+  CHK(number_is("9007199254740993", "9007199254740993"));
+  CHK(number_is("9223372036854775807", "9223372036854775807"));
+  CHK(number_is("-9223372036854775807", "-9223372036854775807"));
+
+  /* doubles from the streaming routines take the same form */
+  g = yajl_gen_alloc(NULL);
+  yajl_gen_config(g, yajl_gen_canonical, 1);
+  yajl_gen_array_open(g);
+  yajl_gen_double(g, 0.1);
+  yajl_gen_double(g, 1.0);
+  yajl_gen_double(g, -0.0);
+  yajl_gen_double(g, 1e300);
+  yajl_gen_double(g, 1.0 / 3);
+  yajl_gen_double(g, 1e17);
+  yajl_gen_integer(g, 100000000000000000LL);
+  yajl_gen_integer(g, 9007199254740993LL);
+  yajl_gen_integer(g, LLONG_MAX);
+  yajl_gen_array_close(g);
+  yajl_gen_get_buf(g, &buf, &len);
+  CHK(len == strlen("[0.1,1,0,1e+300,0.3333333333333333,"
+                    "100000000000000000,100000000000000000,"
+                    "9007199254740993,9223372036854775807]"));
+  CHK(memcmp(buf, "[0.1,1,0,1e+300,0.3333333333333333,"
+                  "100000000000000000,100000000000000000,"
+                  "9007199254740993,9223372036854775807]", len) == 0);
+  yajl_gen_free(g);
+
+  return 0;
+}
@@ -0,0 +1,68 @@
+/* generator nesting beyond the old fixed limit, and the configured one */
+
+#include <yajl/yajl_gen.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+#define DEEP 1000
+
+static char expect[DEEP * 8];
+
+int main(void) {
+  yajl_gen g = yajl_gen_alloc(NULL);
+  const unsigned char * buf;
+  size_t len;
+  yajl_stats stats;
+  int i;
+
+  /* alternate maps and arrays, so each level has to be remembered */
+  for (i = 0; i < DEEP; i++) {
+    if (i % 2) {
+      CHK(yajl_gen_array_open(g) == yajl_gen_status_ok);
+    } else {
+      CHK(yajl_gen_map_open(g) == yajl_gen_status_ok);
+      CHK(yajl_gen_string(g, (const unsigned char *) "k", 1) == yajl_gen_status_ok);
+    }
+  }
+  CHK(yajl_gen_null(g) == yajl_gen_status_ok);
+  for (i = DEEP - 1; i >= 0; i--) {
+    if (i % 2) {
+      CHK(yajl_gen_integer(g, i) == yajl_gen_status_ok);
+      CHK(yajl_gen_array_close(g) == yajl_gen_status_ok);
+    } else {
+      /* a map may only be closed after a value */
+      CHK(yajl_gen_integer(g, i) == yajl_gen_keys_must_be_strings);
+      CHK(yajl_gen_map_close(g) == yajl_gen_status_ok);
+    }
+  }
+  CHK(yajl_gen_null(g) == yajl_gen_generation_complete);
+
+  /* build what should have come out */
+  expect[0] = 0;
+  for (i = 0; i < DEEP; i++) strcat(expect, i % 2 ? "[" : "{\"k\":");
+  strcat(expect, "null");
+  for (i = DEEP - 1; i >= 0; i--) {
+    if (i % 2) sprintf(expect + strlen(expect), ",%d]", i);
+    else strcat(expect, "}");
+  }
+  yajl_gen_get_buf(g, &buf, &len);
+  CHK(len == strlen(expect) && memcmp(buf, expect, len) == 0);
+  yajl_gen_get_stats(g, &stats);
+  CHK(stats.stackGrows > 0);
+  yajl_gen_free(g);
+
+  /* the configured limit */
+  g = yajl_gen_alloc(NULL);
+  yajl_gen_config(g, yajl_gen_max_depth, (size_t) 2);
+  CHK(yajl_gen_array_open(g) == yajl_gen_status_ok);
+  CHK(yajl_gen_array_open(g) == yajl_gen_status_ok);
+  CHK(yajl_gen_array_open(g) == yajl_max_depth_exceeded);
+  CHK(yajl_gen_array_close(g) == yajl_gen_status_ok);
+  CHK(yajl_gen_array_close(g) == yajl_gen_status_ok);
+  CHK(yajl_gen_array_close(g) == yajl_gen_generation_complete);
+  yajl_gen_free(g);
+
+  return 0;
+}
@@ -0,0 +1,72 @@
+/* beautified output, with the indentation deeper than first prepared and
+ * with other indent strings */
+
+#include <yajl/yajl_gen.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+#define DEEP 40
+
+static char expect[DEEP * DEEP * 16];
+
+static void indent(const char * in, int depth)
+{
+  while (depth-- > 0) strcat(expect, in);
+}
+
+/* nested arrays holding an integer each, and a map at the bottom */
+static int check(const char * in)
+{
+  yajl_gen g = yajl_gen_alloc(NULL);
+  const unsigned char * buf;
+  size_t len;
+  int i, ok;
+
+  yajl_gen_config(g, yajl_gen_beautify, 1);
+  if (in != NULL) yajl_gen_config(g, yajl_gen_indent_string, in);
+  else in = "    ";
+  for (i = 0; i < DEEP; i++) {
+    yajl_gen_array_open(g);
+    yajl_gen_integer(g, i);
+  }
+  yajl_gen_map_open(g);
+  yajl_gen_string(g, (const unsigned char *) "k", 1);
+  yajl_gen_array_open(g);
+  yajl_gen_array_close(g);
+  yajl_gen_map_close(g);
+  for (i = 0; i < DEEP; i++) yajl_gen_array_close(g);
+
+  expect[0] = 0;
+  for (i = 0; i < DEEP; i++) {
+    strcat(expect, "[\n");
+    indent(in, i + 1);
+    sprintf(expect + strlen(expect), "%d,\n", i);
+    indent(in, i + 1);
+  }
+  strcat(expect, "{\n");
+  indent(in, DEEP + 1);
+  strcat(expect, "\"k\": []\n");
+  indent(in, DEEP);
+  strcat(expect, "}");
+  for (i = DEEP - 1; i >= 0; i--) {
+    strcat(expect, "\n");
+    indent(in, i);
+    strcat(expect, "]");
+  }
+  strcat(expect, "\n");
+
+  yajl_gen_get_buf(g, &buf, &len);
+  ok = len == strlen(expect) && memcmp(buf, expect, len) == 0;
+  yajl_gen_free(g);
+  return ok;
+}
+
+int main(void) {
+  CHK(check(NULL));
+  CHK(check("\t"));
+  CHK(check(""));
+  CHK(check("  \t  "));
+  return 0;
+}
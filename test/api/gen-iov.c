@@ -0,0 +1,85 @@
+/* output collected as a list of pieces, long strings referenced in place */
+
+#include <yajl/yajl_gen.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+static char joined[8192];
+
+static size_t join(const yajl_iovec * iov, size_t count)
+{
+  size_t i, len = 0;
+  for (i = 0; i < count; i++) {
+    memcpy(joined + len, iov[i].iov_base, iov[i].iov_len);
+    len += iov[i].iov_len;
+  }
+  return len;
+}
+
+/* the same document into either kind of output */
+static void generate(yajl_gen g, const unsigned char * big, size_t bigLen)
+{
+  int i;
+  yajl_gen_map_open(g);
+  yajl_gen_string(g, (const unsigned char *) "body", 4);
+  yajl_gen_string(g, big, bigLen);
+  yajl_gen_string(g, (const unsigned char *) "list", 4);
+  yajl_gen_array_open(g);
+  for (i = 0; i < 300; i++) yajl_gen_integer(g, i);
+  yajl_gen_array_close(g);
+  yajl_gen_string(g, (const unsigned char *) "raw", 3);
+  yajl_gen_raw_value(g, "{\"pre\": \"rendered\", \"n\": [1, 2, 3]}", 35);
+  yajl_gen_map_close(g);
+}
+
+int main(void) {
+  unsigned char big[2000];
+  const yajl_iovec * iov;
+  const unsigned char * buf;
+  size_t count, len, i;
+  yajl_gen g, plain;
+  int referenced = 0;
+
+  /* a long string with one escape in the middle */
+  memset(big, 'x', sizeof(big));
+  big[1000] = '\n';
+
+  plain = yajl_gen_alloc(NULL);
+  generate(plain, big, sizeof(big));
+  yajl_gen_get_buf(plain, &buf, &len);
+
+  g = yajl_gen_alloc(NULL);
+  CHK(yajl_gen_config(g, yajl_gen_iovec, (size_t) 64));
+  CHK(yajl_gen_get_buf(g, &buf, &count) == yajl_gen_no_buf);
+  generate(g, big, sizeof(big));
+  CHK(yajl_gen_get_iov(g, &iov, &count) == yajl_gen_status_ok);
+
+  /* the same bytes, with both halves of the string left where they are */
+  yajl_gen_get_buf(plain, &buf, &len);
+  CHK(join(iov, count) == len && memcmp(joined, buf, len) == 0);
+  for (i = 0; i < count; i++) {
+    if (iov[i].iov_base == big || iov[i].iov_base == big + 1001) referenced++;
+  }
+  CHK(referenced == 2);
+
+  /* cleared output starts again */
+  yajl_gen_clear(g);
+  yajl_gen_reset(g, NULL);
+  CHK(yajl_gen_integer(g, 5) == yajl_gen_status_ok);
+  CHK(yajl_gen_get_iov(g, &iov, &count) == yajl_gen_status_ok);
+  CHK(join(iov, count) == 1 && joined[0] == '5');
+
+  /* and the buffer can come back */
+  CHK(yajl_gen_config(g, yajl_gen_iovec, (size_t) 0));
+  CHK(yajl_gen_get_iov(g, &iov, &count) == yajl_gen_no_buf);
+  yajl_gen_reset(g, NULL);
+  CHK(yajl_gen_integer(g, 6) == yajl_gen_status_ok);
+  CHK(yajl_gen_get_buf(g, &buf, &len) == yajl_gen_status_ok);
+  CHK(len == 1 && buf[0] == '6');
+
+  yajl_gen_free(g);
+  yajl_gen_free(plain);
+  return 0;
+}
@@ -0,0 +1,44 @@
+/* strings encoded once and generated many times */
+
+#include <yajl/yajl_gen.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+static int output_is(yajl_gen g, const char * expect)
+{
+  const unsigned char * buf;
+  size_t len;
+  yajl_gen_get_buf(g, &buf, &len);
+  return len == strlen(expect) && memcmp(buf, expect, len) == 0;
+}
+
+int main(void) {
+  yajl_gen g = yajl_gen_alloc(NULL);
+  yajl_gen_prepared key, val;
+  int i;
+
+  yajl_gen_config(g, yajl_gen_validate_utf8, 1);
+  key = yajl_gen_prepare_string(g, (const unsigned char *) "k\"1", 3);
+  val = yajl_gen_prepare_string(g, (const unsigned char *) "a/b", 3);
+  CHK(key != NULL && val != NULL);
+  CHK(yajl_gen_prepare_string(g, (const unsigned char *) "\xff", 1) == NULL);
+
+  /* keys and values, with separators as for yajl_gen_string */
+  CHK(yajl_gen_array_open(g) == yajl_gen_status_ok);
+  for (i = 0; i < 2; i++) {
+    CHK(yajl_gen_map_open(g) == yajl_gen_status_ok);
+    CHK(yajl_gen_prepared_string(g, key) == yajl_gen_status_ok);
+    CHK(yajl_gen_prepared_string(g, val) == yajl_gen_status_ok);
+    CHK(yajl_gen_map_close(g) == yajl_gen_status_ok);
+  }
+  CHK(yajl_gen_prepared_string(g, val) == yajl_gen_status_ok);
+  CHK(yajl_gen_array_close(g) == yajl_gen_status_ok);
+  CHK(output_is(g, "[{\"k\\\"1\":\"a/b\"},{\"k\\\"1\":\"a/b\"},\"a/b\"]"));
+
+  yajl_gen_prepared_free(g, key);
+  yajl_gen_prepared_free(g, val);
+  yajl_gen_free(g);
+  return 0;
+}
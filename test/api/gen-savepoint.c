@@ -0,0 +1,156 @@
+/* discard part of the output by returning to a savepoint */
+
+#include <yajl/yajl_gen.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+#define S(s) (const unsigned char *) (s), strlen(s)
+#define DEEP 300
+
+static int output_is(yajl_gen g, const char * expect)
+{
+  const unsigned char * buf;
+  size_t len;
+  yajl_gen_get_buf(g, &buf, &len);
+  return len == strlen(expect) && memcmp(buf, expect, len) == 0;
+}
+
+/* maps and arrays in turn, deep enough to use the heap of the stack */
+static void open_deep(yajl_gen g)
+{
+  int i;
+  for (i = 0; i < DEEP; i++) {
+    if (i % 2) {
+      yajl_gen_array_open(g);
+    } else {
+      yajl_gen_map_open(g);
+      yajl_gen_string(g, S("k"));
+    }
+  }
+}
+
+static void close_deep(yajl_gen g)
+{
+  int i;
+  for (i = DEEP - 1; i >= 0; i--) {
+    if (i % 2) yajl_gen_array_close(g);
+    else yajl_gen_map_close(g);
+  }
+}
+
+static void print(void * ctx, const char * str, size_t len)
+{
+  (void) ctx; (void) str; (void) len;
+}
+
+int main(void) {
+  yajl_gen g = yajl_gen_alloc(NULL);
+  yajl_gen g2;
+  const unsigned char * buf, * buf2;
+  size_t len, len2, sp, sp2;
+  const yajl_iovec * iov;
+  size_t count;
+  unsigned char big[100];
+
+  /* a member given up half way through */
+  yajl_gen_map_open(g);
+  yajl_gen_string(g, S("a"));
+  yajl_gen_integer(g, 1);
+  CHK(yajl_gen_savepoint(g, &sp) == yajl_gen_status_ok);
+  yajl_gen_string(g, S("b"));
+  yajl_gen_array_open(g);
+  yajl_gen_integer(g, 2);
+  yajl_gen_map_open(g);
+  CHK(yajl_gen_rollback(g, sp) == yajl_gen_status_ok);
+  yajl_gen_string(g, S("c"));
+  yajl_gen_bool(g, 1);
+  CHK(yajl_gen_map_close(g) == yajl_gen_status_ok);
+  CHK(output_is(g, "{\"a\":1,\"c\":true}"));
+
+  /* rolling back releases later savepoints, releasing keeps the output */
+  yajl_gen_clear(g);
+  yajl_gen_reset(g, NULL);
+  yajl_gen_array_open(g);
+  CHK(yajl_gen_savepoint(g, &sp) == yajl_gen_status_ok);
+  yajl_gen_integer(g, 1);
+  CHK(yajl_gen_savepoint(g, &sp2) == yajl_gen_status_ok && sp2 == sp + 1);
+  yajl_gen_integer(g, 2);
+  CHK(yajl_gen_release_savepoint(g, sp2) == yajl_gen_status_ok);
+  CHK(yajl_gen_rollback(g, sp2) == yajl_gen_invalid_savepoint);
+  CHK(yajl_gen_savepoint(g, &sp2) == yajl_gen_status_ok);
+  yajl_gen_integer(g, 3);
+  CHK(yajl_gen_rollback(g, sp) == yajl_gen_status_ok);
+  CHK(yajl_gen_rollback(g, sp2) == yajl_gen_invalid_savepoint);
+  yajl_gen_integer(g, 4);
+  yajl_gen_array_close(g);
+  CHK(output_is(g, "[4]"));
+
+  /* an error state is left too */
+  yajl_gen_clear(g);
+  yajl_gen_reset(g, NULL);
+  CHK(yajl_gen_savepoint(g, &sp) == yajl_gen_status_ok);
+  yajl_gen_integer(g, 1);
+  CHK(yajl_gen_integer(g, 2) == yajl_gen_generation_complete);
+  yajl_gen_rollback(g, sp);
+  CHK(yajl_gen_integer(g, 2) == yajl_gen_status_ok);
+  CHK(output_is(g, "2"));
+
+  /* clearing the output drops the savepoints */
+  CHK(yajl_gen_savepoint(g, &sp) == yajl_gen_status_ok);
+  yajl_gen_clear(g);
+  CHK(yajl_gen_rollback(g, sp) == yajl_gen_invalid_savepoint);
+  yajl_gen_free(g);
+
+  /* deep nesting is restored, after closing past the savepoint and
+   * opening other containers */
+  g = yajl_gen_alloc(NULL);
+  g2 = yajl_gen_alloc(NULL);
+  yajl_gen_config(g, yajl_gen_beautify, 1);
+  yajl_gen_config(g2, yajl_gen_beautify, 1);
+  open_deep(g);
+  CHK(yajl_gen_savepoint(g, &sp) == yajl_gen_status_ok);
+  close_deep(g);
+  yajl_gen_reset(g, NULL);
+  yajl_gen_array_open(g);
+  open_deep(g);
+  yajl_gen_null(g);
+  CHK(yajl_gen_rollback(g, sp) == yajl_gen_status_ok);
+  yajl_gen_null(g);
+  close_deep(g);
+  open_deep(g2);
+  yajl_gen_null(g2);
+  close_deep(g2);
+  yajl_gen_get_buf(g, &buf, &len);
+  yajl_gen_get_buf(g2, &buf2, &len2);
+  CHK(len == len2 && memcmp(buf, buf2, len) == 0);
+  yajl_gen_free(g);
+  yajl_gen_free(g2);
+
+  /* pieces collected with yajl_gen_iovec */
+  g = yajl_gen_alloc(NULL);
+  CHK(yajl_gen_config(g, yajl_gen_iovec, (size_t) 32));
+  memset(big, 'x', sizeof(big));
+  yajl_gen_array_open(g);
+  yajl_gen_integer(g, 1);
+  CHK(yajl_gen_savepoint(g, &sp) == yajl_gen_status_ok);
+  yajl_gen_string(g, big, sizeof(big));
+  yajl_gen_integer(g, 2);
+  CHK(yajl_gen_rollback(g, sp) == yajl_gen_status_ok);
+  yajl_gen_integer(g, 3);
+  yajl_gen_array_close(g);
+  CHK(yajl_gen_get_iov(g, &iov, &count) == yajl_gen_status_ok);
+  CHK(count == 2);
+  CHK(iov[0].iov_len == 2 && memcmp(iov[0].iov_base, "[1", 2) == 0);
+  CHK(iov[1].iov_len == 3 && memcmp(iov[1].iov_base, ",3]", 3) == 0);
+  yajl_gen_free(g);
+
+  /* output already printed can't be taken back */
+  g = yajl_gen_alloc(NULL);
+  yajl_gen_config(g, yajl_gen_print_callback, print, NULL);
+  CHK(yajl_gen_savepoint(g, &sp) == yajl_gen_no_buf);
+  yajl_gen_free(g);
+
+  return 0;
+}
@@ -0,0 +1,155 @@
+/* fragments generated apart and spliced into the parent in order */
+
+#include <yajl/yajl_gen.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+#define S(s) (const unsigned char *) (s), strlen(s)
+#define N 100
+#define PARTS 4
+
+static void element(yajl_gen g, int i)
+{
+  yajl_gen_map_open(g);
+  yajl_gen_string(g, S("id"));
+  yajl_gen_integer(g, i);
+  yajl_gen_string(g, S("tags"));
+  yajl_gen_array_open(g);
+  if (i % 3) yajl_gen_string(g, S("odd"));
+  yajl_gen_array_close(g);
+  yajl_gen_map_close(g);
+}
+
+/* the whole document from one generator, or with the array elements and
+ * the members of the second map from fragments */
+static int generate(yajl_gen g, int split)
+{
+  yajl_gen frag[PARTS];
+  const unsigned char * buf;
+  size_t len;
+  int i, p;
+
+  yajl_gen_map_open(g);
+  yajl_gen_string(g, S("items"));
+  yajl_gen_array_open(g);
+  if (split) {
+    for (p = 0; p < PARTS; p++) {
+      frag[p] = yajl_gen_alloc(NULL);
+      CHK(yajl_gen_begin_fragment(frag[p], g) == yajl_gen_status_ok);
+    }
+    /* these could each run on a thread of their own */
+    for (p = 0; p < PARTS; p++) {
+      for (i = p * N / PARTS; i < (p + 1) * N / PARTS; i++) {
+        element(frag[p], i);
+      }
+    }
+    for (p = 0; p < PARTS; p++) {
+      CHK(yajl_gen_splice(g, frag[p]) == yajl_gen_status_ok);
+      yajl_gen_free(frag[p]);
+    }
+    yajl_gen_get_buf(g, &buf, &len);
+    CHK(yajl_gen_get_end_offset(g) == len);
+    CHK(buf[yajl_gen_get_start_offset(g)] == '}');
+  } else {
+    for (i = 0; i < N; i++) element(g, i);
+  }
+  yajl_gen_array_close(g);
+  yajl_gen_string(g, S("more"));
+  yajl_gen_map_open(g);
+  yajl_gen_string(g, S("a"));
+  yajl_gen_integer(g, 1);
+  if (split) {
+    frag[0] = yajl_gen_alloc(NULL);
+    CHK(yajl_gen_begin_fragment(frag[0], g) == yajl_gen_status_ok);
+    yajl_gen_string(frag[0], S("b"));
+    yajl_gen_integer(frag[0], 2);
+    CHK(yajl_gen_splice(g, frag[0]) == yajl_gen_status_ok);
+    /* spliced again, continuing after what was spliced */
+    yajl_gen_string(frag[0], S("c"));
+    yajl_gen_array_open(frag[0]);
+    yajl_gen_array_close(frag[0]);
+    CHK(yajl_gen_splice(g, frag[0]) == yajl_gen_status_ok);
+    CHK(yajl_gen_splice(g, frag[0]) == yajl_gen_status_ok);
+    yajl_gen_free(frag[0]);
+  } else {
+    yajl_gen_string(g, S("b"));
+    yajl_gen_integer(g, 2);
+    yajl_gen_string(g, S("c"));
+    yajl_gen_array_open(g);
+    yajl_gen_array_close(g);
+  }
+  yajl_gen_map_close(g);
+  yajl_gen_map_close(g);
+  return 0;
+}
+
+static int same(int beautify)
+{
+  yajl_gen g1 = yajl_gen_alloc(NULL), g2 = yajl_gen_alloc(NULL);
+  const unsigned char * buf1, * buf2;
+  size_t len1, len2;
+  int rv;
+
+  yajl_gen_config(g1, yajl_gen_beautify, beautify);
+  yajl_gen_config(g2, yajl_gen_beautify, beautify);
+  yajl_gen_config(g2, yajl_gen_indent_string, "\t");
+  yajl_gen_config(g1, yajl_gen_indent_string, "\t");
+  rv = generate(g1, 0) == 0 && generate(g2, 1) == 0;
+  yajl_gen_get_buf(g1, &buf1, &len1);
+  yajl_gen_get_buf(g2, &buf2, &len2);
+  rv = rv && len1 == len2 && memcmp(buf1, buf2, len1) == 0;
+  yajl_gen_free(g1);
+  yajl_gen_free(g2);
+  return rv;
+}
+
+int main(void) {
+  yajl_gen g, frag;
+  const unsigned char * buf;
+  size_t len;
+
+  CHK(same(0));
+  CHK(same(1));
+
+  g = yajl_gen_alloc(NULL);
+  frag = yajl_gen_alloc(NULL);
+  yajl_gen_array_open(g);
+  CHK(yajl_gen_begin_fragment(frag, g) == yajl_gen_status_ok);
+
+  /* a fragment can't leave the level it was begun in */
+  CHK(yajl_gen_array_close(frag) == yajl_gen_generation_complete);
+
+  /* nor be spliced part way through a value */
+  yajl_gen_array_open(frag);
+  CHK(yajl_gen_splice(g, frag) == yajl_gen_fragment_mismatch);
+  yajl_gen_array_close(frag);
+
+  /* nor anywhere else */
+  yajl_gen_map_open(g);
+  CHK(yajl_gen_splice(g, frag) == yajl_gen_fragment_mismatch);
+  yajl_gen_string(g, S("k"));
+  CHK(yajl_gen_begin_fragment(frag, g) == yajl_gen_fragment_mismatch);
+  yajl_gen_integer(g, 1);
+  yajl_gen_map_close(g);
+  CHK(yajl_gen_splice(g, frag) == yajl_gen_status_ok);
+  yajl_gen_array_close(g);
+  yajl_gen_get_buf(g, &buf, &len);
+  CHK(len == 12 && memcmp(buf, "[{\"k\":1},[]]", len) == 0);
+
+  /* a whole document from a plain generator */
+  yajl_gen_free(g);
+  g = yajl_gen_alloc(NULL);
+  yajl_gen_reset(frag, NULL);
+  yajl_gen_clear(frag);
+  yajl_gen_bool(frag, 0);
+  CHK(yajl_gen_splice(g, frag) == yajl_gen_status_ok);
+  CHK(yajl_gen_null(g) == yajl_gen_generation_complete);
+  yajl_gen_get_buf(g, &buf, &len);
+  CHK(len == 5 && memcmp(buf, "false", len) == 0);
+
+  yajl_gen_free(frag);
+  yajl_gen_free(g);
+  return 0;
+}
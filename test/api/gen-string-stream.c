@@ -0,0 +1,90 @@
+/* strings generated in pieces with yajl_gen_string_open/append/close */
+
+#include <yajl/yajl_gen.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+static int output_is(yajl_gen g, const char * expect)
+{
+  const unsigned char * buf;
+  size_t len;
+  yajl_gen_get_buf(g, &buf, &len);
+  return len == strlen(expect) && memcmp(buf, expect, len) == 0;
+}
+
+int main(void) {
+  const unsigned char * s = (const unsigned char *) "caf\xc3\xa9 \xe2\x82\xac\t\"";
+  yajl_gen g;
+  size_t i;
+
+  /* keys and values, escaped as they arrive */
+  g = yajl_gen_alloc(NULL);
+  CHK(yajl_gen_map_open(g) == yajl_gen_status_ok);
+  CHK(yajl_gen_string_open(g) == yajl_gen_status_ok);
+  CHK(yajl_gen_string_append(g, (const unsigned char *) "ke", 2) == yajl_gen_status_ok);
+  CHK(yajl_gen_string_append(g, (const unsigned char *) "y", 1) == yajl_gen_status_ok);
+  CHK(yajl_gen_string_close(g) == yajl_gen_status_ok);
+  CHK(yajl_gen_string_open(g) == yajl_gen_status_ok);
+  CHK(yajl_gen_string_append(g, (const unsigned char *) "a\n", 2) == yajl_gen_status_ok);
+  CHK(yajl_gen_string_append(g, (const unsigned char *) "", 0) == yajl_gen_status_ok);
+  CHK(yajl_gen_string_append(g, (const unsigned char *) "\"b", 2) == yajl_gen_status_ok);
+  CHK(yajl_gen_string_close(g) == yajl_gen_status_ok);
+  CHK(yajl_gen_map_close(g) == yajl_gen_status_ok);
+  CHK(output_is(g, "{\"key\":\"a\\n\\\"b\"}"));
+  yajl_gen_free(g);
+
+  /* nothing else may be generated while a string is open */
+  g = yajl_gen_alloc(NULL);
+  CHK(yajl_gen_string_append(g, s, 1) == yajl_gen_string_unbalanced);
+  CHK(yajl_gen_string_close(g) == yajl_gen_string_unbalanced);
+  CHK(yajl_gen_array_open(g) == yajl_gen_status_ok);
+  CHK(yajl_gen_string_open(g) == yajl_gen_status_ok);
+  CHK(yajl_gen_integer(g, 1) == yajl_gen_string_unbalanced);
+  CHK(yajl_gen_array_close(g) == yajl_gen_string_unbalanced);
+  CHK(yajl_gen_string_close(g) == yajl_gen_status_ok);
+  CHK(yajl_gen_array_close(g) == yajl_gen_status_ok);
+  CHK(output_is(g, "[\"\"]"));
+  yajl_gen_free(g);
+
+  /* validated UTF-8 may be split anywhere */
+  for (i = 0; i <= strlen((const char *) s); i++) {
+    g = yajl_gen_alloc(NULL);
+    yajl_gen_config(g, yajl_gen_validate_utf8, 1);
+    CHK(yajl_gen_string_open(g) == yajl_gen_status_ok);
+    CHK(yajl_gen_string_append(g, s, i) == yajl_gen_status_ok);
+    CHK(yajl_gen_string_append(g, s + i, strlen((const char *) s) - i)
+        == yajl_gen_status_ok);
+    CHK(yajl_gen_string_close(g) == yajl_gen_status_ok);
+    CHK(output_is(g, "\"caf\xc3\xa9 \xe2\x82\xac\\t\\\"\""));
+    yajl_gen_free(g);
+  }
+
+  /* but not left unfinished or broken */
+  g = yajl_gen_alloc(NULL);
+  yajl_gen_config(g, yajl_gen_validate_utf8, 1);
+  CHK(yajl_gen_string_open(g) == yajl_gen_status_ok);
+  CHK(yajl_gen_string_append(g, (const unsigned char *) "\xe2\x82", 2) == yajl_gen_status_ok);
+  CHK(yajl_gen_string_close(g) == yajl_gen_invalid_string);
+  CHK(yajl_gen_string_append(g, (const unsigned char *) "x", 1) == yajl_gen_invalid_string);
+  yajl_gen_free(g);
+
+  /* a character split across pieces and broken in the next one */
+  g = yajl_gen_alloc(NULL);
+  yajl_gen_config(g, yajl_gen_validate_utf8, 1);
+  CHK(yajl_gen_string_open(g) == yajl_gen_status_ok);
+  CHK(yajl_gen_string_append(g, (const unsigned char *) "\xf0", 1) == yajl_gen_status_ok);
+  CHK(yajl_gen_string_append(g, (const unsigned char *) "\x80\x80\xf0\x80\x80\x80\x80", 7) == yajl_gen_invalid_string);
+  yajl_gen_free(g);
+  for (i = 1; i <= 3; i++) {
+    g = yajl_gen_alloc(NULL);
+    yajl_gen_config(g, yajl_gen_validate_utf8, 1);
+    CHK(yajl_gen_string_open(g) == yajl_gen_status_ok);
+    CHK(yajl_gen_string_append(g, (const unsigned char *) "\xf0\x9f\x98", i) == yajl_gen_status_ok);
+    CHK(yajl_gen_string_append(g, (const unsigned char *) "a", 1) == yajl_gen_invalid_string);
+    yajl_gen_free(g);
+  }
+
+  return 0;
+}
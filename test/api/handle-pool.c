@@ -0,0 +1,106 @@
+/* handles reused through yajl_reset() and a handle pool */
+
+#include <yajl/yajl_parse.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+static size_t allocs;
+static long long sum;
+
+static void * count_malloc(void * ctx, size_t sz)
+{
+  allocs++;
+  return malloc(sz);
+}
+
+static void * count_realloc(void * ctx, void * p, size_t sz)
+{
+  allocs++;
+  return realloc(p, sz);
+}
+
+static void count_free(void * ctx, void * p)
+{
+  free(p);
+}
+
+static int on_integer(void * ctx, long long i)
+{
+  sum += i;
+  return 1;
+}
+
+static yajl_callbacks callbacks = {
+  NULL, NULL, on_integer, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
+};
+
+static yajl_status parse(yajl_handle h, const char * json)
+{
+  yajl_status s;
+
+  sum = 0;
+  s = yajl_parse(h, (const unsigned char *) json, strlen(json));
+  if (s == yajl_status_ok) s = yajl_complete_parse(h);
+  return s;
+}
+
+int main(void) {
+  yajl_alloc_funcs afs = { count_malloc, count_realloc, count_free, NULL };
+  const char * doc = "[1,{\"a\":[2,\"a string that is long enough\"]},3]";
+  const char * commented = "/* c */ [[[4]]]";
+  yajl_handle_pool pool;
+  yajl_handle h, h2;
+  size_t before;
+
+  /* a reset handle parses the next document the same way, options kept,
+   * without allocating */
+  h = yajl_alloc(&callbacks, &afs, NULL);
+  yajl_config(h, yajl_allow_comments, 1);
+  CHK(parse(h, commented) == yajl_status_ok && sum == 4);
+  CHK(parse(h, doc) == yajl_status_error);
+  yajl_reset(h);
+  CHK(parse(h, doc) == yajl_status_ok && sum == 6);
+  before = allocs;
+  yajl_reset(h);
+  CHK(parse(h, doc) == yajl_status_ok && sum == 6);
+  yajl_reset(h);
+  CHK(parse(h, commented) == yajl_status_ok && sum == 4);
+  CHK(allocs == before);
+  yajl_free(h);
+
+  /* a pooled handle comes back with no options or limits */
+  pool = yajl_handle_pool_alloc(&callbacks, &afs, 1);
+  h = yajl_handle_pool_get(pool, NULL);
+  CHK(parse(h, doc) == yajl_status_ok && sum == 6);
+  yajl_reset(h);
+  yajl_config(h, yajl_allow_comments, 1);
+  yajl_config(h, yajl_max_depth, (size_t) 2);
+  CHK(parse(h, commented) == yajl_status_max_depth_exceeded);
+  yajl_handle_pool_put(pool, h);
+
+  before = allocs;
+  h2 = yajl_handle_pool_get(pool, NULL);
+  CHK(h2 == h);
+  CHK(parse(h2, commented) == yajl_status_error);
+  yajl_handle_pool_put(pool, h2);
+  h2 = yajl_handle_pool_get(pool, NULL);
+  CHK(parse(h2, "[[[4]]]") == yajl_status_ok && sum == 4);
+  yajl_handle_pool_put(pool, h2);
+  h2 = yajl_handle_pool_get(pool, NULL);
+  CHK(parse(h2, doc) == yajl_status_ok && sum == 6);
+  CHK(allocs == before);
+
+  /* with no idle handle left one is allocated, and one too many for the
+   * pool is freed */
+  h = yajl_handle_pool_get(pool, NULL);
+  CHK(h != h2 && allocs > before);
+  CHK(parse(h, doc) == yajl_status_ok && sum == 6);
+  yajl_handle_pool_put(pool, h);
+  yajl_handle_pool_put(pool, h2);
+  yajl_handle_pool_free(pool);
+
+  return 0;
+}
@@ -0,0 +1,67 @@
+/* strings with escapes decoded within a writable input buffer */
+
+#include <yajl/yajl_parse.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+static const unsigned char * ptrs[8];
+static size_t lens[8];
+static int count;
+
+static int on_string(void * ctx, const unsigned char * s, size_t len)
+{
+  ptrs[count] = s;
+  lens[count++] = len;
+  return 1;
+}
+
+static yajl_callbacks callbacks = {
+  NULL, NULL, NULL, NULL, NULL, on_string, NULL, on_string, NULL, NULL,
+  NULL
+};
+
+static int parse(unsigned char * json, size_t chunkSize)
+{
+  yajl_handle h = yajl_alloc(&callbacks, NULL, NULL);
+  size_t len = strlen((const char *) json), pos;
+  yajl_status s = yajl_status_ok;
+
+  count = 0;
+  yajl_config(h, yajl_allow_in_place_decode, 1);
+  for (pos = 0; pos < len && s == yajl_status_ok; pos += chunkSize) {
+    size_t n = len - pos < chunkSize ? len - pos : chunkSize;
+    s = yajl_parse(h, json + pos, n);
+  }
+  if (s == yajl_status_ok) s = yajl_complete_parse(h);
+  yajl_free(h);
+  return s == yajl_status_ok;
+}
+
+static int inside(const unsigned char * p, const unsigned char * json)
+{
+  return p >= json && p < json + strlen((const char *) json);
+}
+
+int main(void) {
+  unsigned char json[64];
+  int i;
+
+  /* the results stay valid after the parse, in the input */
+  strcpy((char *) json, "{\"k\\ty\":[\"a\\\"b\",\"\\u00e9\\ud83d\\ude00\",\"pl\"]}");
+  CHK(parse(json, sizeof(json)));
+  CHK(count == 4);
+  for (i = 0; i < count; i++) CHK(inside(ptrs[i], json));
+  CHK(lens[0] == 3 && memcmp(ptrs[0], "k\ty", 3) == 0);
+  CHK(lens[1] == 3 && memcmp(ptrs[1], "a\"b", 3) == 0);
+  CHK(lens[2] == 6 && memcmp(ptrs[2], "\xc3\xa9\xf0\x9f\x98\x80", 6) == 0);
+  CHK(lens[3] == 2 && memcmp(ptrs[3], "pl", 2) == 0);
+
+  /* a string split between chunks is decoded into a buffer instead */
+  strcpy((char *) json, "[\"x\\ny\"]");
+  CHK(parse(json, 4));
+  CHK(count == 1 && !inside(ptrs[0], json));
+
+  return 0;
+}
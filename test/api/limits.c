@@ -0,0 +1,56 @@
+/* the depth, token length and input size limits of a parser handle */
+
+#include <yajl/yajl_parse.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+static yajl_status parse(yajl_option opt, size_t limit, int reverse,
+                         const char * s1, const char * s2)
+{
+  yajl_handle h = yajl_alloc(NULL, NULL, NULL);
+  yajl_status s;
+
+  yajl_config(h, opt, limit);
+  if (reverse) {
+    s = yajl_rev_parse(h, (const unsigned char *) s2, strlen(s2));
+    if (s == yajl_status_ok)
+      s = yajl_rev_parse(h, (const unsigned char *) s1, strlen(s1));
+    if (s == yajl_status_ok) s = yajl_rev_complete_parse(h);
+  } else {
+    s = yajl_parse(h, (const unsigned char *) s1, strlen(s1));
+    if (s == yajl_status_ok)
+      s = yajl_parse(h, (const unsigned char *) s2, strlen(s2));
+    if (s == yajl_status_ok) s = yajl_complete_parse(h);
+  }
+  yajl_free(h);
+  return s;
+}
+
+int main(void) {
+  int r;
+
+  for (r = 0; r < 2; r++) {
+    /* nesting depth */
+    CHK(parse(yajl_max_depth, 3, r, "[{\"a\":", "[1]}]") == yajl_status_ok);
+    CHK(parse(yajl_max_depth, 2, r, "[{\"a\":", "[1]}]") ==
+        yajl_status_max_depth_exceeded);
+
+    /* a token split over two chunks is measured as a whole */
+    CHK(parse(yajl_max_token_length, 8, r, "[\"abc", "def\"]") ==
+        yajl_status_ok);
+    CHK(parse(yajl_max_token_length, 7, r, "[\"abc", "def\"]") ==
+        yajl_status_max_token_length_exceeded);
+    CHK(parse(yajl_max_token_length, 3, r, "[123", "45]") ==
+        yajl_status_max_token_length_exceeded);
+
+    /* total input */
+    CHK(parse(yajl_max_total_bytes, 10, r, "[1,2,", "3,4]") ==
+        yajl_status_ok);
+    CHK(parse(yajl_max_total_bytes, 8, r, "[1,2,", "3,4]") ==
+        yajl_status_max_bytes_exceeded);
+  }
+
+  return 0;
+}
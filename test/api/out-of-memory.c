@@ -0,0 +1,88 @@
+/* allocation failures are reported, not crashed on */
+
+#include <yajl/yajl_parse.h>
+#include <yajl/yajl_gen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+/* fails once "budget" calls have been made */
+static int budget;
+
+static void * capped_malloc(void * ctx, size_t sz)
+{
+  if (budget-- <= 0) return NULL;
+  return malloc(sz);
+}
+
+static void * capped_realloc(void * ctx, void * ptr, size_t sz)
+{
+  if (budget-- <= 0) return NULL;
+  return realloc(ptr, sz);
+}
+
+static void capped_free(void * ctx, void * ptr)
+{
+  free(ptr);
+}
+
+static yajl_alloc_funcs capped = {
+  capped_malloc, capped_realloc, capped_free, NULL
+};
+
+int main(void) {
+  static const char chunk1[] = "[\"a long string with \\u00e9scapes that";
+  static const char chunk2[] = " spans two chunks\", [[[[1.5]]]], true]";
+  int n, ok = 0;
+
+  for (n = 0; n < 32; n++) {
+    yajl_handle h;
+    yajl_status s;
+
+    budget = n;
+    h = yajl_alloc(NULL, &capped, NULL);
+    if (h == NULL) continue;
+
+    s = yajl_parse(h, (const unsigned char *) chunk1, strlen(chunk1));
+    if (s == yajl_status_ok)
+      s = yajl_parse(h, (const unsigned char *) chunk2, strlen(chunk2));
+    if (s == yajl_status_ok)
+      s = yajl_complete_parse(h);
+    CHK(s == yajl_status_ok || s == yajl_status_out_of_memory);
+    if (s == yajl_status_ok) ok++;
+    else {
+      unsigned char * e = yajl_get_error(h, 0, NULL, 0);
+      if (e) {
+        CHK(strstr((char *) e, "out of memory") != NULL);
+        yajl_free_error(h, e);
+      }
+    }
+    yajl_free(h);
+  }
+  CHK(ok > 0);
+
+  for (n = 0, ok = 0; n < 8; n++) {
+    yajl_gen g;
+    yajl_gen_status s = yajl_gen_status_ok;
+    int i;
+
+    budget = n;
+    g = yajl_gen_alloc(&capped);
+    if (g == NULL) continue;
+
+    s = yajl_gen_array_open(g);
+    for (i = 0; i < 1000 && s == yajl_gen_status_ok; i++)
+      s = yajl_gen_string(g, (const unsigned char *) "0123456789", 10);
+    if (s == yajl_gen_status_ok)
+      s = yajl_gen_array_close(g);
+    CHK(s == yajl_gen_status_ok || s == yajl_gen_out_of_memory);
+    if (s == yajl_gen_status_ok) ok++;
+    else CHK(yajl_gen_null(g) == yajl_gen_in_error_state);
+    yajl_gen_free(g);
+  }
+  CHK(ok > 0);
+
+  return 0;
+}
@@ -0,0 +1,143 @@
+/* content hashes of maps and arrays worked out while parsing */
+
+#include <yajl/yajl_parse.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+static yajl_handle handle;
+static unsigned long long hashes[16];
+static size_t count;
+
+static int on_end(void * ctx)
+{
+  if (count < sizeof(hashes) / sizeof(hashes[0])) {
+    hashes[count++] = yajl_get_container_hash(handle);
+  }
+  return 1;
+}
+
+static int on_segment(void * ctx, const unsigned char * s, size_t len)
+{
+  return 1;
+}
+
+static int on_mark(void * ctx)
+{
+  return 1;
+}
+
+static int on_string(void * ctx, const unsigned char * s, size_t len)
+{
+  /* decoded before it is hashed, not after */
+  return len == 0 || memchr(s, '\\', len) == NULL;
+}
+
+static yajl_callbacks callbacks = {
+  NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, on_end, NULL, on_end
+};
+
+static yajl_callbacks decoding = {
+  NULL, NULL, NULL, NULL, NULL, on_string, NULL, on_string, on_end, NULL,
+  on_end
+};
+
+/* how hash() parses */
+#define STREAM 1
+#define DECODE 2
+#define IN_PLACE 4
+
+static const yajl_string_callbacks streamed = {
+  on_mark, on_segment, on_mark, on_mark, on_segment, on_mark
+};
+
+/* the hash of the outermost container, or 0 on a parse error */
+static unsigned long long hash(const char * json, size_t chunkSize,
+                               int mode)
+{
+  size_t len = strlen(json), pos;
+  unsigned char * text = malloc(len + 1);
+  yajl_status s = yajl_status_ok;
+
+  memcpy(text, json, len + 1);
+  handle = yajl_alloc(mode & DECODE ? &decoding : &callbacks, NULL, NULL);
+  count = 0;
+  yajl_config(handle, yajl_hash_containers, 1);
+  if (mode & STREAM) yajl_config(handle, yajl_stream_strings, &streamed);
+  if (mode & IN_PLACE) yajl_config(handle, yajl_allow_in_place_decode, 1);
+  for (pos = 0; pos < len && s == yajl_status_ok; pos += chunkSize) {
+    size_t n = len - pos < chunkSize ? len - pos : chunkSize;
+    s = yajl_parse(handle, text + pos, n);
+  }
+  if (s == yajl_status_ok) s = yajl_complete_parse(handle);
+  yajl_free(handle);
+  free(text);
+  return s == yajl_status_ok && count > 0 ? hashes[count - 1] : 0;
+}
+
+int main(void) {
+  const char * doc =
+    "{\"name\":\"A b\",\"tags\":[1,2.5,true,null],\"sub\":{\"x\":{}}}";
+  const char * escaped =
+    " { \"sub\" : {\"x\":{ }} , \"tags\":[ 1.0, 25e-1, true, null ],"
+    "\"n\\u0061me\":\"\\u0041 b\" } ";
+  unsigned long long h = hash(doc, 1024, 0);
+  size_t chunk;
+
+  CHK(h != 0);
+
+  /* whitespace, member order, escapes and the spelling of numbers don't
+   * matter */
+  CHK(hash(escaped, 1024, 0) == h);
+
+  /* nor do chunk boundaries or streaming strings */
+  for (chunk = 1; chunk <= strlen(doc); chunk++) {
+    CHK(hash(doc, chunk, 0) == h);
+    CHK(hash(doc, chunk, STREAM) == h);
+  }
+
+  /* nor whether the strings with escapes are decoded for a callback,
+   * within the text or not */
+  CHK(hash(escaped, 1024, DECODE) == h);
+  CHK(hash(escaped, 1024, DECODE | IN_PLACE) == h);
+  CHK(hash(escaped, 7, DECODE | IN_PLACE) == h);
+  CHK(hash(escaped, 1024, IN_PLACE) == h);
+
+  /* the content does, and so does the order of array elements */
+  CHK(hash("{\"name\":\"A c\",\"tags\":[1,2.5,true,null],\"sub\":{\"x\":{}}}",
+           1024, 0) != h);
+  CHK(hash("{\"name\":\"A b\",\"tags\":[2.5,1,true,null],\"sub\":{\"x\":{}}}",
+           1024, 0) != h);
+  CHK(hash("[1,2]", 1024, 0) != hash("[2,1]", 1024, 0));
+  CHK(hash("[1]", 1024, 0) != hash("[\"1\"]", 1024, 0));
+  CHK(hash("[[]]", 1024, 0) != hash("[{}]", 1024, 0));
+  CHK(hash("{\"a\":\"b\"}", 1024, 0) != hash("{\"b\":\"a\"}", 1024, 0));
+  CHK(hash("[1e0]", 1024, 0) == hash("[1]", 1024, 0));
+  CHK(hash("[1e17]", 1024, 0) == hash("[100000000000000000]", 1024, 0));
+  CHK(hash("[1e19]", 1024, 0) == hash("[10000000000000000000]", 1024, 0));
+  CHK(hash("[-0.0]", 1024, 0) == hash("[0]", 1024, 0));
+  CHK(hash("[9007199254740993]", 1024, 0) !=
+      hash("[9007199254740992]", 1024, 0));
+  CHK(hash("[9223372036854775807]", 1024, 0) !=
+      hash("[9223372036854775806]", 1024, 0));
+  CHK(hash("[-9223372036854775808]", 1024, 0) ==
+      hash("[-9223372036854775808.0]", 1024, 0));
+  CHK(hash("[1e17]", 1024, 0) != hash("[100000000000000016]", 1024, 0));
+  CHK(hash("[0.1]", 1024, 0) != hash("[0.2]", 1024, 0));
+
+  /* equal containers hash the same wherever they are nested */
+  hash("[[3,{\"k\":[]}],{\"y\":[3,{\"k\":[]}]}]", 1024, 0);
+  CHK(count == 8);
+  CHK(hashes[2] == hashes[5]);
+
+  /* the option is refused inside a container */
+  handle = yajl_alloc(&callbacks, NULL, NULL);
+  CHK(yajl_parse(handle, (const unsigned char *) "[1,", 3)
+      == yajl_status_ok);
+  CHK(!yajl_config(handle, yajl_hash_containers, 1));
+  yajl_free(handle);
+
+  return 0;
+}
@@ -0,0 +1,153 @@
+/* a parse loop instantiated outside the library with fixed callbacks,
+ * from the installed template, against yajl_parse and the general loop */
+
+#include <yajl/yajl_parse.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+/* the callbacks log what they see, and cancel at a "stop" string */
+typedef struct {
+  char log[2048];
+  size_t len;
+} events;
+
+static void add(void * ctx, const char * what, const void * s, size_t len)
+{
+  events * e = (events *) ctx;
+  size_t n = strlen(what);
+
+  if (e->len + n + len + 2 >= sizeof(e->log)) return;
+  memcpy(e->log + e->len, what, n);
+  e->len += n;
+  memcpy(e->log + e->len, s, len);
+  e->len += len;
+  e->log[e->len++] = ' ';
+  e->log[e->len] = 0;
+}
+
+static int on_null(void * ctx) { add(ctx, "null", "", 0); return 1; }
+static int on_boolean(void * ctx, int b)
+{
+  add(ctx, b ? "true" : "false", "", 0);
+  return 1;
+}
+static int on_number(void * ctx, const char * s, size_t len)
+{
+  add(ctx, "#", s, len);
+  return 1;
+}
+static int on_string(void * ctx, const unsigned char * s, size_t len)
+{
+  add(ctx, "s:", s, len);
+  return len != 4 || memcmp(s, "stop", 4) != 0;
+}
+static int on_start_map(void * ctx) { add(ctx, "{", "", 0); return 1; }
+static int on_map_key(void * ctx, const unsigned char * s, size_t len)
+{
+  add(ctx, "k:", s, len);
+  return 1;
+}
+static int on_end_map(void * ctx) { add(ctx, "}", "", 0); return 1; }
+static int on_start_array(void * ctx) { add(ctx, "[", "", 0); return 1; }
+static int on_end_array(void * ctx) { add(ctx, "]", "", 0); return 1; }
+
+static const yajl_callbacks callbacks = {
+  on_null, on_boolean, NULL, NULL, on_number, on_string, on_start_map,
+  on_map_key, on_end_map, on_start_array, on_end_array
+};
+
+#define YAJL_PARSER_NAME fixed_do_parse
+#define YAJL_PARSER_CALLBACKS callbacks
+#include <yajl/parse_loop/yajl_parser_tmpl.h>
+
+/* parse json in chunks with the fixed loop or with yajl_parse, leaving
+ * the events in e and the error message, if any, in err */
+static yajl_status run(const char * json, size_t chunkSize, int fixed,
+                       int multiple, events * e, char * err)
+{
+  yajl_handle h = yajl_alloc(&callbacks, NULL, e);
+  size_t len = strlen(json), pos;
+  yajl_status st = yajl_status_ok;
+  const unsigned char * text = (const unsigned char *) json;
+
+  e->len = 0;
+  e->log[0] = 0;
+  err[0] = 0;
+  yajl_config(h, yajl_allow_comments, 1);
+  yajl_config(h, yajl_allow_multiple_values, multiple);
+  for (pos = 0; pos < len && st == yajl_status_ok; pos += chunkSize) {
+    size_t n = len - pos < chunkSize ? len - pos : chunkSize;
+    if (fixed) {
+      st = yajl_parse_prepare(h, n, 0);
+      if (st == yajl_status_ok) st = fixed_do_parse(h, text + pos, n);
+    } else {
+      st = yajl_parse(h, text + pos, n);
+    }
+  }
+  if (st == yajl_status_ok) {
+    if (fixed) {
+      st = yajl_parse_prepare(h, 0, 0);
+      if (st == yajl_status_ok) {
+        st = fixed_do_parse(h, (const unsigned char *) " ", 1);
+        st = yajl_finish_status(h, st);
+      }
+    } else {
+      st = yajl_complete_parse(h);
+    }
+  }
+  if (st != yajl_status_ok) {
+    unsigned char * str = yajl_get_error(h, 0, NULL, 0);
+    strcpy(err, (const char *) str);
+    yajl_free_error(h, str);
+  }
+  yajl_free(h);
+  return st;
+}
+
+/* 1 if both loops give the same events, status and error for json */
+static int same(const char * json, int multiple)
+{
+  events fixed, general;
+  char fixedErr[256], generalErr[256];
+  size_t chunk;
+
+  for (chunk = 1; chunk <= strlen(json); chunk++) {
+    yajl_status a = run(json, chunk, 1, multiple, &fixed, fixedErr);
+    yajl_status b = run(json, chunk, 0, multiple, &general, generalErr);
+    if (a != b || strcmp(fixed.log, general.log) != 0 ||
+        strcmp(fixedErr, generalErr) != 0)
+    {
+      fprintf(stderr, "%s in chunks of %u:\n  %d %s%s\n  %d %s%s\n", json,
+              (unsigned) chunk, a, fixed.log, fixedErr, b, general.log,
+              generalErr);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+int main(void) {
+  events e;
+  char err[256];
+
+  CHK(run("{\"a\":[1,2.5e3,true,null,\"x\\ny\"],\"b\":{}}", 1024, 1, 0,
+          &e, err) == yajl_status_ok);
+  CHK(strcmp(e.log, "{ k:a [ #1 #2.5e3 true null s:x\ny ] k:b { } } ") == 0);
+
+  CHK(same("{\"a\":[1,2.5e3,true,null,\"x\\ny\"],\"b\":{}}", 0));
+  CHK(same("[\"caf\\u00e9\", {\"k\\\"ey\": -0.5}, [[[]]], false]", 0));
+  CHK(same("/* c */ [1, // d\n 2]", 0));
+  CHK(same("1 \"two\" [3] {\"four\":4}", 1));
+
+  /* errors, a truncated document and a cancelled parse */
+  CHK(same("[1,2", 0));
+  CHK(same("{\"a\" 1}", 0));
+  CHK(same("[1,]", 0));
+  CHK(same("[tru]", 0));
+  CHK(same("1 2", 0));
+  CHK(same("[\"go\",\"stop\",\"never\"]", 0));
+
+  return 0;
+}
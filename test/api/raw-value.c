@@ -0,0 +1,139 @@
+/* values captured as text by the parser and spliced into a generator */
+
+#include <yajl/yajl_parse.h>
+#include <yajl/yajl_gen.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+static const char * json =
+  "{\"id\": 7, \"payload\": {\"a\": [1, {\"b\": \"x\\\"y\"}], \"c\": null},"
+  " \"tag\": \"t\", \"n\": -1.5e3}";
+
+static const char * expect =
+  "{\"id\":7,\"payload\":{\"a\": [1, {\"b\": \"x\\\"y\"}], \"c\": null},"
+  "\"tag\":\"t\",\"n\":-1.5e3}";
+
+static yajl_handle h;
+static yajl_gen g;
+static size_t starts[4], ends[4];
+static int found, events;
+
+static int on_raw(void * ctx, const unsigned char * text, size_t start,
+                  size_t end)
+{
+  starts[found] = start;
+  ends[found++] = end;
+  if (text != NULL) {
+    /* the text agrees with the offsets */
+    if (memcmp(text, json + start, end - start) != 0) return 0;
+    yajl_gen_raw_value(g, (const char *) text, end - start);
+  } else {
+    yajl_gen_raw_value(g, json + start, end - start);
+  }
+  return 1;
+}
+
+static int on_key(void * ctx, const unsigned char * s, size_t len)
+{
+  events++;
+  yajl_gen_string(g, s, len);
+  if ((len == 7 && memcmp(s, "payload", 7) == 0) ||
+      (len == 1 && *s == 'n'))
+  {
+    yajl_capture_raw_value(h, on_raw);
+  }
+  return 1;
+}
+
+static int on_string(void * ctx, const unsigned char * s, size_t len)
+{
+  events++;
+  return yajl_gen_string(g, s, len) == yajl_gen_status_ok;
+}
+
+static int on_number(void * ctx, const char * s, size_t len)
+{
+  events++;
+  return yajl_gen_number(g, s, len) == yajl_gen_status_ok;
+}
+
+static int on_null(void * ctx)
+{
+  events++;
+  return yajl_gen_null(g) == yajl_gen_status_ok;
+}
+
+static int on_start_map(void * ctx)
+{
+  events++;
+  return yajl_gen_map_open(g) == yajl_gen_status_ok;
+}
+
+static int on_end_map(void * ctx)
+{
+  events++;
+  return yajl_gen_map_close(g) == yajl_gen_status_ok;
+}
+
+static int on_start_array(void * ctx)
+{
+  events++;
+  return yajl_gen_array_open(g) == yajl_gen_status_ok;
+}
+
+static int on_end_array(void * ctx)
+{
+  events++;
+  return yajl_gen_array_close(g) == yajl_gen_status_ok;
+}
+
+static yajl_callbacks callbacks = {
+  on_null, NULL, NULL, NULL, on_number, on_string, on_start_map, on_key,
+  on_end_map, on_start_array, on_end_array
+};
+
+static int proxy(size_t chunkSize)
+{
+  size_t len = strlen(json), pos;
+  yajl_status s = yajl_status_ok;
+  const unsigned char * out;
+  size_t outLen;
+  int ok;
+
+  h = yajl_alloc(&callbacks, NULL, NULL);
+  g = yajl_gen_alloc(NULL);
+  found = events = 0;
+  for (pos = 0; pos < len && s == yajl_status_ok; pos += chunkSize) {
+    size_t n = len - pos < chunkSize ? len - pos : chunkSize;
+    s = yajl_parse(h, (const unsigned char *) json + pos, n);
+  }
+  if (s == yajl_status_ok) s = yajl_complete_parse(h);
+  yajl_gen_get_buf(g, &out, &outLen);
+  ok = s == yajl_status_ok && found == 2 &&
+    outLen == strlen(expect) && memcmp(out, expect, outLen) == 0;
+  yajl_gen_free(g);
+  yajl_free(h);
+  return ok;
+}
+
+int main(void) {
+  size_t chunk;
+
+  /* the same spans, however the input is split */
+  for (chunk = 1; chunk <= strlen(json); chunk++) {
+    CHK(proxy(chunk));
+    CHK(events == 8);
+    CHK(starts[0] == 21 && ends[0] == 57);
+    CHK(starts[1] == 76 && ends[1] == 82);
+  }
+
+  /* only one value is captured at a time */
+  h = yajl_alloc(&callbacks, NULL, NULL);
+  CHK(yajl_capture_raw_value(h, on_raw));
+  CHK(!yajl_capture_raw_value(h, on_raw));
+  yajl_free(h);
+
+  return 0;
+}
@@ -0,0 +1,104 @@
+/* chunks retained by the client until released, and strings handed out
+ * in pieces */
+
+#include <yajl/yajl_parse.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+static char out[256];
+static int released;
+
+static void append(const char * s, size_t len)
+{
+  size_t used = strlen(out);
+  memcpy(out + used, s, len);
+  out[used + len] = 0;
+}
+
+static int on_string(void * ctx, const unsigned char * s, size_t len)
+{
+  append("s:", 2); append((const char *) s, len); append(" ", 1);
+  return 1;
+}
+
+static int on_key(void * ctx, const unsigned char * s, size_t len)
+{
+  append("k:", 2); append((const char *) s, len); append(" ", 1);
+  return 1;
+}
+
+static int on_number(void * ctx, const char * s, size_t len)
+{
+  append("n:", 2); append(s, len); append(" ", 1);
+  return 1;
+}
+
+static int on_segments(void * ctx, int isKey, const yajl_segment * segs,
+                       size_t count)
+{
+  size_t i;
+  append(isKey ? "K" : "S", 1);
+  for (i = 0; i < count; i++) {
+    append(":", 1); append((const char *) segs[i].buf, segs[i].len);
+  }
+  append(" ", 1);
+  return 1;
+}
+
+static void on_release(void * ctx, const unsigned char * chunk)
+{
+  /* freed here, so a late use shows up under a memory checker */
+  free((void *) chunk);
+  released++;
+}
+
+static yajl_callbacks callbacks = {
+  NULL, NULL, NULL, NULL, on_number, on_string, NULL, on_key, NULL, NULL,
+  NULL
+};
+
+static int parse(const yajl_chunk_callbacks * ccbs, const char * json,
+                 size_t chunkSize)
+{
+  yajl_handle h = yajl_alloc(&callbacks, NULL, NULL);
+  size_t len = strlen(json), pos, chunks = 0;
+  yajl_status s = yajl_status_ok;
+
+  out[0] = 0;
+  released = 0;
+  if (!yajl_config(h, yajl_retain_chunks, ccbs)) return 0;
+  for (pos = 0; pos < len && s == yajl_status_ok; pos += chunkSize) {
+    size_t n = len - pos < chunkSize ? len - pos : chunkSize;
+    unsigned char * chunk = (unsigned char *) malloc(n);
+    memcpy(chunk, json + pos, n);
+    chunks++;
+    s = yajl_parse(h, chunk, n);
+  }
+  if (s == yajl_status_ok) s = yajl_complete_parse(h);
+  yajl_free(h);
+  return s == yajl_status_ok && (size_t) released == chunks;
+}
+
+int main(void) {
+  static const char json[] =
+    "{\"key one\":\"a long value\",\"k\":[12345,\"x\\ty\",\"ab\"]}";
+  yajl_chunk_callbacks ccbs = { on_release, on_segments };
+  yajl_chunk_callbacks copying = { on_release, NULL };
+
+  /* strings spanning chunks come in pieces, others as usual */
+  CHK(parse(&ccbs, json, 4));
+  CHK(strcmp(out, "K:ke:y on:e S:a lo:ng v:alue K:k n:12345 "
+                  "s:x\ty s:ab ") == 0);
+
+  /* without string_segments they are copied together */
+  CHK(parse(&copying, json, 4));
+  CHK(strcmp(out, "k:key one s:a long value k:k n:12345 s:x\ty s:ab ") == 0);
+
+  /* every chunk is released, also when it is one byte */
+  CHK(parse(&ccbs, json, 1));
+
+  return 0;
+}
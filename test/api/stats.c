@@ -0,0 +1,80 @@
+/* memory usage statistics of parser handles and generators */
+
+#include <yajl/yajl_parse.h>
+#include <yajl/yajl_gen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+static int on_string(void * ctx, const unsigned char * s, size_t len)
+{
+  return 1;
+}
+
+static yajl_callbacks callbacks = {
+  NULL, NULL, NULL, NULL, NULL, on_string, NULL, NULL, NULL, NULL, NULL
+};
+
+int main(void) {
+  char json[8192];
+  yajl_handle h;
+  yajl_gen g;
+  yajl_stats st;
+  unsigned char * out;
+  size_t len, half, i;
+
+  /* a string spanning two chunks, with an escape, nested more deeply
+   * than the state stack holds inline */
+  len = 0;
+  for (i = 0; i < 200; i++) json[len++] = '[';
+  json[len++] = '"';
+  json[len++] = '\\';
+  json[len++] = 'n';
+  for (i = 0; i < 4000; i++) json[len++] = 'x';
+  json[len++] = '"';
+  for (i = 0; i < 200; i++) json[len++] = ']';
+  half = len / 2;
+
+  /* the counters are zero until collection is switched on */
+  h = yajl_alloc(&callbacks, NULL, NULL);
+  yajl_get_stats(h, &st);
+  CHK(st.mallocs == 0 && st.bytes == 0);
+  yajl_config(h, yajl_collect_stats, 1);
+  CHK(yajl_parse(h, (const unsigned char *) json, half) == yajl_status_ok);
+  CHK(yajl_parse(h, (const unsigned char *) json + half, len - half)
+      == yajl_status_ok);
+  CHK(yajl_complete_parse(h) == yajl_status_ok);
+  yajl_get_stats(h, &st);
+  CHK(st.mallocs > 0 && st.bytes > 0);
+  CHK(st.lexBufferedBytes >= len - half - 200);
+  CHK(st.decodeBufGrows >= 2);
+  CHK(st.bufGrows > st.decodeBufGrows);
+  CHK(st.peakBufCapacity >= 4096);
+  CHK(st.stackGrows > 0);
+
+  /* switching collection on again starts the counters afresh */
+  yajl_config(h, yajl_collect_stats, 1);
+  yajl_get_stats(h, &st);
+  CHK(st.mallocs == 0 && st.reallocs == 0 && st.frees == 0);
+  CHK(st.peakBufCapacity >= 4096);
+  yajl_free(h);
+
+  /* the generator's peak stays when its buffer is taken over */
+  g = yajl_gen_alloc(NULL);
+  yajl_gen_config(g, yajl_gen_collect_stats, 1);
+  CHK(yajl_gen_string(g, (const unsigned char *) json + 202, 4000)
+      == yajl_gen_status_ok);
+  yajl_gen_get_stats(g, &st);
+  CHK(st.mallocs > 0 && st.bytes >= 4096);
+  CHK(st.peakBufCapacity >= 4096 && st.bufGrows >= 2);
+  CHK(yajl_gen_steal_buf(g, &out, &len) == yajl_gen_status_ok);
+  CHK(len == 4002);
+  yajl_gen_get_stats(g, &st);
+  CHK(st.peakBufCapacity >= 4096);
+  free(out);
+  yajl_gen_free(g);
+
+  return 0;
+}
@@ -0,0 +1,147 @@
+/* strings and map keys streamed to begin/segment/end callbacks */
+
+#include <yajl/yajl_parse.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+static char out[8192];
+static size_t longest;
+
+static void append(const char * s, size_t len)
+{
+  size_t used = strlen(out);
+  memcpy(out + used, s, len);
+  out[used + len] = 0;
+}
+
+static int on_string(void * ctx, const unsigned char * s, size_t len)
+{
+  append("s:", 2); append((const char *) s, len); append(" ", 1);
+  return 1;
+}
+
+static int on_key(void * ctx, const unsigned char * s, size_t len)
+{
+  append("k:", 2); append((const char *) s, len); append(" ", 1);
+  return 1;
+}
+
+static int on_number(void * ctx, const char * s, size_t len)
+{
+  append("n:", 2); append(s, len); append(" ", 1);
+  return 1;
+}
+
+static int on_string_begin(void * ctx)
+{
+  append("<", 1);
+  return 1;
+}
+
+static int on_segment(void * ctx, const unsigned char * s, size_t len)
+{
+  if (len > longest) longest = len;
+  append((const char *) s, len);
+  return 1;
+}
+
+static int on_string_end(void * ctx)
+{
+  append("> ", 2);
+  return 1;
+}
+
+static int on_key_begin(void * ctx)
+{
+  append("[", 1);
+  return 1;
+}
+
+static int on_key_end(void * ctx)
+{
+  append("] ", 2);
+  return 1;
+}
+
+static yajl_callbacks callbacks = {
+  NULL, NULL, NULL, NULL, on_number, on_string, NULL, on_key, NULL, NULL,
+  NULL
+};
+
+static const yajl_string_callbacks all = {
+  on_string_begin, on_segment, on_string_end,
+  on_key_begin, on_segment, on_key_end
+};
+
+static const yajl_string_callbacks values_only = {
+  on_string_begin, on_segment, on_string_end, NULL, NULL, NULL
+};
+
+static const yajl_string_callbacks broken = {
+  on_string_begin, NULL, on_string_end, NULL, NULL, NULL
+};
+
+static int parse(const yajl_string_callbacks * scbs, const char * json,
+                 size_t chunkSize)
+{
+  yajl_handle h = yajl_alloc(&callbacks, NULL, NULL);
+  size_t len = strlen(json), pos;
+  yajl_status s = yajl_status_ok;
+
+  out[0] = 0;
+  longest = 0;
+  if (!yajl_config(h, yajl_stream_strings, scbs)) {
+    yajl_free(h);
+    return 0;
+  }
+  for (pos = 0; pos < len && s == yajl_status_ok; pos += chunkSize) {
+    size_t n = len - pos < chunkSize ? len - pos : chunkSize;
+    s = yajl_parse(h, (const unsigned char *) json + pos, n);
+  }
+  if (s == yajl_status_ok) s = yajl_complete_parse(h);
+  yajl_free(h);
+  return s == yajl_status_ok;
+}
+
+int main(void) {
+  const char * json =
+    "{\"key one\":\"a long value\",\"k\":12345,"
+    "\"esc\":\"x\\ty\\u00e9\\ud83d\\ude00z\",\"e\":\"\"}";
+  const char * expect =
+    "[key one] <a long value> [k] n:12345 "
+    "[esc] <x\ty\xc3\xa9\xf0\x9f\x98\x80z> [e] <> ";
+  char big[4096];
+  size_t chunk;
+
+  /* every chunk size gives the same result, with escapes and the
+   * surrogate pair split at every position */
+  for (chunk = 1; chunk <= strlen(json); chunk++) {
+    CHK(parse(&all, json, chunk));
+    CHK(strcmp(out, expect) == 0);
+  }
+
+  /* keys go to the ordinary callback when their group is unset */
+  CHK(parse(&values_only, "{\"ab\":\"cd\"}", 3));
+  CHK(strcmp(out, "k:ab <cd> ") == 0);
+
+  /* no more than a chunk of a long string is handed over at once */
+  memset(big, 'x', sizeof(big));
+  big[0] = '[';
+  big[1] = '"';
+  big[sizeof(big) - 3] = '"';
+  big[sizeof(big) - 2] = ']';
+  big[sizeof(big) - 1] = 0;
+  CHK(parse(&all, big, 64));
+  CHK(longest <= 64);
+  CHK(strlen(out) == sizeof(big) - 5 + 3);
+
+  /* a group must be complete */
+  CHK(!parse(&broken, json, 8));
+
+  /* a bad escape in a later chunk is still an error */
+  CHK(!parse(&all, "[\"abcdefgh\\q\"]", 4));
+
+  return 0;
+}
@@ -0,0 +1,159 @@
+/* trees generated back to JSON */
+
+#include <yajl/yajl_tree.h>
+#include <yajl/yajl_gen.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+static const char * doc =
+  "{\"name\":\"caf\xc3\xa9 \\\"x\\\"\",\"n\":[1.50,-0,1e3,"
+  "123456789012345678901234567890,7],\"empty\":{},\"none\":[],"
+  "\"deep\":{\"a\":[true,false,null,{\"b\":\"/\"}]}}";
+
+/* the way callers generate a tree without yajl_tree_generate() */
+static void walk(yajl_gen g, yajl_val v)
+{
+  size_t i;
+  switch (v->type) {
+    case yajl_t_string:
+      yajl_gen_string(g, (const unsigned char *) v->u.string,
+                      strlen(v->u.string));
+      break;
+    case yajl_t_number:
+      yajl_gen_number(g, v->u.number.r, strlen(v->u.number.r));
+      break;
+    case yajl_t_object:
+      yajl_gen_map_open(g);
+      for (i = 0; i < v->u.object.len; i++) {
+        yajl_gen_string(g, (const unsigned char *) v->u.object.keys[i],
+                        strlen(v->u.object.keys[i]));
+        walk(g, v->u.object.values[i]);
+      }
+      yajl_gen_map_close(g);
+      break;
+    case yajl_t_array:
+      yajl_gen_array_open(g);
+      for (i = 0; i < v->u.array.len; i++) walk(g, v->u.array.values[i]);
+      yajl_gen_array_close(g);
+      break;
+    case yajl_t_true: yajl_gen_bool(g, 1); break;
+    case yajl_t_false: yajl_gen_bool(g, 0); break;
+    default: yajl_gen_null(g); break;
+  }
+}
+
+static int same(yajl_val v, int beautify)
+{
+  yajl_gen g1 = yajl_gen_alloc(NULL), g2 = yajl_gen_alloc(NULL);
+  const unsigned char * buf1, * buf2;
+  size_t len1, len2;
+  int rv;
+
+  yajl_gen_config(g1, yajl_gen_beautify, beautify);
+  yajl_gen_config(g2, yajl_gen_beautify, beautify);
+  yajl_gen_config(g1, yajl_gen_escape_solidus, 1);
+  yajl_gen_config(g2, yajl_gen_escape_solidus, 1);
+  /* inside a container, for the separators and indentation */
+  yajl_gen_array_open(g1);
+  yajl_gen_array_open(g2);
+  yajl_gen_integer(g1, 0);
+  yajl_gen_integer(g2, 0);
+  walk(g1, v);
+  rv = yajl_tree_generate(g2, v) == yajl_gen_status_ok;
+  yajl_gen_array_close(g1);
+  yajl_gen_array_close(g2);
+  yajl_gen_get_buf(g1, &buf1, &len1);
+  yajl_gen_get_buf(g2, &buf2, &len2);
+  rv = rv && len1 == len2 && memcmp(buf1, buf2, len1) == 0;
+  yajl_gen_free(g1);
+  yajl_gen_free(g2);
+  return rv;
+}
+
+static char out[1024];
+static size_t outLen;
+static int calls;
+
+static void print(void * ctx, const char * str, size_t len)
+{
+  (void) ctx;
+  memcpy(out + outLen, str, len);
+  outLen += len;
+  calls++;
+}
+
+int main(void) {
+  yajl_val v = yajl_tree_parse(doc, NULL, 0);
+  yajl_gen g;
+  const unsigned char * buf;
+  size_t len, sp;
+  struct yajl_val_s num, str, arr;
+  yajl_val elems[2];
+
+  CHK(v != NULL);
+  CHK(same(v, 0));
+  CHK(same(v, 1));
+
+  /* numbers keep the text they had */
+  g = yajl_gen_alloc(NULL);
+  CHK(yajl_tree_generate(g, v) == yajl_gen_status_ok);
+  CHK(yajl_tree_generate(g, v) == yajl_gen_generation_complete);
+  yajl_gen_get_buf(g, &buf, &len);
+  CHK(len == strlen(doc));
+  CHK(strstr((const char *) buf, "[1.50,-0,1e3,1234567890123") != NULL);
+  CHK(yajl_gen_get_start_offset(g) == 0 && yajl_gen_get_end_offset(g) == len);
+  yajl_gen_free(g);
+
+  /* a print callback gets the output in one piece */
+  g = yajl_gen_alloc(NULL);
+  yajl_gen_config(g, yajl_gen_print_callback, print, NULL);
+  CHK(yajl_tree_generate(g, v) == yajl_gen_status_ok);
+  CHK(calls == 1 && outLen == strlen(doc));
+  yajl_gen_free(g);
+  yajl_tree_free(v);
+
+  /* numbers of a tree built by hand have no text */
+  num.type = yajl_t_number;
+  num.u.number.r = NULL;
+  num.u.number.flags = YAJL_NUMBER_DOUBLE_VALID;
+  num.u.number.d = 2.0;
+  str.type = yajl_t_string;
+  str.u.string = (char *) "\xff";
+  elems[0] = &num;
+  elems[1] = NULL;
+  arr.type = yajl_t_array;
+  arr.u.array.values = elems;
+  arr.u.array.len = 2;
+  g = yajl_gen_alloc(NULL);
+  CHK(yajl_tree_generate(g, &arr) == yajl_gen_status_ok);
+  yajl_gen_get_buf(g, &buf, &len);
+  CHK(len == 10 && memcmp(buf, "[2.0,null]", len) == 0);
+  yajl_gen_free(g);
+
+  /* an error leaves the generator in error, a savepoint undoes it */
+  g = yajl_gen_alloc(NULL);
+  yajl_gen_config(g, yajl_gen_validate_utf8, 1);
+  yajl_gen_array_open(g);
+  elems[1] = &str;
+  CHK(yajl_gen_savepoint(g, &sp) == yajl_gen_status_ok);
+  CHK(yajl_tree_generate(g, &arr) == yajl_gen_invalid_string);
+  CHK(yajl_gen_null(g) == yajl_gen_in_error_state);
+  CHK(yajl_gen_rollback(g, sp) == yajl_gen_status_ok);
+  CHK(yajl_gen_null(g) == yajl_gen_status_ok);
+  CHK(yajl_gen_array_close(g) == yajl_gen_status_ok);
+  yajl_gen_get_buf(g, &buf, &len);
+  CHK(len == 6 && memcmp(buf, "[null]", len) == 0);
+  yajl_gen_free(g);
+
+  /* the depth limit counts the containers around the tree */
+  g = yajl_gen_alloc(NULL);
+  yajl_gen_config(g, yajl_gen_max_depth, (size_t) 1);
+  yajl_gen_array_open(g);
+  elems[1] = NULL;
+  CHK(yajl_tree_generate(g, &arr) == yajl_max_depth_exceeded);
+  yajl_gen_free(g);
+
+  return 0;
+}
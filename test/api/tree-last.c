@@ -0,0 +1,66 @@
+/* the last elements of a document, parsed from its end */
+
+#include <yajl/yajl_tree.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+static char errbuf[256];
+
+static yajl_val last(const char * s, size_t count, unsigned int options)
+{
+  return yajl_tree_parse_last(s, strlen(s), count, options,
+                              errbuf, sizeof(errbuf));
+}
+
+int main(void) {
+  yajl_val v;
+
+  /* the last elements come back in input order */
+  v = last("[1,{\"a\":[2,3],\"b\":\"x\"},[4,5],6]", 3, 0);
+  CHK(YAJL_IS_ARRAY(v) && v->u.array.len == 3);
+  CHK(YAJL_IS_OBJECT(v->u.array.values[0]));
+  CHK(v->u.array.values[0]->u.object.len == 2);
+  CHK(strcmp(v->u.array.values[0]->u.object.keys[0], "a") == 0);
+  CHK(strcmp(v->u.array.values[0]->u.object.keys[1], "b") == 0);
+  CHK(YAJL_IS_ARRAY(v->u.array.values[1]));
+  CHK(YAJL_GET_INTEGER(v->u.array.values[1]->u.array.values[0]) == 4);
+  CHK(YAJL_GET_INTEGER(v->u.array.values[2]) == 6);
+  yajl_tree_free(v);
+
+  /* fewer elements than asked for */
+  v = last("[1,2]", 5, 0);
+  CHK(YAJL_IS_ARRAY(v) && v->u.array.len == 2);
+  CHK(YAJL_GET_INTEGER(v->u.array.values[0]) == 1);
+  yajl_tree_free(v);
+
+  /* the values of a stream */
+  v = last("{\"a\":1}\n[2]\n3\n", 2, yajl_tree_option_allow_multiple_values);
+  CHK(YAJL_IS_ARRAY(v) && v->u.array.len == 2);
+  CHK(YAJL_IS_ARRAY(v->u.array.values[0]));
+  CHK(YAJL_IS_INTEGER(v->u.array.values[1]));
+  yajl_tree_free(v);
+
+  /* an empty array, and empty input */
+  v = last("[]", 2, 0);
+  CHK(YAJL_IS_ARRAY(v) && v->u.array.len == 0);
+  yajl_tree_free(v);
+  CHK(last("", 2, 0) == NULL);
+  CHK(errbuf[0] != 0);
+
+  /* the top level value must be an array */
+  CHK(last("{\"a\":[1]}", 1, 0) == NULL);
+  CHK(strcmp(errbuf, "Top level value is not an array") == 0);
+  CHK(last("5", 1, 0) == NULL);
+  CHK(strcmp(errbuf, "Top level value is not an array") == 0);
+
+  /* truncated input gives the parse error */
+  CHK(last("[1,2", 1, 0) == NULL);
+  CHK(errbuf[0] != 0);
+  CHK(strstr(errbuf, "not an array") == NULL);
+  CHK(last("{\"a\":[1,2", 1, 0) == NULL);
+  CHK(strstr(errbuf, "not an array") == NULL);
+
+  return 0;
+}
@@ -0,0 +1,60 @@
+/* exercise the flags and limits of yajl_tree_parse_options */
+
+#include <yajl/yajl_tree.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+static yajl_val parse(const char * s, unsigned int options,
+                      size_t max_depth, size_t max_size)
+{
+  char errbuf[128];
+  return yajl_tree_parse_options(s, strlen(s), options, max_depth, max_size,
+                                 errbuf, sizeof(errbuf));
+}
+
+int main(void) {
+  yajl_val v;
+
+  /* a stream of values is returned as an array of roots */
+  v = parse("{\"a\":1} [2] 3", yajl_tree_option_allow_multiple_values, 0, 0);
+  CHK(YAJL_IS_ARRAY(v) && v->u.array.len == 3);
+  CHK(YAJL_IS_OBJECT(v->u.array.values[0]));
+  CHK(YAJL_IS_ARRAY(v->u.array.values[1]));
+  CHK(YAJL_IS_INTEGER(v->u.array.values[2]));
+  yajl_tree_free(v);
+
+  /* without the flag the second value is an error */
+  CHK(parse("1 2", 0, 0, 0) == NULL);
+
+  /* nesting limit */
+  v = parse("[[1]]", 0, 2, 0);
+  CHK(YAJL_IS_ARRAY(v));
+  yajl_tree_free(v);
+  CHK(parse("[[[1]]]", 0, 2, 0) == NULL);
+
+  /* size limit */
+  CHK(parse("[1,2,3]", 0, 0, 6) == NULL);
+  v = parse("[1,2,3]", 0, 0, 7);
+  CHK(YAJL_IS_ARRAY(v));
+  yajl_tree_free(v);
+
+  /* partial values are closed where the input ends */
+  v = parse("{\"a\":[1,2],\"b\":{\"c\"", yajl_tree_option_allow_partial_values,
+            0, 0);
+  CHK(YAJL_IS_OBJECT(v) && v->u.object.len == 2);
+  CHK(YAJL_IS_ARRAY(v->u.object.values[0]));
+  CHK(v->u.object.values[0]->u.array.len == 2);
+  CHK(YAJL_IS_OBJECT(v->u.object.values[1]));
+  CHK(v->u.object.values[1]->u.object.len == 0);
+  yajl_tree_free(v);
+
+  /* comments are only accepted when asked for */
+  CHK(parse("/* c */ 1", 0, 0, 0) == NULL);
+  v = parse("/* c */ 1", yajl_tree_option_allow_comments, 0, 0);
+  CHK(YAJL_IS_NUMBER(v));
+  yajl_tree_free(v);
+
+  return 0;
+}
@@ -0,0 +1,82 @@
+/* yajl_tree_parse runs its own copy of the parse loop with its callbacks
+ * compiled in.  the streaming tree builder goes through yajl_parse and the
+ * general loop, so the two must build the same trees and fail alike */
+
+#include <yajl/yajl_tree.h>
+#include <yajl/yajl_gen.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+static char streamed[1024];
+
+static void to_text(yajl_val v, char * out)
+{
+  yajl_gen g = yajl_gen_alloc(NULL);
+  const unsigned char * buf;
+  size_t len;
+
+  out[0] = 0;
+  if (yajl_tree_generate(g, v) == yajl_gen_status_ok &&
+      yajl_gen_get_buf(g, &buf, &len) == yajl_gen_status_ok)
+  {
+    memcpy(out, buf, len);
+    out[len] = 0;
+  }
+  yajl_gen_free(g);
+}
+
+static int on_element(void * ctx, const char * key, yajl_val v)
+{
+  to_text(v, streamed);
+  return 1;
+}
+
+/* 1 if both loops agree on json */
+static int same(const char * json, unsigned int options)
+{
+  char errbuf[256], fixed[1024];
+  yajl_tree_stream s;
+  yajl_status st;
+  yajl_val v;
+  size_t len = strlen(json);
+
+  v = yajl_tree_parse_options(json, len, options, 0, 0,
+                              errbuf, sizeof(errbuf));
+  to_text(v, fixed);
+  yajl_tree_free(v);
+
+  streamed[0] = 0;
+  s = yajl_tree_stream_alloc(0, NULL, options, on_element, NULL, NULL);
+  st = yajl_tree_stream_parse(s, (const unsigned char *) json, len);
+  if (st == yajl_status_ok) st = yajl_tree_stream_complete(s);
+  yajl_tree_stream_free(s);
+
+  if ((v == NULL) != (st != yajl_status_ok)) return 0;
+  return v == NULL || strcmp(fixed, streamed) == 0;
+}
+
+int main(void) {
+  CHK(same("{\"a\":[1,2.5,-3e2,true,false,null],\"b\":{\"c\":\"d\"}}", 0));
+  CHK(strcmp(streamed,
+             "{\"a\":[1,2.5,-3e2,true,false,null],\"b\":{\"c\":\"d\"}}") == 0);
+  CHK(same("[\"esc \\u00e9\\n\\\"\",\"\",[],{},[[[{}]]]]", 0));
+  CHK(same("  12345678901234567890  ", 0));
+  CHK(same("\"top\"", 0));
+  CHK(same("/* c */ [1, // d\n 2]", yajl_tree_option_allow_comments));
+  CHK(same("[1,2] trailing", yajl_tree_option_allow_trailing_garbage));
+  CHK(same("{\"a\":[1,{\"b\":", yajl_tree_option_allow_partial_values));
+  CHK(same("[\"\xff\"]", yajl_tree_option_dont_validate_strings));
+
+  /* errors */
+  CHK(same("/* c */ [1]", 0));
+  CHK(same("[1,2] trailing", 0));
+  CHK(same("{\"a\":[1,{\"b\":", 0));
+  CHK(same("[\"\xff\"]", 0));
+  CHK(same("{\"a\" 1}", 0));
+  CHK(same("[1,]", 0));
+  CHK(same("", 0));
+
+  return 0;
+}
@@ -0,0 +1,99 @@
+/* elements yielded by the streaming tree builder */
+
+#include <yajl/yajl_tree.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHK(x) if (!(x)) { fprintf(stderr, "failed: %s\n", #x); return 1; }
+
+static char out[1024];
+
+static int on_element(void * ctx, const char * key, yajl_val v)
+{
+  char buf[64];
+  if (key != NULL) {
+    strcat(out, key);
+    strcat(out, "=");
+  }
+  if (YAJL_IS_INTEGER(v)) {
+    sprintf(buf, "%lld", YAJL_GET_INTEGER(v));
+  } else if (YAJL_IS_STRING(v)) {
+    sprintf(buf, "'%s'", YAJL_GET_STRING(v));
+  } else if (YAJL_IS_ARRAY(v)) {
+    sprintf(buf, "a%u", (unsigned) v->u.array.len);
+  } else if (YAJL_IS_OBJECT(v)) {
+    sprintf(buf, "o%u", (unsigned) v->u.object.len);
+  } else {
+    strcpy(buf, "?");
+  }
+  strcat(out, buf);
+  strcat(out, " ");
+  return ctx == NULL;
+}
+
+/* feed json in chunks of chunkSize, returning the status at the end */
+static yajl_status stream(const char * json, size_t chunkSize, size_t depth,
+                          const char ** path, unsigned int options)
+{
+  yajl_tree_stream s = yajl_tree_stream_alloc(depth, path, options,
+                                              on_element, NULL, NULL);
+  size_t len = strlen(json), pos;
+  yajl_status st = yajl_status_ok;
+
+  out[0] = 0;
+  for (pos = 0; pos < len && st == yajl_status_ok; pos += chunkSize) {
+    size_t n = len - pos < chunkSize ? len - pos : chunkSize;
+    st = yajl_tree_stream_parse(s, (const unsigned char *) json + pos, n);
+  }
+  if (st == yajl_status_ok) st = yajl_tree_stream_complete(s);
+  yajl_tree_stream_free(s);
+  return st;
+}
+
+int main(void) {
+  const char * doc =
+    "{\"meta\":{\"n\":2},\"records\":[{\"id\":1,\"tags\":[\"x\",\"y\"]},"
+    "\"two\",3],\"more\":[4]}";
+  const char * records[] = { "records", NULL };
+  const char * missing[] = { "nope", NULL };
+  size_t chunk;
+
+  /* the same elements whatever the chunk size, split or not */
+  for (chunk = 1; chunk <= strlen(doc); chunk++) {
+    CHK(stream(doc, chunk, 1, NULL, 0) == yajl_status_ok);
+    CHK(strcmp(out, "meta=o1 records=a3 more=a1 ") == 0);
+    CHK(stream(doc, chunk, 2, NULL, 0) == yajl_status_ok);
+    CHK(strcmp(out, "n=2 o2 'two' 3 4 ") == 0);
+  }
+
+  /* level 0 is the whole document */
+  CHK(stream(doc, 7, 0, NULL, 0) == yajl_status_ok);
+  CHK(strcmp(out, "o3 ") == 0);
+
+  /* a path selects the elements of one member */
+  CHK(stream(doc, 5, 2, records, 0) == yajl_status_ok);
+  CHK(strcmp(out, "o2 'two' 3 ") == 0);
+  CHK(stream(doc, 5, 1, records, 0) == yajl_status_ok);
+  CHK(strcmp(out, "records=a3 ") == 0);
+  CHK(stream(doc, 5, 2, missing, 0) == yajl_status_ok);
+  CHK(strcmp(out, "") == 0);
+
+  /* a stream of top level values */
+  CHK(stream("[1,2] {\"a\":3} 4", 3, 0, NULL,
+             yajl_tree_option_allow_multiple_values) == yajl_status_ok);
+  CHK(strcmp(out, "a2 o1 4 ") == 0);
+  CHK(stream("[1,2] [3]", 3, 1, NULL,
+             yajl_tree_option_allow_multiple_values) == yajl_status_ok);
+  CHK(strcmp(out, "1 2 3 ") == 0);
+  CHK(stream("[1] [2]", 3, 1, NULL, 0) == yajl_status_error);
+
+  /* truncated input is an error after the complete elements, unless
+   * partial values are allowed, which closes the one cut off */
+  CHK(stream("[[1,2],[3,", 4, 1, NULL, 0) == yajl_status_error);
+  CHK(strcmp(out, "a2 ") == 0);
+  CHK(stream("[[1,2],[3,", 4, 1, NULL,
+             yajl_tree_option_allow_partial_values) == yajl_status_ok);
+  CHK(strcmp(out, "a2 a1 ") == 0);
+
+  return 0;
+}